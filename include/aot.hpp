@@ -0,0 +1,1315 @@
+#pragma once
+#include <bit>
+#include <expected>
+#include <format>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <dlfcn.h>
+
+#include "artifact.hpp"
+#include "function.hpp"
+#include "parser.hpp"
+#include "verifier.hpp"
+#include "virtual_machine.hpp"
+
+namespace voyage {
+// ahead of time compilation of a program into C. each chunk of the
+// program, its top level code and every function it may call, is
+// translated into a C function whose stack slots are locals, so the
+// C compiler keeps them in registers and no instruction is
+// dispatched. the C is built into a shared object by any C compiler,
+// then loaded and run by a NativeProgram against a virtual machine.
+//
+//   voyage --aot program.c program.vy
+//   cc -O2 -shared -fPIC -o program.so program.c
+//   voyage --aot-run ./program.so
+//
+// a native program computes what interpreting the program would,
+// and fails with the same error on the same line. what the generated
+// code does not do inline, calls, natives, operations on objects,
+// such as concatenating strings or arithmetic on arrays, and the
+// reporting of errors, it asks of the host through the functions of
+// a voyage_aot_api.
+//
+// #NOTE aot::prelude and the structs of namespace aot describe the
+// same layout, bump aot_abi, and VOYAGE_AOT_ABI of the prelude,
+// whenever either changes, or the instructions are renumbered.
+constexpr inline u32 aot_abi = 2;
+
+// the symbol of the voyage_aot_module a native program exports.
+constexpr inline char const *aot_symbol = "voyage_module";
+
+namespace aot {
+enum Status : int {
+  Done,
+  Failed,
+  // the function returned by a tail call, whose window the host
+  // holds, and calls in place of the function.
+  Tail,
+};
+
+enum class Tag : u8 { Integer, Real, String, Function, Array };
+
+// a Value, as the generated code sees it.
+struct Cell {
+  u8 kind;
+  union {
+    i64   integer;
+    f64   real;
+    void *object;
+  } as;
+};
+
+struct Context;
+using Code = int (*)(Context *context, Cell const *arguments, Cell *out);
+
+struct Api {
+  int (*fail)(Context *context, char const *message, u64 line);
+  // the generic instruction, with its immediate, applied to operands
+  // which are not all numbers.
+  int (*operate)(Context *context, u32 instruction, u32 immediate,
+                 Cell const *operands, u64 line, Cell *out);
+  int (*call)(Context *context, Cell const *window, u32 arguments, u64 line,
+              Cell *out);
+  int (*tail)(Context *context, Cell const *window, u32 arguments, u64 line);
+  int (*native)(Context *context, u32 index, Cell const *arguments, u64 line,
+                Cell *out);
+};
+
+struct Context {
+  Api const  *api;
+  Cell       *globals;
+  Cell const *constants;
+  void       *host;
+};
+
+struct Constant {
+  u8          tag;
+  // the integer, the bits of the real, the index of the function,
+  // or the number of elements of the array.
+  u64         bits;
+  char const *text;
+  u32         length;
+  // the bits of each element of the array.
+  u64 const  *elements;
+};
+
+struct FunctionEntry {
+  char const *name;
+  u8          arity;
+  u64         declared;
+  // null when the function failed to compile, a call then fails with
+  // the error, on its line, or on the line of the call when it is 0.
+  Code        code;
+  char const *error;
+  u64         error_line;
+};
+
+struct NativeEntry {
+  char const *name;
+  u8          arity;
+};
+
+struct Module {
+  u32                  abi;
+  u32                  size;
+  u32                  global_count;
+  char const *const   *globals;
+  u32                  native_count;
+  NativeEntry const   *natives;
+  u32                  constant_count;
+  Constant const      *constants;
+  u32                  function_count;
+  FunctionEntry const *functions;
+  Code                 entry;
+};
+
+inline Cell toCell(Value const &value) noexcept {
+  Cell cell{};
+  cell.kind = std::to_underlying(value.kind());
+  switch (value.kind()) {
+  case Value::Kind::Integer:
+    cell.as.integer = value.integer();
+    break;
+  case Value::Kind::Real:
+    cell.as.real = value.real();
+    break;
+  case Value::Kind::Object:
+    cell.as.object = value.object();
+    break;
+  }
+  return cell;
+}
+
+inline Value toValue(Cell const &cell) noexcept {
+  switch (static_cast<Value::Kind>(cell.kind)) {
+  case Value::Kind::Integer:
+    return Value{cell.as.integer};
+  case Value::Kind::Real:
+    return Value{cell.as.real};
+  default:
+    return Value{static_cast<Object *>(cell.as.object)};
+  }
+}
+
+// the declarations every generated program begins with, and the
+// arithmetic of arithmetic.hpp on cells.
+constexpr inline std::string_view prelude = R"(#include <stdint.h>
+#include <string.h>
+
+#define VOYAGE_AOT_ABI 2
+#define VOYAGE_DONE 0
+#define VOYAGE_FAILED 1
+/* a segment of a chunk ran to its end. segments are called once
+   each, and would otherwise be inlined back into a single function. */
+#define VOYAGE_NEXT 3
+#define VOYAGE_SEGMENT __attribute__((noinline))
+
+/* the kind of a cell, then also the tag of a constant. */
+enum { VOYAGE_INTEGER, VOYAGE_REAL, VOYAGE_OBJECT };
+enum { VOYAGE_STRING = 2, VOYAGE_FUNCTION, VOYAGE_ARRAY };
+
+typedef struct voyage_cell {
+  uint8_t kind;
+  union {
+    int64_t integer;
+    double real;
+    void *object;
+  } as;
+} voyage_cell;
+
+typedef struct voyage_aot_context voyage_aot_context;
+typedef int (*voyage_aot_code)(voyage_aot_context *rt,
+                               const voyage_cell *args, voyage_cell *out);
+
+typedef struct voyage_aot_api {
+  int (*fail)(voyage_aot_context *rt, const char *message, uint64_t line);
+  int (*operate)(voyage_aot_context *rt, uint32_t instruction,
+                 uint32_t immediate, const voyage_cell *operands,
+                 uint64_t line, voyage_cell *out);
+  int (*call)(voyage_aot_context *rt, const voyage_cell *window,
+              uint32_t arguments, uint64_t line, voyage_cell *out);
+  int (*tail)(voyage_aot_context *rt, const voyage_cell *window,
+              uint32_t arguments, uint64_t line);
+  int (*native)(voyage_aot_context *rt, uint32_t index,
+                const voyage_cell *arguments, uint64_t line,
+                voyage_cell *out);
+} voyage_aot_api;
+
+struct voyage_aot_context {
+  const voyage_aot_api *api;
+  voyage_cell *globals;
+  const voyage_cell *constants;
+  void *host;
+};
+
+typedef struct voyage_aot_constant {
+  uint8_t tag;
+  uint64_t bits;
+  const char *text;
+  uint32_t length;
+  const uint64_t *elements;
+} voyage_aot_constant;
+
+typedef struct voyage_aot_function {
+  const char *name;
+  uint8_t arity;
+  uint64_t declared;
+  voyage_aot_code code;
+  const char *error;
+  uint64_t error_line;
+} voyage_aot_function;
+
+typedef struct voyage_aot_native {
+  const char *name;
+  uint8_t arity;
+} voyage_aot_native;
+
+typedef struct voyage_aot_module {
+  uint32_t abi;
+  uint32_t size;
+  uint32_t global_count;
+  const char *const *globals;
+  uint32_t native_count;
+  const voyage_aot_native *natives;
+  uint32_t constant_count;
+  const voyage_aot_constant *constants;
+  uint32_t function_count;
+  const voyage_aot_function *functions;
+  voyage_aot_code entry;
+} voyage_aot_module;
+
+static inline voyage_cell vi(int64_t integer) {
+  voyage_cell cell;
+  cell.kind = VOYAGE_INTEGER;
+  cell.as.integer = integer;
+  return cell;
+}
+
+static inline voyage_cell vr(double real) {
+  voyage_cell cell;
+  cell.kind = VOYAGE_REAL;
+  cell.as.real = real;
+  return cell;
+}
+
+static inline voyage_cell vbits(uint64_t bits) {
+  double real;
+  memcpy(&real, &bits, sizeof real);
+  return vr(real);
+}
+
+static inline int vnum(voyage_cell a) { return a.kind != VOYAGE_OBJECT; }
+
+static inline double vreal(voyage_cell a) {
+  return a.kind == VOYAGE_INTEGER ? (double)a.as.integer : a.as.real;
+}
+
+static inline voyage_cell vneg(voyage_cell a) {
+  int64_t result;
+  if (a.kind == VOYAGE_INTEGER &&
+      !__builtin_sub_overflow((int64_t)0, a.as.integer, &result)) {
+    return vi(result);
+  }
+  return vr(-vreal(a));
+}
+
+static inline voyage_cell vadd(voyage_cell a, voyage_cell b) {
+  int64_t result;
+  if (a.kind == VOYAGE_INTEGER && b.kind == VOYAGE_INTEGER &&
+      !__builtin_add_overflow(a.as.integer, b.as.integer, &result)) {
+    return vi(result);
+  }
+  return vr(vreal(a) + vreal(b));
+}
+
+static inline voyage_cell vsub(voyage_cell a, voyage_cell b) {
+  int64_t result;
+  if (a.kind == VOYAGE_INTEGER && b.kind == VOYAGE_INTEGER &&
+      !__builtin_sub_overflow(a.as.integer, b.as.integer, &result)) {
+    return vi(result);
+  }
+  return vr(vreal(a) - vreal(b));
+}
+
+static inline voyage_cell vmul(voyage_cell a, voyage_cell b) {
+  int64_t result;
+  if (a.kind == VOYAGE_INTEGER && b.kind == VOYAGE_INTEGER &&
+      !__builtin_mul_overflow(a.as.integer, b.as.integer, &result)) {
+    return vi(result);
+  }
+  return vr(vreal(a) * vreal(b));
+}
+
+static inline voyage_cell vdiv(voyage_cell a, voyage_cell b) {
+  return vr(vreal(a) / vreal(b));
+}
+)";
+
+// a C string literal of the given bytes. every byte outside of
+// printable ascii is an octal escape of three digits, which never
+// absorbs a digit following it.
+inline std::string literal(std::string_view text) {
+  std::string out{"\""};
+  for (char c : text) {
+    auto byte = (u8)(c);
+    if (c == '"' || c == '\\' || c == '?') {
+      out.push_back('\\');
+      out.push_back(c);
+    } else if (byte >= 0x20 && byte < 0x7F) {
+      out.push_back(c);
+    } else {
+      out.append(std::format("\\{:03o}", byte));
+    }
+  }
+  out.push_back('"');
+  return out;
+}
+
+class Translator {
+private:
+  // a chunk to translate, and the index of the first of its
+  // constants within the constants of the program.
+  struct Unit {
+    Bytecode *bytecode;
+    Function *function;
+    size_t    base = 0;
+  };
+
+  struct Entry {
+    Function            *function;
+    std::optional<Error> failure;
+    size_t               unit = 0;
+  };
+
+  // the instructions of a chunk between two points, and the number
+  // of slots live at either, and used within.
+  struct Segment {
+    std::string body;
+    size_t      entry;
+    size_t      exit;
+    size_t      slots;
+  };
+
+  // the most instructions translated into one C function. C compilers
+  // take time superlinear in the size of a function, and top level
+  // code is as long as the script.
+  static constexpr size_t segment_length = 256;
+
+  Heap                                    &m_heap;
+  Globals                                 &m_globals;
+  Natives                                 &m_natives;
+  Optimizer                               *m_optimizer;
+  std::vector<Unit>                        m_units;
+  std::vector<Entry>                       m_entries;
+  std::unordered_map<Function const *, u32> m_indices;
+  std::string                              m_out;
+
+  // finds the functions declared by the chunk, compiling those which
+  // were deferred, as their first call would.
+  void discover(Bytecode &bytecode) {
+    for (Value const &constant : bytecode.constants()) {
+      if (!constant.isFunction()) {
+        continue;
+      }
+      auto *function = constant.function();
+      if (m_indices.contains(function)) {
+        continue;
+      }
+      m_indices.emplace(function, (u32)(m_entries.size()));
+
+      Entry entry{function, std::nullopt};
+      if (!function->compiled()) {
+        Parser parser{m_heap, m_globals, m_natives};
+        parser.optimizeWith(m_optimizer);
+        parser.quieten(true);
+        if (!parser.compile(*function)) {
+          // the line of the call is not known yet, 0 stands for it.
+          entry.failure = parser.firstError().value_or(
+              Error{Error::Kind::Comptime,
+                    std::format("failed to compile function '{:s}'",
+                                function->name()->view()),
+                    0});
+        } else {
+          m_heap.collector().barrier(function);
+        }
+      }
+      if (!entry.failure) {
+        entry.unit = m_units.size();
+        m_units.push_back(Unit{&function->bytecode(), function});
+      }
+      m_entries.push_back(std::move(entry));
+    }
+  }
+
+  // declares the slots of a segment, loading those live on entry
+  // from the given array.
+  void declare(Segment const &segment, std::string_view from) {
+    for (size_t slot = 0; slot < segment.slots; ++slot) {
+      m_out.append(slot < segment.entry
+                       ? std::format("  voyage_cell s{:d} = {:s}[{:d}];\n",
+                                     slot, from, slot)
+                       : std::format("  voyage_cell s{:d} = vi(0);\n", slot));
+    }
+    // a slot live on entry may go unused.
+    for (size_t slot = 0; slot < segment.entry; ++slot) {
+      m_out.append(std::format("  (void)s{:d};\n", slot));
+    }
+  }
+
+  void chunk(size_t index) {
+    Unit const &unit   = m_units[index];
+    Bytecode   &bc     = *unit.bytecode;
+    size_t      params = unit.function == nullptr
+                             ? 0
+                             : (size_t)(unit.function->arity()) + 1;
+
+    // whether each slot is known to hold a number, which holds for
+    // the result of any arithmetic, and spares checking its operand.
+    std::vector<bool> number(params, false);
+    size_t            depth = params;
+    size_t            slots = params;
+    auto push = [&](bool is_number) {
+      number.resize(std::max(number.size(), depth + 1));
+      number[depth++] = is_number;
+      slots           = std::max(slots, depth);
+    };
+    auto window = [&](size_t first, size_t count) {
+      std::string out;
+      for (size_t i = first; i < first + count; ++i) {
+        out.append(std::format("{:s}s{:d}", i == first ? "" : ", ", i));
+      }
+      return out;
+    };
+
+    std::vector<Segment> segments;
+    std::string          body;
+    size_t               entry    = params;
+    size_t               count    = 0;
+    auto const          &runs     = bc.lines().runs();
+    size_t               run      = 0;
+    size_t               end      = runs.empty() ? 0 : runs[0].m_length;
+    size_t               previous = 0;
+
+    size_t offset = 0;
+    while (offset < bc.size()) {
+      while (end <= offset && run + 1 < runs.size()) {
+        end += runs[++run].m_length;
+      }
+      if (count++ == segment_length) {
+        segments.push_back(Segment{std::move(body), entry, depth, slots});
+        body.clear();
+        entry    = depth;
+        slots    = depth;
+        count    = 1;
+        previous = 0;
+      }
+      size_t line = runs.empty() ? 0 : runs[run].m_line;
+      if (line != previous) {
+        body.append(std::format("  /* line {:d} */\n", line));
+        previous = line;
+      }
+
+      auto   instruction = static_cast<Instruction>(bc[offset]);
+      size_t bytes       = immediateBytes(instruction);
+      size_t immediate   = bytes == 0 ? 0 : bc.readImmediate(offset + 1, bytes);
+      offset            += 1 + bytes;
+
+      // asks the host to apply the generic instruction to count
+      // operands from the given slot, which then holds the result.
+      auto operate = [&](Instruction generic, size_t argument, size_t first,
+                         size_t count, std::string_view indent) {
+        if (count > 0) {
+          body.append(std::format("{:s}voyage_cell w[] = {{{:s}}};\n",
+                                  indent, window(first, count)));
+        }
+        body.append(std::format(
+            "{:s}if (rt->api->operate(rt, {:d}, {:d}, {:s}, {:d}, &s{:d}) != "
+            "VOYAGE_DONE) {{\n"
+            "{:s}  return VOYAGE_FAILED;\n"
+            "{:s}}}\n",
+            indent, std::to_underlying(generic), argument,
+            count > 0 ? "w" : "0", line, first, indent, indent));
+      };
+
+      auto binary = [&](Instruction generic, std::string_view op) {
+        size_t a = depth - 2, b = depth - 1;
+        if (number[a] && number[b]) {
+          body.append(std::format("  s{:d} = {:s}(s{:d}, s{:d});\n", a, op,
+                                  a, b));
+        } else {
+          body.append(std::format(
+              "  if (vnum(s{:d}) && vnum(s{:d})) {{\n"
+              "    s{:d} = {:s}(s{:d}, s{:d});\n"
+              "  }} else {{\n",
+              a, b, a, op, a, b));
+          operate(generic, 0, a, 2, "    ");
+          body.append("  }\n");
+          number[a] = false;
+        }
+        depth--;
+      };
+
+      switch (instruction) {
+      case Instruction::RETURN:
+        if (depth == 0) {
+          body.append("  *out = vr(0.0);\n");
+        } else {
+          body.append(std::format("  *out = s{:d};\n", depth - 1));
+        }
+        body.append("  return VOYAGE_DONE;\n");
+        break;
+
+      case Instruction::CALL:
+      case Instruction::TAIL_CALL: {
+        size_t callee = depth - immediate - 1;
+        body.append(std::format("  {{\n    voyage_cell w[] = {{{:s}}};\n",
+                                window(callee, immediate + 1)));
+        if (instruction == Instruction::CALL) {
+          body.append(std::format(
+              "    if (rt->api->call(rt, w, {:d}, {:d}, &s{:d}) != "
+              "VOYAGE_DONE) {{\n"
+              "      return VOYAGE_FAILED;\n"
+              "    }}\n",
+              immediate, line, callee));
+        } else {
+          body.append(std::format(
+              "    return rt->api->tail(rt, w, {:d}, {:d});\n", immediate,
+              line));
+        }
+        body.append("  }\n");
+        depth          = callee + 1;
+        number[callee] = false;
+        break;
+      }
+
+      case Instruction::CALL_NATIVE: {
+        size_t arity = m_natives[immediate].arity;
+        size_t base  = depth - arity;
+        body.append("  {\n");
+        if (arity > 0) {
+          body.append(std::format("    voyage_cell w[] = {{{:s}}};\n",
+                                  window(base, arity)));
+        }
+        body.append(std::format(
+            "    if (rt->api->native(rt, {:d}, {:s}, {:d}, &s{:d}) != "
+            "VOYAGE_DONE) {{\n"
+            "      return VOYAGE_FAILED;\n"
+            "    }}\n"
+            "  }}\n",
+            immediate, arity > 0 ? "w" : "0", line, base));
+        depth = base;
+        push(false);
+        break;
+      }
+
+      case Instruction::CONSTANT_U8:
+      case Instruction::CONSTANT_U16:
+      case Instruction::CONSTANT_U32:
+      case Instruction::CONSTANT_U64: {
+        Value const &constant = bc.constants()[immediate];
+        if (constant.isInteger()) {
+          // #NOTE INT64_MIN has no literal, its negation overflows.
+          body.append(
+              constant.integer() == INT64_MIN
+                  ? std::format("  s{:d} = vi(INT64_MIN);\n", depth)
+                  : std::format("  s{:d} = vi(INT64_C({:d}));\n", depth,
+                                constant.integer()));
+        } else if (constant.isReal()) {
+          body.append(std::format("  s{:d} = vbits(UINT64_C(0x{:016x}));\n",
+                                  depth,
+                                  std::bit_cast<u64>(constant.real())));
+        } else {
+          body.append(std::format("  s{:d} = rt->constants[{:d}];\n", depth,
+                                  unit.base + immediate));
+        }
+        push(constant.isNumber());
+        break;
+      }
+
+      case Instruction::POP:
+        depth--;
+        break;
+
+      case Instruction::GET_LOCAL:
+        body.append(std::format("  s{:d} = s{:d};\n", depth, immediate));
+        push(number[immediate]);
+        break;
+
+      case Instruction::SET_LOCAL:
+        body.append(std::format("  s{:d} = s{:d};\n", immediate, depth - 1));
+        number[immediate] = number[depth - 1];
+        break;
+
+      case Instruction::GET_GLOBAL:
+        body.append(
+            std::format("  s{:d} = rt->globals[{:d}];\n", depth, immediate));
+        push(false);
+        break;
+
+      case Instruction::SET_GLOBAL:
+      case Instruction::DEFINE_GLOBAL:
+        body.append(std::format("  rt->globals[{:d}] = s{:d};\n", immediate,
+                                depth - 1));
+        if (instruction == Instruction::DEFINE_GLOBAL) {
+          depth--;
+        }
+        break;
+
+      case Instruction::NEGATE:
+        if (number[depth - 1]) {
+          body.append(std::format("  s{:d} = vneg(s{:d});\n", depth - 1,
+                                  depth - 1));
+        } else {
+          body.append(std::format("  if (vnum(s{:d})) {{\n"
+                                  "    s{:d} = vneg(s{:d});\n"
+                                  "  }} else {{\n",
+                                  depth - 1, depth - 1, depth - 1));
+          operate(Instruction::NEGATE, 0, depth - 1, 1, "    ");
+          body.append("  }\n");
+        }
+        break;
+
+      // a specialized instruction falls back to the generic operation
+      // whenever its operands are not of its kind, so each is generic.
+      case Instruction::ADD:
+      case Instruction::ADD_INT:
+      case Instruction::ADD_REAL:
+        binary(Instruction::ADD, "vadd");
+        break;
+      case Instruction::SUB:
+      case Instruction::SUB_INT:
+      case Instruction::SUB_REAL:
+        binary(Instruction::SUB, "vsub");
+        break;
+      case Instruction::MUL:
+      case Instruction::MUL_INT:
+      case Instruction::MUL_REAL:
+        binary(Instruction::MUL, "vmul");
+        break;
+      case Instruction::DIV:
+      case Instruction::DIV_REAL:
+        binary(Instruction::DIV, "vdiv");
+        break;
+
+      case Instruction::ARRAY:
+        body.append("  {\n");
+        operate(instruction, immediate, depth - immediate, immediate, "    ");
+        body.append("  }\n");
+        depth -= immediate;
+        push(false);
+        break;
+
+      case Instruction::INDEX:
+      case Instruction::SLICE: {
+        size_t operands = instruction == Instruction::INDEX
+                              ? 2
+                              : 1 + ((immediate & slice_start) != 0) +
+                                    ((immediate & slice_end) != 0);
+        body.append("  {\n");
+        operate(instruction, immediate, depth - operands, operands, "    ");
+        body.append("  }\n");
+        depth -= operands;
+        push(false);
+        break;
+      }
+
+      // refused by translate.
+      case Instruction::SPAWN:
+      case Instruction::JOIN:
+      case Instruction::CHANNEL:
+      case Instruction::SEND:
+      case Instruction::RECEIVE:
+        std::unreachable();
+      }
+    }
+
+    segments.push_back(Segment{std::move(body), entry, depth, slots});
+
+    // a chunk of a single segment keeps its slots in locals throughout.
+    auto signature = std::format(
+        "static int voyage_chunk_{:d}(voyage_aot_context *rt, "
+        "const voyage_cell *args, voyage_cell *out) {{\n",
+        index);
+    if (segments.size() == 1) {
+      m_out.append(signature);
+      if (params == 0) {
+        m_out.append("  (void)args;\n");
+      }
+      // #NOTE every argument is copied into a local before anything
+      // else, the host reuses the window of a tail call once it has.
+      declare(segments[0], "args");
+      m_out.append(segments[0].body);
+      m_out.append("}\n\n");
+      return;
+    }
+
+    // otherwise each segment is a function of its own, which loads the
+    // slots live on entry from the frame, and stores those live on
+    // exit back, then the chunk runs each in turn until one returns.
+    size_t frame = 1;
+    for (size_t i = 0; i < segments.size(); ++i) {
+      Segment const &segment = segments[i];
+      frame = std::max(frame, segment.slots);
+      m_out.append(std::format(
+          "static VOYAGE_SEGMENT int voyage_chunk_{:d}_{:d}("
+          "voyage_aot_context *rt, "
+          "voyage_cell *frame, voyage_cell *out) {{\n"
+          "  (void)frame;\n"
+          "  (void)out;\n",
+          index, i));
+      declare(segment, "frame");
+      m_out.append(segment.body);
+      for (size_t slot = 0; slot < segment.exit; ++slot) {
+        m_out.append(std::format("  frame[{:d}] = s{:d};\n", slot, slot));
+      }
+      m_out.append("  return VOYAGE_NEXT;\n}\n\n");
+    }
+
+    m_out.append(signature);
+    m_out.append(std::format("  voyage_cell frame[{:d}];\n  int status;\n",
+                             frame));
+    for (size_t slot = 0; slot < params; ++slot) {
+      m_out.append(std::format("  frame[{:d}] = args[{:d}];\n", slot, slot));
+    }
+    if (params == 0) {
+      m_out.append("  (void)args;\n");
+    }
+    for (size_t i = 0; i < segments.size(); ++i) {
+      m_out.append(std::format(
+          "  if ((status = voyage_chunk_{:d}_{:d}(rt, frame, out)) != "
+          "VOYAGE_NEXT) {{\n"
+          "    return status;\n"
+          "  }}\n",
+          index, i));
+    }
+    m_out.append("  return VOYAGE_DONE;\n}\n\n");
+  }
+
+  void tables() {
+    if (m_globals.size() > 0) {
+      m_out.append("static const char *const voyage_globals[] = {\n");
+      for (String const *name : m_globals.names()) {
+        m_out.append(std::format("  {:s},\n", literal(name->view())));
+      }
+      m_out.append("};\n\n");
+    }
+
+    if (m_natives.size() > 0) {
+      m_out.append("static const voyage_aot_native voyage_natives[] = {\n");
+      for (Native const &native : m_natives.natives()) {
+        m_out.append(std::format("  {{{:s}, {:d}}},\n",
+                                 literal(native.name->view()), native.arity));
+      }
+      m_out.append("};\n\n");
+    }
+
+    size_t constants = 0;
+    for (Unit &unit : m_units) {
+      unit.base  = constants;
+      constants += unit.bytecode->constantCount();
+    }
+    for (Unit const &unit : m_units) {
+      for (size_t i = 0; i < unit.bytecode->constantCount(); ++i) {
+        Value const &constant = unit.bytecode->constants()[i];
+        if (!constant.isArray() || constant.array()->length() == 0) {
+          continue;
+        }
+        m_out.append(std::format(
+            "static const uint64_t voyage_elements_{:d}[] = {{\n",
+            unit.base + i));
+        for (f64 element : constant.array()->elements()) {
+          m_out.append(std::format("  UINT64_C(0x{:016x}),\n",
+                                   std::bit_cast<u64>(element)));
+        }
+        m_out.append("};\n\n");
+      }
+    }
+
+    if (constants > 0) {
+      m_out.append("static const voyage_aot_constant voyage_constants[] = {\n");
+      for (Unit const &unit : m_units) {
+        for (size_t i = 0; i < unit.bytecode->constantCount(); ++i) {
+          Value const &constant = unit.bytecode->constants()[i];
+          if (constant.isInteger()) {
+            m_out.append(std::format("  {{VOYAGE_INTEGER, UINT64_C({:d}), 0, "
+                                     "0, 0}},\n",
+                                     (u64)(constant.integer())));
+          } else if (constant.isReal()) {
+            m_out.append(std::format(
+                "  {{VOYAGE_REAL, UINT64_C(0x{:016x}), 0, 0, 0}},\n",
+                std::bit_cast<u64>(constant.real())));
+          } else if (constant.isString()) {
+            auto text = constant.string()->view();
+            m_out.append(
+                std::format("  {{VOYAGE_STRING, 0, {:s}, {:d}, 0}},\n",
+                            literal(text), text.size()));
+          } else if (constant.isArray()) {
+            size_t length = constant.array()->length();
+            m_out.append(std::format(
+                "  {{VOYAGE_ARRAY, {:d}, 0, 0, {:s}}},\n", length,
+                length == 0 ? std::string{"0"}
+                            : std::format("voyage_elements_{:d}",
+                                          unit.base + i)));
+          } else {
+            m_out.append(
+                std::format("  {{VOYAGE_FUNCTION, {:d}, 0, 0, 0}},\n",
+                            m_indices.at(constant.function())));
+          }
+        }
+      }
+      m_out.append("};\n\n");
+    }
+  }
+
+  void functions() {
+    if (m_entries.empty()) {
+      return;
+    }
+    m_out.append("static const voyage_aot_function voyage_functions[] = {\n");
+    for (Entry const &entry : m_entries) {
+      auto const *function = entry.function;
+      if (entry.failure) {
+        m_out.append(std::format("  {{{:s}, {:d}, {:d}, 0, {:s}, {:d}}},\n",
+                                 literal(function->name()->view()),
+                                 function->arity(), function->declared(),
+                                 literal(entry.failure->msg()),
+                                 entry.failure->line()));
+      } else {
+        m_out.append(std::format(
+            "  {{{:s}, {:d}, {:d}, voyage_chunk_{:d}, 0, 0}},\n",
+            literal(function->name()->view()), function->arity(),
+            function->declared(), entry.unit));
+      }
+    }
+    m_out.append("};\n\n");
+  }
+
+  void module() {
+    auto table = [](bool empty, std::string_view name) {
+      return empty ? std::string{"0"} : std::string{name};
+    };
+    m_out.append(std::format(
+        "const voyage_aot_module {:s} = {{\n"
+        "  VOYAGE_AOT_ABI, sizeof(voyage_aot_module),\n"
+        "  {:d}, {:s},\n"
+        "  {:d}, {:s},\n"
+        "  {:d}, {:s},\n"
+        "  {:d}, {:s},\n"
+        "  voyage_chunk_0,\n"
+        "}};\n",
+        aot_symbol, m_globals.size(),
+        table(m_globals.size() == 0, "voyage_globals"), m_natives.size(),
+        table(m_natives.size() == 0, "voyage_natives"),
+        m_units.back().base + m_units.back().bytecode->constantCount(),
+        table(m_units.back().base + m_units.back().bytecode->constantCount() ==
+                  0,
+              "voyage_constants"),
+        m_entries.size(), table(m_entries.empty(), "voyage_functions")));
+  }
+
+public:
+  Translator(Heap &heap, Globals &globals, Natives &natives,
+             Optimizer *optimizer) noexcept
+      : m_heap(heap), m_globals(globals), m_natives(natives),
+        m_optimizer(optimizer) {}
+
+  std::expected<std::string, Error> translate(Bytecode &program) {
+    m_units.push_back(Unit{&program, nullptr});
+    for (size_t i = 0; i < m_units.size(); ++i) {
+      discover(*m_units[i].bytecode);
+    }
+
+    // the stack depth of each instruction is only known of verified
+    // chunks, which are also the only chunks the virtual machine runs.
+    if (auto verified = verify(program, m_globals.size(), m_natives);
+        !verified) {
+      return std::unexpected{verified.error()};
+    }
+    for (Unit const &unit : m_units) {
+      if (unit.function == nullptr) {
+        continue;
+      }
+      if (auto verified = verify(*unit.function, m_globals.size(), m_natives);
+          !verified) {
+        return std::unexpected{verified.error()};
+      }
+    }
+
+    // #NOTE a fiber runs on a strand of its own, which code running
+    // on the stack of the host has no way to switch to.
+    for (Unit const &unit : m_units) {
+      Bytecode const &bc = *unit.bytecode;
+      for (size_t offset = 0; offset < bc.size();) {
+        auto instruction = static_cast<Instruction>(bc[offset]);
+        switch (instruction) {
+        case Instruction::SPAWN:
+        case Instruction::JOIN:
+        case Instruction::CHANNEL:
+        case Instruction::SEND:
+        case Instruction::RECEIVE:
+          return std::unexpected{
+              Error{Error::Kind::Comptime,
+                    "fibers and channels can not be compiled ahead of time",
+                    bc.getLine(offset)}};
+        default:
+          break;
+        }
+        offset += 1 + immediateBytes(instruction);
+      }
+    }
+
+    m_out.append(std::format("/* compiled by voyage {:s}, do not edit. */\n",
+                             artifact_version));
+    m_out.append(prelude);
+    m_out.push_back('\n');
+    for (size_t i = 0; i < m_units.size(); ++i) {
+      m_out.append(std::format(
+          "static int voyage_chunk_{:d}(voyage_aot_context *rt, "
+          "const voyage_cell *args, voyage_cell *out);\n",
+          i));
+    }
+    m_out.push_back('\n');
+    tables();
+    functions();
+    for (size_t i = 0; i < m_units.size(); ++i) {
+      chunk(i);
+    }
+    module();
+    return std::move(m_out);
+  }
+};
+} // namespace aot
+
+// translates the program, and every function it may call, into C,
+// compiling the functions which were deferred with the optimizer,
+// when it is given.
+inline std::expected<std::string, Error>
+translateToC(Bytecode &program, Heap &heap, Globals &globals,
+             Natives &natives, Optimizer *optimizer = nullptr) {
+  aot::Translator translator{heap, globals, natives, optimizer};
+  return translator.translate(program);
+}
+
+// a program compiled ahead of time, loaded from its shared object,
+// which runs against the heap, globals and natives of a virtual
+// machine.
+//
+// #NOTE the heap is not collected while a native program runs, the
+// values it holds are in locals of the generated code, where the
+// collector cannot see them. its Functions have no chunk, each is
+// deferred with an empty body, so the virtual machine fails to call
+// one rather than running nothing.
+class NativeProgram {
+private:
+  struct Close {
+    void operator()(void *handle) const noexcept { dlclose(handle); }
+  };
+
+  // releases the chunk which roots the constants of the program.
+  struct Release {
+    VirtualMachine *vm;
+    void            operator()(Bytecode *roots) const noexcept {
+      vm->release(*roots);
+      delete roots;
+    }
+  };
+
+  // the state of one run, which the generated code passes back to
+  // each function of the api.
+  struct Runtime {
+    NativeProgram const   *program = nullptr;
+    size_t                 depth   = 1;
+    std::optional<Error>   error;
+    std::vector<aot::Cell> tail;
+    u32                    tail_arguments = 0;
+    u64                    tail_line      = 0;
+    std::vector<Value>     arguments;
+  };
+
+  std::unique_ptr<void, Close>            m_handle;
+  aot::Module const                      *m_module = nullptr;
+  VirtualMachine                         *m_vm     = nullptr;
+  std::unique_ptr<Bytecode, Release>      m_roots;
+  std::vector<aot::Cell>                  m_constants;
+  std::unordered_map<Object const *, u32> m_functions;
+
+  NativeProgram(void *handle, VirtualMachine &vm)
+      : m_handle(handle), m_vm(&vm),
+        m_roots(new Bytecode, Release{&vm}) {}
+
+  static Runtime &runtimeOf(aot::Context *context) noexcept {
+    return *static_cast<Runtime *>(context->host);
+  }
+
+  static int failWith(Runtime &runtime, Error error) {
+    runtime.error = std::move(error);
+    return aot::Failed;
+  }
+
+  static int fail(aot::Context *context, char const *message, u64 line) {
+    return failWith(runtimeOf(context),
+                    Error{Error::Kind::Runtime, message, line});
+  }
+
+  // the operations the generated code leaves to the host, those on
+  // objects, which may allocate, or fail with an error of their own.
+  static int operate(aot::Context *context, u32 instruction, u32 immediate,
+                     aot::Cell const *operands, u64 line, aot::Cell *out) {
+    auto &runtime = runtimeOf(context);
+    auto &heap    = runtime.program->m_vm->heap();
+    auto  operand = [&](size_t i) { return aot::toValue(operands[i]); };
+
+    Outcome outcome = std::unexpected{"invalid operation"};
+    switch (static_cast<Instruction>(instruction)) {
+    case Instruction::NEGATE:
+      outcome = negation(heap, operand(0));
+      break;
+    case Instruction::ADD:
+    case Instruction::SUB:
+    case Instruction::MUL:
+    case Instruction::DIV:
+      outcome = arithmetic(heap, static_cast<Instruction>(instruction),
+                           operand(0), operand(1));
+      break;
+    case Instruction::ARRAY:
+      runtime.arguments.clear();
+      for (size_t i = 0; i < immediate; ++i) {
+        runtime.arguments.push_back(operand(i));
+      }
+      outcome = arrayOf(heap, runtime.arguments);
+      break;
+    case Instruction::INDEX:
+      outcome = element(operand(0), operand(1));
+      break;
+    case Instruction::SLICE: {
+      size_t               next = 1;
+      std::optional<Value> start;
+      std::optional<Value> end;
+      if (immediate & slice_start) {
+        start = operand(next++);
+      }
+      if (immediate & slice_end) {
+        end = operand(next++);
+      }
+      outcome = slice(heap, operand(0), start, end);
+      break;
+    }
+    default:
+      break;
+    }
+
+    if (!outcome) {
+      return failWith(runtime,
+                      Error{Error::Kind::Runtime, outcome.error(), line});
+    }
+    *out = aot::toCell(*outcome);
+    return aot::Done;
+  }
+
+  // the entry of the function a call is made to, or nothing when
+  // the call fails, checked in the order the virtual machine does.
+  aot::FunctionEntry const *callee(Runtime &runtime, aot::Cell const &cell,
+                                   u32 arguments, u64 line,
+                                   bool tail) const {
+    Value value = aot::toValue(cell);
+    if (!value.isFunction()) {
+      failWith(runtime,
+               Error{Error::Kind::Runtime, "can only call functions", line});
+      return nullptr;
+    }
+
+    auto found = m_functions.find(value.object());
+    if (found == m_functions.end()) {
+      failWith(runtime,
+               Error{Error::Kind::Runtime,
+                     std::format("function '{:s}' is not part of the "
+                                 "native program",
+                                 value.function()->name()->view()),
+                     line});
+      return nullptr;
+    }
+
+    auto const &entry = m_module->functions[found->second];
+    if (entry.code == nullptr) {
+      failWith(runtime, Error{Error::Kind::Comptime, entry.error,
+                              entry.error_line == 0 ? line : entry.error_line});
+      return nullptr;
+    }
+    if (entry.arity != arguments) {
+      failWith(runtime,
+               Error{Error::Kind::Runtime,
+                     std::format("expected {:d} arguments but got {:d}",
+                                 entry.arity, arguments),
+                     line});
+      return nullptr;
+    }
+    if (!tail && runtime.depth == VirtualMachine::max_frames) {
+      failWith(runtime, Error{Error::Kind::Runtime, "stack overflow", line});
+      return nullptr;
+    }
+    return &entry;
+  }
+
+  static int call(aot::Context *context, aot::Cell const *window,
+                  u32 arguments, u64 line, aot::Cell *out) {
+    auto &runtime = runtimeOf(context);
+    auto *entry =
+        runtime.program->callee(runtime, window[0], arguments, line, false);
+    if (entry == nullptr) {
+      return aot::Failed;
+    }
+
+    // a tail call returns its window rather than calling, so the
+    // functions it chains through reuse the one native frame.
+    runtime.depth++;
+    int status = entry->code(context, window, out);
+    while (status == aot::Tail) {
+      entry = runtime.program->callee(runtime, runtime.tail[0],
+                                      runtime.tail_arguments,
+                                      runtime.tail_line, true);
+      status = entry == nullptr
+                   ? aot::Failed
+                   : entry->code(context, runtime.tail.data(), out);
+    }
+    runtime.depth--;
+    return status;
+  }
+
+  static int tail(aot::Context *context, aot::Cell const *window,
+                  u32 arguments, u64 line) {
+    auto &runtime = runtimeOf(context);
+    runtime.tail.assign(window, window + arguments + 1);
+    runtime.tail_arguments = arguments;
+    runtime.tail_line      = line;
+    return aot::Tail;
+  }
+
+  static int native(aot::Context *context, u32 index,
+                    aot::Cell const *arguments, u64 line, aot::Cell *out) {
+    auto         &runtime = runtimeOf(context);
+    auto         &vm      = *runtime.program->m_vm;
+    Native const &native  = vm.natives()[index];
+    runtime.arguments.clear();
+    for (size_t i = 0; i < native.arity; ++i) {
+      runtime.arguments.push_back(aot::toValue(arguments[i]));
+    }
+    auto outcome = native.function(vm.heap(), runtime.arguments);
+    if (!outcome) {
+      return failWith(runtime,
+                      Error{Error::Kind::Runtime, outcome.error(), line});
+    }
+    *out = aot::toCell(*outcome);
+    return aot::Done;
+  }
+
+  static constexpr aot::Api api{&fail, &operate, &call, &tail, &native};
+
+  static std::unexpected<Error> invalid(std::string_view path,
+                                        std::string_view why) {
+    return std::unexpected{Error{
+        Error::Kind::Verify,
+        std::format("native program [ {:s} ] {:s}", path, why), 0}};
+  }
+
+public:
+  // loads the shared object at the path, declaring its globals and
+  // creating its constants, or describes why it cannot run here.
+  static std::expected<NativeProgram, Error> load(std::string const &path,
+                                                  VirtualMachine    &vm) {
+    void *handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (handle == nullptr) {
+      return invalid(path, dlerror());
+    }
+    NativeProgram program{handle, vm};
+
+    auto const *module =
+        static_cast<aot::Module const *>(dlsym(handle, aot_symbol));
+    if (module == nullptr) {
+      return invalid(path, "is not a voyage program");
+    }
+    if (module->abi != aot_abi || module->size != sizeof(aot::Module)) {
+      return invalid(path, "was compiled for another version of voyage");
+    }
+    program.m_module = module;
+
+    auto &natives = vm.natives();
+    for (u32 index = 0; index < module->native_count; ++index) {
+      auto const &native = module->natives[index];
+      if (index >= natives.size() ||
+          natives[index].name->view() != native.name ||
+          natives[index].arity != native.arity) {
+        return invalid(path, std::format("refers to native '{:s}', which is "
+                                         "not defined here",
+                                         native.name));
+      }
+    }
+
+    // the same check as readArtifact, globals are only ever appended.
+    auto &globals = vm.globals();
+    auto &heap    = vm.heap();
+    if (module->global_count > Globals::max_slots) {
+      return invalid(path, "declares too many globals");
+    }
+    for (size_t slot = 0; slot < globals.size(); ++slot) {
+      if (slot >= module->global_count ||
+          globals.name(slot)->view() != module->globals[slot]) {
+        return invalid(path, "was compiled against other globals");
+      }
+    }
+    for (size_t slot = globals.size(); slot < module->global_count; ++slot) {
+      if (globals.declare(heap.intern(module->globals[slot])) != slot) {
+        return invalid(path, "was compiled against other globals");
+      }
+    }
+
+    std::vector<Function *> functions;
+    for (u32 index = 0; index < module->function_count; ++index) {
+      auto const &entry    = module->functions[index];
+      Function   *function = heap.function(heap.intern(entry.name));
+      function->setArity(entry.arity);
+      function->setDeclared(entry.declared);
+      function->defer("", entry.declared);
+      functions.push_back(function);
+      program.m_functions.emplace(function, index);
+    }
+
+    Constants roots;
+    for (u32 index = 0; index < module->constant_count; ++index) {
+      auto const &constant = module->constants[index];
+      Value       value{i64{0}};
+      switch (static_cast<aot::Tag>(constant.tag)) {
+      case aot::Tag::Integer:
+        value = Value{(i64)(constant.bits)};
+        break;
+      case aot::Tag::Real:
+        value = Value{std::bit_cast<f64>(constant.bits)};
+        break;
+      case aot::Tag::String:
+        value = Value{heap.intern({constant.text, constant.length})};
+        roots.write(value);
+        break;
+      case aot::Tag::Function:
+        if (constant.bits >= functions.size()) {
+          return invalid(path, "is damaged");
+        }
+        value = Value{functions[constant.bits]};
+        roots.write(value);
+        break;
+      case aot::Tag::Array: {
+        if (constant.bits != 0 && constant.elements == nullptr) {
+          return invalid(path, "is damaged");
+        }
+        Array *array = heap.array(constant.bits);
+        for (size_t i = 0; i < array->length(); ++i) {
+          array->data()[i] = std::bit_cast<f64>(constant.elements[i]);
+        }
+        value = Value{array};
+        roots.write(value);
+        break;
+      }
+      default:
+        return invalid(path, "is damaged");
+      }
+      program.m_constants.push_back(aot::toCell(value));
+    }
+    *program.m_roots = Bytecode{{}, std::move(roots), {}};
+    vm.retain(*program.m_roots);
+    return program;
+  }
+
+  // runs the top level code of the program, and returns its result,
+  // as interpreting it would.
+  std::expected<Value, Error> run() {
+    auto                  &globals = m_vm->globals();
+    std::vector<aot::Cell> cells(m_module->global_count);
+    for (size_t slot = 0; slot < cells.size(); ++slot) {
+      cells[slot] = aot::toCell(globals[slot]);
+    }
+
+    Runtime runtime;
+    runtime.program = this;
+
+    aot::Context context{&api, cells.data(), m_constants.data(), &runtime};
+    aot::Cell    out{};
+    int          status = m_module->entry(&context, nullptr, &out);
+
+    // the globals a failed run stored stay stored, as they would.
+    for (size_t slot = 0; slot < cells.size(); ++slot) {
+      globals[slot] = aot::toValue(cells[slot]);
+    }
+    if (status != aot::Done) {
+      return std::unexpected{runtime.error.value_or(
+          Error{Error::Kind::Runtime, "native program failed", 0})};
+    }
+    return aot::toValue(out);
+  }
+};
+} // namespace voyage
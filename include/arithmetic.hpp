@@ -0,0 +1,172 @@
+#pragma once
+#include <expected>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "heap.hpp"
+#include "instructions.hpp"
+#include "kernels.hpp"
+#include "value.hpp"
+
+namespace voyage {
+// integer operands produce an integer result unless the
+// operation overflows, in which case the result is promoted
+// to a double. any real operand makes the operation real.
+
+constexpr inline Value negate(Value a) noexcept {
+  if (a.isInteger()) {
+    i64 result = 0;
+    if (!__builtin_sub_overflow(i64{0}, a.integer(), &result)) {
+      return Value{result};
+    }
+  }
+  return Value{-a.toReal()};
+}
+
+constexpr inline Value add(Value a, Value b) noexcept {
+  if (a.isInteger() && b.isInteger()) {
+    i64 result = 0;
+    if (!__builtin_add_overflow(a.integer(), b.integer(), &result)) {
+      return Value{result};
+    }
+  }
+  return Value{a.toReal() + b.toReal()};
+}
+
+constexpr inline Value sub(Value a, Value b) noexcept {
+  if (a.isInteger() && b.isInteger()) {
+    i64 result = 0;
+    if (!__builtin_sub_overflow(a.integer(), b.integer(), &result)) {
+      return Value{result};
+    }
+  }
+  return Value{a.toReal() - b.toReal()};
+}
+
+constexpr inline Value mul(Value a, Value b) noexcept {
+  if (a.isInteger() && b.isInteger()) {
+    i64 result = 0;
+    if (!__builtin_mul_overflow(a.integer(), b.integer(), &result)) {
+      return Value{result};
+    }
+  }
+  return Value{a.toReal() * b.toReal()};
+}
+
+// #NOTE division is always real, 1 / 2 is 0.5
+constexpr inline Value div(Value a, Value b) noexcept {
+  return Value{a.toReal() / b.toReal()};
+}
+
+// the result of an operation on objects, or why it failed.
+using Outcome = std::expected<Value, std::string_view>;
+
+// the generic arithmetic of an instruction whose operands are not
+// both numbers. adding two strings concatenates them. arithmetic on
+// arrays is broadcast, two arrays of the same length are combined
+// element by element, and an array and a number combine the number
+// with each element. elements are real, so the result is an array
+// of reals.
+inline Outcome arithmetic(Heap &heap, Instruction instruction, Value a,
+                          Value b) {
+  if (instruction == Instruction::ADD && a.isString() && b.isString()) {
+    return Value{heap.concatenate(*a.string(), *b.string())};
+  }
+
+  bool operands = (a.isArray() || a.isNumber()) &&
+                  (b.isArray() || b.isNumber()) &&
+                  (a.isArray() || b.isArray());
+  if (!operands) {
+    return std::unexpected{instruction == Instruction::ADD
+                               ? "operands must be two numbers or two strings"
+                               : "operands must be numbers"};
+  }
+  if (a.isArray() && b.isArray() &&
+      a.array()->length() != b.array()->length()) {
+    return std::unexpected{"arrays must be of the same length"};
+  }
+
+  f64    lhs    = a.isNumber() ? a.toReal() : 0.0;
+  f64    rhs    = b.isNumber() ? b.toReal() : 0.0;
+  auto   x      = a.isArray() ? kernels::Operand{a.array()->data(), false}
+                              : kernels::Operand{&lhs, true};
+  auto   y      = b.isArray() ? kernels::Operand{b.array()->data(), false}
+                              : kernels::Operand{&rhs, true};
+  size_t length = a.isArray() ? a.array()->length() : b.array()->length();
+  Array *result = heap.array(length);
+  switch (instruction) {
+  case Instruction::ADD:
+    kernels::binary<kernels::Add>(result->data(), x, y, length);
+    break;
+  case Instruction::SUB:
+    kernels::binary<kernels::Sub>(result->data(), x, y, length);
+    break;
+  case Instruction::MUL:
+    kernels::binary<kernels::Mul>(result->data(), x, y, length);
+    break;
+  default:
+    kernels::binary<kernels::Div>(result->data(), x, y, length);
+    break;
+  }
+  return Value{result};
+}
+
+// the negation of an operand which is not a number.
+inline Outcome negation(Heap &heap, Value a) {
+  if (!a.isArray()) {
+    return std::unexpected{"operand must be a number"};
+  }
+  Array *result = heap.array(a.array()->length());
+  kernels::negate(result->data(), a.array()->data(), result->length());
+  return Value{result};
+}
+
+// an array of the given elements, each of which must be a number.
+inline Outcome arrayOf(Heap &heap, std::span<Value const> elements) {
+  for (Value const &element : elements) {
+    if (!element.isNumber()) {
+      return std::unexpected{"array elements must be numbers"};
+    }
+  }
+  Array *result = heap.array(elements.size());
+  for (size_t i = 0; i < elements.size(); ++i) {
+    result->data()[i] = elements[i].toReal();
+  }
+  return Value{result};
+}
+
+// the element of an array at an integer index.
+inline Outcome element(Value array, Value index) {
+  if (!array.isArray()) {
+    return std::unexpected{"can only index arrays"};
+  }
+  if (!index.isInteger()) {
+    return std::unexpected{"array index must be an integer"};
+  }
+  if (index.integer() < 0 ||
+      (u64)(index.integer()) >= array.array()->length()) {
+    return std::unexpected{"array index out of bounds"};
+  }
+  return Value{array.array()->data()[index.integer()]};
+}
+
+// the elements of an array from start up to end, without copying
+// them. a missing bound extends the range to that end of the array.
+inline Outcome slice(Heap &heap, Value array, std::optional<Value> start,
+                     std::optional<Value> end) {
+  if (!array.isArray()) {
+    return std::unexpected{"can only slice arrays"};
+  }
+  if ((start && !start->isInteger()) || (end && !end->isInteger())) {
+    return std::unexpected{"slice bounds must be integers"};
+  }
+  i64 length = (i64)(array.array()->length());
+  i64 from   = start ? start->integer() : 0;
+  i64 to     = end ? end->integer() : length;
+  if (from < 0 || to < from || to > length) {
+    return std::unexpected{"slice bounds out of range"};
+  }
+  return Value{heap.slice(*array.array(), (size_t)(from), (size_t)(to))};
+}
+} // namespace voyage
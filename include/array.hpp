@@ -0,0 +1,69 @@
+#pragma once
+#include <new>
+#include <span>
+
+#include "object.hpp"
+
+namespace voyage {
+// a contiguous run of doubles. an array either owns its elements,
+// which are aligned for the widest vector loads, or is a view onto
+// a range of the elements of the array which owns them, and keeps
+// that array alive. arrays are immutable once they are filled, so
+// a view never observes a change, and neither a slice nor the
+// constant of a literal is ever copied.
+class Array : public Object {
+public:
+  static constexpr size_t alignment = 32;
+
+private:
+  // nullptr when the array owns its elements.
+  Array *m_owner;
+  f64   *m_data;
+  size_t m_length;
+
+public:
+  // storage for the elements of an array of the given length.
+  static f64 *allocate(size_t length) {
+    if (length == 0) {
+      return nullptr;
+    }
+    return static_cast<f64 *>(::operator new(length * sizeof(f64),
+                                             std::align_val_t{alignment}));
+  }
+
+  // an array which owns the given elements, from allocate, which are
+  // left for the caller to fill.
+  //
+  // #NOTE the elements are allocated before the array, so that no
+  // call comes between writing the kind of the array and the heap
+  // reading it, which the compiler would assume might change it.
+  Array(f64 *elements, size_t length) noexcept
+      : Object(Kind::Array), m_owner(nullptr), m_data(elements),
+        m_length(length) {}
+
+  // a view of length elements of the given array, from start. a
+  // view of a view refers to the owner directly.
+  Array(Array &array, size_t start, size_t length) noexcept
+      : Object(Kind::Array),
+        m_owner(array.m_owner != nullptr ? array.m_owner : &array),
+        m_data(array.m_data + start), m_length(length) {}
+
+  ~Array() {
+    if (m_owner == nullptr && m_data != nullptr) {
+      ::operator delete(m_data, std::align_val_t{alignment});
+    }
+  }
+
+  [[nodiscard]] Array       *owner() const noexcept { return m_owner; }
+  [[nodiscard]] size_t       length() const noexcept { return m_length; }
+  [[nodiscard]] f64         *data() noexcept { return m_data; }
+  [[nodiscard]] f64 const   *data() const noexcept { return m_data; }
+  [[nodiscard]] std::span<f64 const> elements() const noexcept {
+    return {m_data, m_length};
+  }
+  // a view accounts only for itself, the elements belong to the owner.
+  [[nodiscard]] size_t bytes() const noexcept {
+    return sizeof(Array) + (m_owner == nullptr ? m_length * sizeof(f64) : 0);
+  }
+};
+} // namespace voyage
@@ -0,0 +1,346 @@
+#pragma once
+#include <bit>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "bytecode.hpp"
+#include "globals.hpp"
+#include "hash_map.hpp"
+#include "heap.hpp"
+#include "natives.hpp"
+
+#if !defined(VOYAGE_VERSION)
+#define VOYAGE_VERSION "unknown"
+#endif
+
+namespace voyage {
+// the compiled form of a script, as written to the compilation
+// cache. every integer is big endian. an artifact is
+//
+//   "voyage"      magic
+//   u32 format    artifact_format
+//   text version  of the compiler which wrote it
+//   text source   which was compiled
+//   u32 count     of globals, each of which is a text name
+//   u32 count     of natives, each a text name followed by a u8 arity
+//   chunk         the top level chunk
+//   u64 checksum  of everything before it
+//
+// where a text is a u32 length followed by its bytes, and a chunk
+// is its u64 length and bytes, its u64 count of line runs, each
+// a u64 length and line, then its u64 count of constants, each of
+// which is a u8 tag followed by
+//
+//   0 i64 | 1 f64 | 2 text
+//   3 text name, u64 declared line, u8 arity, u8 compiled, then a
+//     chunk when compiled, otherwise a u64 line and the text of the
+//     deferred body.
+//   4 u64 count of elements, each an f64
+//
+// the global slots and native indices a chunk refers to are
+// recorded by name, an artifact is only loaded where each name
+// resolves to the same slot or index it was compiled against.
+//
+// #NOTE bump the format whenever the layout of an artifact or
+// the encoding of an instruction changes.
+constexpr inline u32              artifact_format  = 4;
+constexpr inline std::string_view artifact_version = VOYAGE_VERSION;
+constexpr inline std::string_view artifact_magic   = "voyage";
+
+namespace artifact {
+enum class Tag : u8 { Integer, Real, String, Function, Array };
+
+class Writer {
+private:
+  std::string m_out;
+
+public:
+  void integer(u64 value, size_t bytes) {
+    for (size_t i = bytes; i > 0; --i) {
+      m_out.push_back((char)((value >> ((i - 1) * 8)) & 0xFF));
+    }
+  }
+
+  void text(std::string_view text) {
+    integer(text.size(), sizeof(u32));
+    m_out.append(text);
+  }
+
+  void array(Array const &array) {
+    integer(array.length(), sizeof(u64));
+    for (f64 element : array.elements()) {
+      integer(std::bit_cast<u64>(element), sizeof(u64));
+    }
+  }
+
+  void chunk(Bytecode const &bytecode) {
+    integer(bytecode.size(), sizeof(u64));
+    m_out.append(bytecode.begin(), bytecode.end());
+
+    auto const &runs = bytecode.lines().runs();
+    integer(runs.size(), sizeof(u64));
+    for (auto const &run : runs) {
+      integer(run.m_length, sizeof(u64));
+      integer(run.m_line, sizeof(u64));
+    }
+
+    integer(bytecode.constantCount(), sizeof(u64));
+    for (Value const &constant : bytecode.constants()) {
+      switch (constant.kind()) {
+      case Value::Kind::Integer:
+        integer(std::to_underlying(Tag::Integer), sizeof(u8));
+        integer((u64)(constant.integer()), sizeof(u64));
+        break;
+      case Value::Kind::Real:
+        integer(std::to_underlying(Tag::Real), sizeof(u8));
+        integer(std::bit_cast<u64>(constant.real()), sizeof(u64));
+        break;
+      case Value::Kind::Object:
+        if (constant.isString()) {
+          integer(std::to_underlying(Tag::String), sizeof(u8));
+          text(constant.string()->view());
+        } else if (constant.isArray()) {
+          integer(std::to_underlying(Tag::Array), sizeof(u8));
+          array(*constant.array());
+        } else {
+          auto const *function = constant.function();
+          integer(std::to_underlying(Tag::Function), sizeof(u8));
+          text(function->name()->view());
+          integer(function->declared(), sizeof(u64));
+          integer(function->arity(), sizeof(u8));
+          integer(function->compiled(), sizeof(u8));
+          if (function->compiled()) {
+            chunk(function->bytecode());
+          } else {
+            integer(function->line(), sizeof(u64));
+            text(function->source());
+          }
+        }
+        break;
+      }
+    }
+  }
+
+  // the bytes written, without a checksum.
+  std::string release() { return std::move(m_out); }
+
+  std::string finish() {
+    integer(hashBytes(m_out), sizeof(u64));
+    return std::move(m_out);
+  }
+};
+
+class Reader {
+private:
+  std::string_view m_data;
+  Heap            &m_heap;
+  bool             m_failed = false;
+
+public:
+  Reader(std::string_view data, Heap &heap) noexcept
+      : m_data(data), m_heap(heap) {}
+
+  [[nodiscard]] bool failed() const noexcept { return m_failed; }
+  [[nodiscard]] bool done() const noexcept { return m_data.empty(); }
+  [[nodiscard]] size_t remaining() const noexcept { return m_data.size(); }
+
+  u64 integer(size_t bytes) noexcept {
+    if (m_failed || m_data.size() < bytes) {
+      m_failed = true;
+      return 0;
+    }
+    u64 value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+      value = (value << 8) | (u8)(m_data[i]);
+    }
+    m_data.remove_prefix(bytes);
+    return value;
+  }
+
+  std::string_view bytes(u64 length) noexcept {
+    if (m_failed || m_data.size() < length) {
+      m_failed = true;
+      return {};
+    }
+    auto bytes = m_data.substr(0, length);
+    m_data.remove_prefix(length);
+    return bytes;
+  }
+
+  std::string_view text() noexcept { return bytes(integer(sizeof(u32))); }
+
+  // #NOTE the count is checked against what remains before the
+  // array is allocated, so a damaged count fails rather than
+  // allocating without bound.
+  Array *array() {
+    u64 count = integer(sizeof(u64));
+    if (m_failed || count > m_data.size() / sizeof(u64)) {
+      m_failed = true;
+      return nullptr;
+    }
+    Array *array = m_heap.array(count);
+    for (u64 i = 0; i < count; ++i) {
+      array->data()[i] = std::bit_cast<f64>(integer(sizeof(u64)));
+    }
+    return array;
+  }
+
+  std::optional<Bytecode> chunk() {
+    auto            code = bytes(integer(sizeof(u64)));
+    Bytecode::Chunk instructions{code.begin(), code.end()};
+
+    Bytecode::Lines lines;
+    u64             runs = integer(sizeof(u64));
+    for (u64 i = 0; i < runs && !m_failed; ++i) {
+      size_t length = integer(sizeof(u64));
+      size_t line   = integer(sizeof(u64));
+      lines.append({length, line});
+    }
+
+    Constants constants;
+    u64       count = integer(sizeof(u64));
+    for (u64 i = 0; i < count && !m_failed; ++i) {
+      switch (static_cast<Tag>(integer(sizeof(u8)))) {
+      case Tag::Integer:
+        constants.write(Value{(i64)(integer(sizeof(u64)))});
+        break;
+      case Tag::Real:
+        constants.write(Value{std::bit_cast<f64>(integer(sizeof(u64)))});
+        break;
+      case Tag::String:
+        constants.write(Value{m_heap.intern(text())});
+        break;
+      case Tag::Function: {
+        Function *function = m_heap.function(m_heap.intern(text()));
+        function->setDeclared(integer(sizeof(u64)));
+        function->setArity((u8)(integer(sizeof(u8))));
+        if (integer(sizeof(u8)) != 0) {
+          auto body = chunk();
+          if (!body) {
+            return std::nullopt;
+          }
+          function->bytecode() = std::move(*body);
+        } else {
+          size_t line = integer(sizeof(u64));
+          function->defer(text(), line);
+        }
+        constants.write(Value{function});
+        break;
+      }
+      case Tag::Array:
+        if (Array *elements = array()) {
+          constants.write(Value{elements});
+        }
+        break;
+      default:
+        m_failed = true;
+        break;
+      }
+    }
+
+    if (m_failed) {
+      return std::nullopt;
+    }
+    return Bytecode{std::move(instructions), std::move(constants),
+                    std::move(lines)};
+  }
+};
+} // namespace artifact
+
+// writes the artifact of the given source, which compiled to the
+// given chunk against the given globals and natives.
+inline std::string writeArtifact(std::string_view source,
+                                 Bytecode const &bytecode,
+                                 Globals const &globals,
+                                 Natives const &natives) {
+  artifact::Writer writer;
+  writer.text(artifact_magic);
+  writer.integer(artifact_format, sizeof(u32));
+  writer.text(artifact_version);
+  writer.text(source);
+
+  writer.integer(globals.size(), sizeof(u32));
+  for (String const *name : globals.names()) {
+    writer.text(name->view());
+  }
+
+  writer.integer(natives.size(), sizeof(u32));
+  for (Native const &native : natives.natives()) {
+    writer.text(native.name->view());
+    writer.integer(native.arity, sizeof(u8));
+  }
+
+  writer.chunk(bytecode);
+  return writer.finish();
+}
+
+// loads the chunk of an artifact, declaring its globals, or
+// returns nothing when the artifact is damaged, was written by
+// another version of the compiler, was compiled from another
+// source, or refers to a global or native which resolves
+// differently here. the chunk must be verified before it runs.
+inline std::optional<Bytecode> readArtifact(std::string_view data,
+                                            std::string_view source,
+                                            Heap &heap, Globals &globals,
+                                            Natives &natives) {
+  if (data.size() < sizeof(u64)) {
+    return std::nullopt;
+  }
+  auto body = data.substr(0, data.size() - sizeof(u64));
+  artifact::Reader checksum{data.substr(body.size()), heap};
+  if (checksum.integer(sizeof(u64)) != hashBytes(body)) {
+    return std::nullopt;
+  }
+
+  artifact::Reader reader{body, heap};
+  if (reader.text() != artifact_magic ||
+      reader.integer(sizeof(u32)) != artifact_format ||
+      reader.text() != artifact_version || reader.text() != source) {
+    return std::nullopt;
+  }
+
+  // globals are only ever appended, so the names are checked before
+  // any is declared, then declaring them in order reproduces the
+  // slots the artifact was compiled against.
+  u64 count = reader.integer(sizeof(u32));
+  if (count > Globals::max_slots) {
+    return std::nullopt;
+  }
+  std::vector<std::string_view> names;
+  for (u64 slot = 0; slot < count && !reader.failed(); ++slot) {
+    names.push_back(reader.text());
+  }
+  for (size_t slot = 0; slot < globals.size() && !reader.failed(); ++slot) {
+    if (slot >= names.size() || globals.name(slot)->view() != names[slot]) {
+      return std::nullopt;
+    }
+  }
+
+  count = reader.integer(sizeof(u32));
+  for (u64 index = 0; index < count && !reader.failed(); ++index) {
+    auto name  = reader.text();
+    auto arity = reader.integer(sizeof(u8));
+    if (index >= natives.size() || natives[index].name->view() != name ||
+        natives[index].arity != arity) {
+      return std::nullopt;
+    }
+  }
+
+  if (reader.failed()) {
+    return std::nullopt;
+  }
+
+  auto bytecode = reader.chunk();
+  if (!bytecode || !reader.done()) {
+    return std::nullopt;
+  }
+
+  for (size_t slot = globals.size(); slot < names.size(); ++slot) {
+    if (globals.declare(heap.intern(names[slot])) != slot) {
+      return std::nullopt;
+    }
+  }
+  return bytecode;
+}
+} // namespace voyage
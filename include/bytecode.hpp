@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #include <cassert>
 #include <format>
 #include <ostream>
@@ -6,12 +7,16 @@
 
 #include "common.hpp"
 #include "constants.hpp"
+#include "feedback.hpp"
 #include "instructions.hpp"
+#include "memory.hpp"
 
 namespace voyage {
 class Bytecode {
 public:
-  using Chunk           = std::vector<u8>;
+  using Chunk           = std::vector<u8, Counted<u8, Subsystem::Chunk>>;
+  using Counts          = std::vector<u64, Counted<u64, Subsystem::Profile>>;
+  using Slots           = std::vector<u32, Counted<u32, Subsystem::Chunk>>;
   using iterator        = Chunk::iterator;
   using pointer         = Chunk::pointer;
   using reference       = Chunk::reference;
@@ -26,8 +31,10 @@ public:
       size_t m_line;
     };
 
+    using Runs = std::vector<Run, Counted<Run, Subsystem::Lines>>;
+
   private:
-    std::vector<Run> m_runs;
+    Runs m_runs;
 
   public:
     void add(size_t line) noexcept {
@@ -41,6 +48,12 @@ public:
       m_runs.emplace_back(Run{1, line});
     }
 
+    void append(Run run) { m_runs.push_back(run); }
+
+    [[nodiscard]] Runs const &runs() const noexcept {
+      return m_runs;
+    }
+
     // each time we insert an instruction, we add it's line
     // to the run length encoding. thus, given an
     // instruction offset, the line that instruction appears
@@ -52,10 +65,10 @@ public:
       size_t i = 0;
       for (auto &run : m_runs) {
         i += run.m_length;
-        // the first time i is greater than or equal to the offset
-        // we know that the instruction appears on the line
-        // represented by that run.
-        if (i >= instruction_offset) {
+        // the first time i is greater than the offset we know
+        // that the instruction appears on the line represented
+        // by that run.
+        if (i > instruction_offset) {
           return run.m_line;
         }
       }
@@ -70,16 +83,33 @@ private:
   Chunk m_chunk;
   Constants m_constants;
   Lines m_lines;
+  Feedback m_feedback;
+  // the number of times each instruction was executed, indexed by
+  // offset, only counted by profiling builds.
+  Counts m_counts;
+  // set once the verifier has accepted the chunk, and
+  // cleared again by any write which follows.
+  bool m_verified    = false;
+  size_t m_max_depth = 0;
+  // the offset of the most recently written instruction.
+  size_t m_last = 0;
+  // the split layout of a verified chunk, see layout.
+  Chunk m_opcodes;
+  Slots m_operands;
+  Slots m_offsets;
 
   size_t addConstant(Value value) { return m_constants.write(value); }
 
   void write(u8 byte, size_t line) {
     m_chunk.push_back(byte);
     m_lines.add(line);
+    m_verified = false;
   }
   void write(Instruction instruction, size_t line) {
+    m_last = m_chunk.size();
     m_chunk.push_back(std::to_underlying(instruction));
     m_lines.add(line);
+    m_verified = false;
   }
 
   void writeImmediate(size_t immediate, size_t bytes, size_t line) {
@@ -94,6 +124,16 @@ private:
   }
 
 public:
+  Bytecode() noexcept = default;
+
+  // rebuilds a chunk which was written out earlier. the chunk
+  // is not verified, whatever wrote it is not trusted.
+  Bytecode(Chunk chunk, Constants constants, Lines lines) noexcept
+      : m_chunk(std::move(chunk)), m_constants(std::move(constants)),
+        m_lines(std::move(lines)) {}
+
+  Lines const &lines() const noexcept { return m_lines; }
+
   size_t getLine(iterator i) const noexcept {
     return getLine((size_t)(i - begin()));
   }
@@ -109,8 +149,89 @@ public:
     return m_constants[position];
   }
 
+  size_t constantCount() const noexcept { return m_constants.size(); }
+  Constants const &constants() const noexcept { return m_constants; }
+
+  Counts const &counts() const noexcept { return m_counts; }
+  void count(size_t offset) {
+    if (offset >= m_counts.size()) {
+      m_counts.resize(size());
+    }
+    m_counts[offset]++;
+  }
+
+  Feedback &feedback() noexcept { return m_feedback; }
+  Feedback const &feedback() const noexcept { return m_feedback; }
+
+  // rewrites the instruction at offset in place. the replacement
+  // must take the same immediates and have the same stack effect
+  // as the original, so that a verified chunk stays verified.
+  void patch(size_t offset, Instruction instruction) noexcept {
+    assert(offset < size());
+    assert(immediateBytes(static_cast<Instruction>(m_chunk[offset])) ==
+           immediateBytes(instruction));
+    m_chunk[offset] = std::to_underlying(instruction);
+    // the split layout is stale until the chunk is verified again.
+    if (m_verified && !m_offsets.empty()) {
+      auto slot = std::ranges::lower_bound(m_offsets, offset);
+      m_opcodes[(size_t)(slot - m_offsets.begin())] = m_chunk[offset];
+    }
+  }
+
   bool empty() const noexcept { return m_chunk.empty(); }
   size_t size() const noexcept { return m_chunk.size(); }
+  size_t lastOffset() const noexcept { return m_last; }
+
+  bool verified() const noexcept { return m_verified; }
+  // the deepest the stack grows while executing this chunk,
+  // only meaningful once the chunk is verified.
+  size_t maxDepth() const noexcept { return m_max_depth; }
+  void markVerified(size_t max_depth) {
+    m_verified  = true;
+    m_max_depth = max_depth;
+#if defined(VOYAGE_SPLIT_CHUNK)
+    layout();
+#endif
+  }
+
+  // lays the chunk out again as two streams, its opcodes, one byte
+  // per instruction, and beside them an aligned u32 slot for each
+  // instruction which holds its immediate, if it has one. more of
+  // the opcodes fit in a cache line, and an immediate is a single
+  // load rather than one per byte. the offset of each instruction
+  // within the chunk is kept as well, for lines and feedback.
+  //
+  // #NOTE the chunk must be verified, so that it decodes. a chunk
+  // never holds anywhere near 4GiB of instructions, nor that many
+  // constants, so every offset and immediate fits a slot.
+  void layout() {
+    m_opcodes.clear();
+    m_operands.clear();
+    m_offsets.clear();
+    for (size_t offset = 0; offset < size();) {
+      auto   instruction = static_cast<Instruction>(m_chunk[offset]);
+      size_t bytes       = immediateBytes(instruction);
+      m_opcodes.push_back(m_chunk[offset]);
+      m_operands.push_back(
+          bytes == 0 ? 0 : (u32)(readImmediate(offset + 1, bytes)));
+      m_offsets.push_back((u32)(offset));
+      offset += 1 + bytes;
+    }
+  }
+
+  // the first opcode of the split layout.
+  [[nodiscard]] iterator opcodes() noexcept { return m_opcodes.begin(); }
+
+  // the immediate of the instruction whose opcode is at i.
+  [[nodiscard]] size_t operand(const_iterator i) const noexcept {
+    return m_operands[(size_t)(i - m_opcodes.begin())];
+  }
+
+  // the offset within the chunk of the instruction whose opcode is
+  // at i, in the split layout.
+  [[nodiscard]] size_t offsetOf(const_iterator i) const noexcept {
+    return m_offsets[(size_t)(i - m_opcodes.begin())];
+  }
 
   size_t readImmediate(iterator i, size_t bytes) const noexcept {
     return readImmediate((size_t)(i - begin()), bytes);
@@ -151,6 +272,16 @@ public:
 
   void emitReturn(size_t line) { write(Instruction::RETURN, line); }
 
+  void emitCall(size_t arguments, size_t line) {
+    write(Instruction::CALL, line);
+    writeImmediate(arguments, sizeof(u8), line);
+  }
+
+  void emitCallNative(size_t index, size_t line) {
+    write(Instruction::CALL_NATIVE, line);
+    writeImmediate(index, sizeof(u16), line);
+  }
+
   void emitConstant(Value value, size_t line) {
     size_t index = addConstant(value);
     if (index <= UINT8_MAX) {
@@ -168,21 +299,63 @@ public:
     }
   }
 
+  void emitPop(size_t line) { write(Instruction::POP, line); }
+
+  void emitGetLocal(size_t slot, size_t line) {
+    write(Instruction::GET_LOCAL, line);
+    writeImmediate(slot, sizeof(u8), line);
+  }
+  void emitSetLocal(size_t slot, size_t line) {
+    write(Instruction::SET_LOCAL, line);
+    writeImmediate(slot, sizeof(u8), line);
+  }
+  void emitGetGlobal(size_t slot, size_t line) {
+    write(Instruction::GET_GLOBAL, line);
+    writeImmediate(slot, sizeof(u16), line);
+  }
+  void emitSetGlobal(size_t slot, size_t line) {
+    write(Instruction::SET_GLOBAL, line);
+    writeImmediate(slot, sizeof(u16), line);
+  }
+  void emitDefineGlobal(size_t slot, size_t line) {
+    write(Instruction::DEFINE_GLOBAL, line);
+    writeImmediate(slot, sizeof(u16), line);
+  }
+
   void emitNegate(size_t line) { write(Instruction::NEGATE, line); }
   void emitAdd(size_t line) { write(Instruction::ADD, line); }
   void emitSub(size_t line) { write(Instruction::SUB, line); }
   void emitMul(size_t line) { write(Instruction::MUL, line); }
   void emitDiv(size_t line) { write(Instruction::DIV, line); }
+  void emitAddInt(size_t line) { write(Instruction::ADD_INT, line); }
+  void emitSubInt(size_t line) { write(Instruction::SUB_INT, line); }
+  void emitMulInt(size_t line) { write(Instruction::MUL_INT, line); }
+
+  void emitArray(size_t count, size_t line) {
+    write(Instruction::ARRAY, line);
+    writeImmediate(count, sizeof(u16), line);
+  }
+  void emitIndex(size_t line) { write(Instruction::INDEX, line); }
+  void emitSlice(u8 bounds, size_t line) {
+    write(Instruction::SLICE, line);
+    writeImmediate(bounds, sizeof(u8), line);
+  }
+
+  void emitJoin(size_t line) { write(Instruction::JOIN, line); }
+  void emitChannel(size_t line) { write(Instruction::CHANNEL, line); }
+  void emitSend(size_t line) { write(Instruction::SEND, line); }
+  void emitReceive(size_t line) { write(Instruction::RECEIVE, line); }
 };
 
-size_t print_simple(std::ostream &out, const char *name,
-                    size_t offset) noexcept {
+inline size_t print_simple(std::ostream &out, const char *name,
+                           size_t offset) noexcept {
   out << std::format("{}\n", name);
   return offset + 1;
 }
 
-size_t print_constant(std::ostream &out, const char *name,
-                      Bytecode const &bytecode, size_t offset, size_t bytes) {
+inline size_t print_constant(std::ostream &out, const char *name,
+                             Bytecode const &bytecode, size_t offset,
+                             size_t bytes) {
   size_t index = bytecode.readImmediate(offset + 1, bytes);
   out << std::format("{:16s} {:4d} '", name, index);
   print(out, bytecode.constantAt(index));
@@ -190,13 +363,28 @@ size_t print_constant(std::ostream &out, const char *name,
   return offset + 1 + bytes;
 }
 
-size_t print_dispatch(std::ostream &out, Bytecode const &bytecode,
-                      size_t offset) noexcept {
+inline size_t print_slot(std::ostream &out, const char *name,
+                         Bytecode const &bytecode, size_t offset,
+                         size_t bytes) {
+  size_t slot = bytecode.readImmediate(offset + 1, bytes);
+  out << std::format("{:16s} {:4d}\n", name, slot);
+  return offset + 1 + bytes;
+}
+
+inline size_t print_dispatch(std::ostream &out, Bytecode const &bytecode,
+                             size_t offset) noexcept {
   auto instruction = static_cast<Instruction>(bytecode[offset]);
   switch (instruction) {
   case Instruction::RETURN:
     return print_simple(out, "RETURN", offset);
 
+  case Instruction::CALL:
+    return print_slot(out, "CALL", bytecode, offset, sizeof(u8));
+  case Instruction::TAIL_CALL:
+    return print_slot(out, "TAIL_CALL", bytecode, offset, sizeof(u8));
+  case Instruction::CALL_NATIVE:
+    return print_slot(out, "CALL_NATIVE", bytecode, offset, sizeof(u16));
+
   case Instruction::CONSTANT_U8:
     return print_constant(out, "CONSTANT_U8", bytecode, offset, sizeof(u8));
   case Instruction::CONSTANT_U16:
@@ -206,6 +394,20 @@ size_t print_dispatch(std::ostream &out, Bytecode const &bytecode,
   case Instruction::CONSTANT_U64:
     return print_constant(out, "CONSTANT_U64", bytecode, offset, sizeof(u64));
 
+  case Instruction::POP:
+    return print_simple(out, "POP", offset);
+
+  case Instruction::GET_LOCAL:
+    return print_slot(out, "GET_LOCAL", bytecode, offset, sizeof(u8));
+  case Instruction::SET_LOCAL:
+    return print_slot(out, "SET_LOCAL", bytecode, offset, sizeof(u8));
+  case Instruction::GET_GLOBAL:
+    return print_slot(out, "GET_GLOBAL", bytecode, offset, sizeof(u16));
+  case Instruction::SET_GLOBAL:
+    return print_slot(out, "SET_GLOBAL", bytecode, offset, sizeof(u16));
+  case Instruction::DEFINE_GLOBAL:
+    return print_slot(out, "DEFINE_GLOBAL", bytecode, offset, sizeof(u16));
+
   case Instruction::NEGATE:
     return print_simple(out, "NEGATE", offset);
 
@@ -218,18 +420,52 @@ size_t print_dispatch(std::ostream &out, Bytecode const &bytecode,
   case Instruction::DIV:
     return print_simple(out, "DIV", offset);
 
+  case Instruction::ADD_INT:
+    return print_simple(out, "ADD_INT", offset);
+  case Instruction::SUB_INT:
+    return print_simple(out, "SUB_INT", offset);
+  case Instruction::MUL_INT:
+    return print_simple(out, "MUL_INT", offset);
+
+  case Instruction::ADD_REAL:
+    return print_simple(out, "ADD_REAL", offset);
+  case Instruction::SUB_REAL:
+    return print_simple(out, "SUB_REAL", offset);
+  case Instruction::MUL_REAL:
+    return print_simple(out, "MUL_REAL", offset);
+  case Instruction::DIV_REAL:
+    return print_simple(out, "DIV_REAL", offset);
+
+  case Instruction::ARRAY:
+    return print_slot(out, "ARRAY", bytecode, offset, sizeof(u16));
+  case Instruction::INDEX:
+    return print_simple(out, "INDEX", offset);
+  case Instruction::SLICE:
+    return print_slot(out, "SLICE", bytecode, offset, sizeof(u8));
+
+  case Instruction::SPAWN:
+    return print_slot(out, "SPAWN", bytecode, offset, sizeof(u8));
+  case Instruction::JOIN:
+    return print_simple(out, "JOIN", offset);
+  case Instruction::CHANNEL:
+    return print_simple(out, "CHANNEL", offset);
+  case Instruction::SEND:
+    return print_simple(out, "SEND", offset);
+  case Instruction::RECEIVE:
+    return print_simple(out, "RECEIVE", offset);
+
   default:
     assert(false && "unreachable");
   }
 }
 
-size_t print_instruction(std::ostream &out, Bytecode const &bytecode,
-                         size_t offset) {
+inline size_t print_instruction(std::ostream &out, Bytecode const &bytecode,
+                                size_t offset) {
   out << std::format("{:04d} {:4d} ", offset, bytecode.getLine(offset));
   return print_dispatch(out, bytecode, offset);
 }
 
-void print(std::ostream &out, Bytecode const &bytecode) noexcept {
+inline void print(std::ostream &out, Bytecode const &bytecode) noexcept {
 
   size_t prev_line = 0;
   auto instruction = [&](size_t offset) -> size_t {
@@ -255,7 +491,8 @@ void print(std::ostream &out, Bytecode const &bytecode) noexcept {
   }
 }
 
-std::ostream &operator<<(std::ostream &out, Bytecode const &bytecode) noexcept {
+inline std::ostream &operator<<(std::ostream   &out,
+                                Bytecode const &bytecode) noexcept {
   print(out, bytecode);
   return out;
 }
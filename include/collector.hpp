@@ -0,0 +1,455 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <format>
+#include <ostream>
+#include <vector>
+
+#include "array.hpp"
+#include "common.hpp"
+#include "fiber.hpp"
+#include "function.hpp"
+#include "memory.hpp"
+#include "object.hpp"
+#include "value.hpp"
+
+namespace voyage {
+// an incremental mark-sweep collector. a cycle begins once the
+// live heap passes a threshold, and then advances a little at each
+// safepoint the virtual machine reaches, each step running for
+// about the configured pause target.
+//
+// marking is tri-color. objects allocated while marking are made
+// Gray, so anything they come to reference before marking ends is
+// still traced. once the gray stack empties the roots are scanned
+// again and drained without a deadline, which accounts for values
+// the mutator moved onto the stack in the meantime. the stack has
+// no write barrier, so that remark, and the scan of the roots which
+// begins a cycle, run to completion whatever the pause target, and
+// their pauses are reported apart. the weak intern table then drops
+// the strings left White a slice at a time, objects allocated in
+// the meantime are made Black.
+//
+// sweeping is lazy. the object list is detached and walked a slice
+// at a time, survivors are whitened and relinked, and objects
+// allocated during the sweep go straight onto the live list.
+class Collector {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  enum class Phase : u8 {
+    Idle,
+    Mark,
+    Weak,
+    Sweep,
+  };
+
+  struct Config {
+    // the longest a single step may run for, other than the scans
+    // of the roots.
+    std::chrono::nanoseconds pause_target = std::chrono::microseconds{500};
+    // the live heap size at which the first cycle begins.
+    size_t initial_threshold = 1 << 20;
+    // after a cycle, the next one begins once the live heap
+    // has grown by this factor.
+    size_t growth_factor = 2;
+  };
+
+  struct Stats {
+    // pauses[i] counts the steps which took less than 2^i
+    // microseconds, the last bucket counts everything longer.
+    static constexpr size_t buckets = 24;
+
+    u64                      cycles            = 0;
+    u64                      steps             = 0;
+    u64                      objects_allocated = 0;
+    u64                      objects_freed     = 0;
+    u64                      bytes_allocated   = 0;
+    u64                      bytes_freed       = 0;
+    size_t                   live_bytes        = 0;
+    size_t                   peak_bytes        = 0;
+    size_t                   threshold         = 0;
+    std::chrono::nanoseconds total_pause{0};
+    std::chrono::nanoseconds max_pause{0};
+    std::array<u64, buckets> pauses{};
+    // the scans of the roots, and the drains which follow them at
+    // remark, which the pauses above include.
+    u64                      remarks = 0;
+    std::chrono::nanoseconds total_remark{0};
+    std::chrono::nanoseconds max_remark{0};
+  };
+
+private:
+  // the number of objects processed between checks of the clock.
+  static constexpr size_t slice = 64;
+
+  Config               m_config;
+  Stats                m_stats;
+  Phase                m_phase   = Phase::Idle;
+  Object              *m_objects = nullptr;
+  Object              *m_unswept = nullptr;
+  std::vector<Object *> m_gray;
+
+  static size_t bytesOf(Object const *object) noexcept {
+    switch (object->kind()) {
+    case Object::Kind::String:
+      return static_cast<String const *>(object)->bytes();
+
+    // #NOTE the chunk is compiled after the function is allocated,
+    // so only the fixed size is accounted, to keep it stable.
+    case Object::Kind::Function:
+      return sizeof(Function);
+
+    case Object::Kind::Array:
+      return static_cast<Array const *>(object)->bytes();
+
+    // #NOTE the strand of a fiber is accounted to the stack and the
+    // frames, as it is while it runs.
+    case Object::Kind::Fiber:
+      return sizeof(Fiber);
+
+    case Object::Kind::Channel:
+      return static_cast<Channel const *>(object)->bytes();
+
+    default:
+      std::unreachable();
+    }
+  }
+
+  static void destroy(Object *object) noexcept {
+    memory::freed(Subsystem::Objects, bytesOf(object));
+    switch (object->kind()) {
+    case Object::Kind::String:
+      delete static_cast<String *>(object);
+      break;
+
+    case Object::Kind::Function:
+      delete static_cast<Function *>(object);
+      break;
+
+    case Object::Kind::Array:
+      delete static_cast<Array *>(object);
+      break;
+
+    case Object::Kind::Fiber:
+      delete static_cast<Fiber *>(object);
+      break;
+
+    case Object::Kind::Channel:
+      delete static_cast<Channel *>(object);
+      break;
+
+    default:
+      std::unreachable();
+    }
+  }
+
+  static void destroyAll(Object *object) noexcept {
+    while (object != nullptr) {
+      Object *next = object->next();
+      destroy(object);
+      object = next;
+    }
+  }
+
+  // marks every object referenced by the given object.
+  void trace(Object *object) {
+    switch (object->kind()) {
+    case Object::Kind::String:
+      break;
+
+    case Object::Kind::Function: {
+      auto *function = static_cast<Function *>(object);
+      mark(function->name());
+      for (Value const &value : function->bytecode().constants()) {
+        mark(value);
+      }
+      break;
+    }
+
+    // a view keeps the array which owns its elements alive.
+    case Object::Kind::Array:
+      if (auto *owner = static_cast<Array *>(object)->owner()) {
+        mark(owner);
+      }
+      break;
+
+    case Object::Kind::Fiber: {
+      auto *fiber = static_cast<Fiber *>(object);
+      mark(fiber->strand());
+      mark(fiber->result());
+      fiber->joiners().forEach([this](Fiber *joiner) { mark(joiner); });
+      break;
+    }
+
+    case Object::Kind::Channel:
+      static_cast<Channel *>(object)->forEach(
+          [this](Value const &value) { mark(value); },
+          [this](Fiber *blocked) { mark(blocked); });
+      break;
+
+    default:
+      std::unreachable();
+    }
+  }
+
+  // returns true once the gray stack is empty.
+  bool drain(Clock::time_point deadline) {
+    while (!m_gray.empty()) {
+      for (size_t i = 0; (i < slice) && !m_gray.empty(); ++i) {
+        Object *object = m_gray.back();
+        m_gray.pop_back();
+        object->setColor(Object::Color::Black);
+        trace(object);
+      }
+
+      if (Clock::now() >= deadline) {
+        return m_gray.empty();
+      }
+    }
+    return true;
+  }
+
+  // returns true once every unswept object has been visited.
+  bool sweep(Clock::time_point deadline) noexcept {
+    while (m_unswept != nullptr) {
+      for (size_t i = 0; (i < slice) && (m_unswept != nullptr); ++i) {
+        Object *object = m_unswept;
+        m_unswept      = object->next();
+
+        if (object->color() == Object::Color::White) {
+          size_t bytes           = bytesOf(object);
+          m_stats.live_bytes    -= bytes;
+          m_stats.bytes_freed   += bytes;
+          m_stats.objects_freed += 1;
+          destroy(object);
+        } else {
+          object->setColor(Object::Color::White);
+          object->setNext(m_objects);
+          m_objects = object;
+        }
+      }
+
+      if (Clock::now() >= deadline) {
+        return m_unswept == nullptr;
+      }
+    }
+    return true;
+  }
+
+  void record(std::chrono::nanoseconds pause) noexcept {
+    auto micros = (u64)(
+        std::chrono::duration_cast<std::chrono::microseconds>(pause).count());
+    size_t bucket = std::min((size_t)(std::bit_width(micros)),
+                             Stats::buckets - 1);
+    m_stats.pauses[bucket] += 1;
+    m_stats.steps          += 1;
+    m_stats.total_pause    += pause;
+    m_stats.max_pause       = std::max(m_stats.max_pause, pause);
+  }
+
+  // scans the roots, and at remark drains what they reach.
+  template <class Roots> void remark(Roots &roots, bool drained) {
+    auto start = Clock::now();
+    roots(*this);
+    if (drained) {
+      drain(Clock::time_point::max());
+    }
+
+    auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start);
+    m_stats.remarks      += 1;
+    m_stats.total_remark += pause;
+    m_stats.max_remark    = std::max(m_stats.max_remark, pause);
+  }
+
+public:
+  Collector() noexcept { m_stats.threshold = m_config.initial_threshold; }
+  Collector(Collector const &)            = delete;
+  Collector &operator=(Collector const &) = delete;
+  ~Collector() noexcept {
+    destroyAll(m_objects);
+    destroyAll(m_unswept);
+  }
+
+  [[nodiscard]] Phase         phase() const noexcept { return m_phase; }
+  [[nodiscard]] Stats const  &stats() const noexcept { return m_stats; }
+  [[nodiscard]] Config const &config() const noexcept { return m_config; }
+  void                        configure(Config config) noexcept {
+    m_config          = config;
+    m_stats.threshold = std::max(m_stats.threshold, config.initial_threshold);
+  }
+
+  // true when a cycle is in progress, or should begin.
+  [[nodiscard]] bool pending() const noexcept {
+    return (m_phase != Phase::Idle) ||
+           (m_stats.live_bytes >= m_stats.threshold);
+  }
+
+  // takes ownership of a newly allocated object.
+  void track(Object *object) {
+    size_t bytes = bytesOf(object);
+    object->setNext(m_objects);
+    m_objects = object;
+
+    if (m_phase == Phase::Mark) {
+      object->setColor(Object::Color::Gray);
+      m_gray.push_back(object);
+    } else if (m_phase == Phase::Weak) {
+      object->setColor(Object::Color::Black);
+    } else {
+      object->setColor(Object::Color::White);
+    }
+
+    memory::allocated(Subsystem::Objects, bytes);
+    m_stats.objects_allocated += 1;
+    m_stats.bytes_allocated   += bytes;
+    m_stats.live_bytes        += bytes;
+    m_stats.peak_bytes = std::max(m_stats.peak_bytes, m_stats.live_bytes);
+  }
+
+  void mark(Object *object) {
+    if (object->color() == Object::Color::White) {
+      object->setColor(Object::Color::Gray);
+      m_gray.push_back(object);
+    }
+  }
+
+  void mark(Value const &value) {
+    if (value.isObject()) {
+      mark(value.object());
+    }
+  }
+
+  // the values on a stack, and what each frame runs, its function,
+  // or the constants of top level code.
+  void mark(Stack<Value> const &stack, Frames const &frames,
+            size_t frame_count) {
+    for (Value const &value : stack) {
+      mark(value);
+    }
+    for (size_t i = 0; i < frame_count; ++i) {
+      Frame const &frame = frames[i];
+      if (frame.function != nullptr) {
+        mark(frame.function);
+        continue;
+      }
+
+      for (Value const &value : frame.bytecode->constants()) {
+        mark(value);
+      }
+    }
+  }
+
+  void mark(Strand const &strand) {
+    mark(strand.stack, strand.frames, strand.frame_count);
+  }
+
+  // an object found through a weak table, which the mutator may
+  // then reach again. once marking has ended a White object in
+  // the table is only alive until the table drops it.
+  //
+  // #NOTE only a String may be revived, it references nothing.
+  void revive(Object *object) noexcept {
+    if (m_phase == Phase::Weak && object->color() == Object::Color::White) {
+      object->setColor(Object::Color::Black);
+    }
+  }
+
+  // an object which has been traced, and then gains references
+  // to other objects, must be traced again.
+  void barrier(Object *object) {
+    if (m_phase == Phase::Mark && object->color() == Object::Color::Black) {
+      object->setColor(Object::Color::Gray);
+      m_gray.push_back(object);
+    }
+  }
+
+  // advances the current cycle by about one pause target, or for
+  // as long as the roots take to scan. roots(collector) must mark
+  // every root, weak(deadline) must remove White objects from weak
+  // tables until the deadline, returning true once none remain.
+  template <class Roots, class Weak> void step(Roots &&roots, Weak &&weak) {
+    auto start    = Clock::now();
+    auto deadline = start + m_config.pause_target;
+
+    do {
+      switch (m_phase) {
+      case Phase::Idle: {
+        m_stats.cycles += 1;
+        m_phase         = Phase::Mark;
+        remark(roots, false);
+        break;
+      }
+
+      case Phase::Mark: {
+        if (drain(deadline)) {
+          remark(roots, true);
+          m_phase = Phase::Weak;
+        }
+        break;
+      }
+
+      case Phase::Weak: {
+        if (weak(deadline)) {
+          m_unswept = m_objects;
+          m_objects = nullptr;
+          m_phase   = Phase::Sweep;
+        }
+        break;
+      }
+
+      case Phase::Sweep: {
+        if (sweep(deadline)) {
+          m_stats.threshold =
+              std::max(m_config.initial_threshold,
+                       m_stats.live_bytes * m_config.growth_factor);
+          m_phase = Phase::Idle;
+        }
+        break;
+      }
+      }
+    } while ((m_phase != Phase::Idle) && (Clock::now() < deadline));
+
+    record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                                start));
+  }
+};
+
+inline void print(std::ostream &out, Collector::Stats const &stats) {
+  out << std::format("cycles {:d}, steps {:d}\n", stats.cycles, stats.steps);
+  out << std::format("allocated {:d} objects, {:d} bytes\n",
+                     stats.objects_allocated, stats.bytes_allocated);
+  out << std::format("freed {:d} objects, {:d} bytes\n", stats.objects_freed,
+                     stats.bytes_freed);
+  out << std::format("live {:d} bytes, peak {:d} bytes, threshold {:d} bytes\n",
+                     stats.live_bytes, stats.peak_bytes, stats.threshold);
+  out << std::format("pause total {:d}us, max {:d}us\n",
+                     std::chrono::duration_cast<std::chrono::microseconds>(
+                         stats.total_pause)
+                         .count(),
+                     std::chrono::duration_cast<std::chrono::microseconds>(
+                         stats.max_pause)
+                         .count());
+  out << std::format("remark {:d}, total {:d}us, max {:d}us\n", stats.remarks,
+                     std::chrono::duration_cast<std::chrono::microseconds>(
+                         stats.total_remark)
+                         .count(),
+                     std::chrono::duration_cast<std::chrono::microseconds>(
+                         stats.max_remark)
+                         .count());
+  for (size_t i = 0; i < Collector::Stats::buckets; ++i) {
+    if (stats.pauses[i] != 0) {
+      out << std::format("  < {:8d}us {:d}\n", (u64{1} << i), stats.pauses[i]);
+    }
+  }
+}
+
+inline std::ostream &operator<<(std::ostream           &out,
+                                Collector::Stats const &stats) {
+  print(out, stats);
+  return out;
+}
+} // namespace voyage
@@ -0,0 +1,265 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include "artifact.hpp"
+
+namespace voyage {
+// a directory of compiled scripts, each stored in a file named by
+// the hash of the compiler version and the source, so a script is
+// parsed once and loaded on every later run until it changes.
+//
+// an artifact is written to a temporary file which is then renamed
+// into place, so concurrent writers of the same script each rename
+// a complete artifact over the other, and a reader never sees a
+// partial one. any artifact which fails to load is treated as a
+// miss, and is replaced by the next store.
+//
+// the artifacts are evicted, least recently used first, whenever a
+// store grows them beyond the capacity. a hit refreshes the
+// modification time of its file. the directory may hold other
+// files, which are neither counted nor evicted, nor are temporary
+// files unless a writer left them behind long ago.
+class CompileCache {
+public:
+  struct Statistics {
+    size_t hits      = 0;
+    size_t misses    = 0;
+    size_t stores    = 0;
+    size_t evictions = 0;
+  };
+
+  static constexpr u64 default_capacity = 64 * 1024 * 1024;
+
+private:
+  std::filesystem::path m_directory;
+  u64                   m_capacity;
+  Statistics            m_statistics;
+
+  static constexpr std::string_view extension = ".voyc";
+  // the length of the hash which names an artifact, in hex digits.
+  static constexpr size_t hash_digits = 16;
+  // a temporary file older than this was left by a writer which
+  // failed before renaming it, rather than one still writing.
+  static constexpr auto stale = std::chrono::hours{1};
+
+  // true when the name begins with a hash, followed by the extension.
+  static bool isNamed(std::string_view name) noexcept {
+    if (name.size() < hash_digits + extension.size()) {
+      return false;
+    }
+    for (char c : name.substr(0, hash_digits)) {
+      if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+        return false;
+      }
+    }
+    return name.substr(hash_digits, extension.size()) == extension;
+  }
+
+  // the name of an artifact, as pathOf makes it.
+  static bool isArtifact(std::string_view name) noexcept {
+    return isNamed(name) && name.size() == hash_digits + extension.size();
+  }
+
+  // the name of a temporary artifact, as store makes it.
+  static bool isTemporary(std::string_view name) noexcept {
+    return isNamed(name) && name.ends_with(".tmp");
+  }
+
+  std::filesystem::path pathOf(std::string_view source) const {
+    std::string key{artifact_version};
+    key.append(std::format("/{:d}/", artifact_format));
+    key.append(source);
+    return m_directory / std::format("{:016x}{}", hashBytes(key), extension);
+  }
+
+  void evict() {
+    struct File {
+      std::filesystem::path           path;
+      std::filesystem::file_time_type time;
+      u64                             size;
+    };
+
+    std::error_code   error;
+    std::vector<File> files;
+    u64               total = 0;
+    for (auto const &entry :
+         std::filesystem::directory_iterator{m_directory, error}) {
+      if (!entry.is_regular_file(error)) {
+        continue;
+      }
+      auto name      = entry.path().filename().string();
+      bool temporary = isTemporary(name);
+      if (!temporary && !isArtifact(name)) {
+        continue;
+      }
+      // #NOTE the size and time of a file may fail to be read
+      // when another process has just evicted it.
+      auto size = entry.file_size(error);
+      if (error) {
+        continue;
+      }
+      auto time = entry.last_write_time(error);
+      if (error) {
+        continue;
+      }
+      if (temporary) {
+        if (std::filesystem::file_time_type::clock::now() - time > stale) {
+          std::filesystem::remove(entry.path(), error);
+        }
+        continue;
+      }
+      total += size;
+      files.push_back(File{entry.path(), time, size});
+    }
+
+    if (total <= m_capacity) {
+      return;
+    }
+
+    std::sort(files.begin(), files.end(), [](File const &a, File const &b) {
+      return a.time < b.time;
+    });
+    for (auto const &file : files) {
+      if (total <= m_capacity) {
+        break;
+      }
+      if (std::filesystem::remove(file.path, error)) {
+        m_statistics.evictions++;
+      }
+      total -= file.size;
+    }
+  }
+
+public:
+  explicit CompileCache(std::filesystem::path directory,
+                        u64                   capacity = default_capacity)
+      : m_directory(std::move(directory)), m_capacity(capacity) {}
+
+  // the directory named by VOYAGE_CACHE_DIR, otherwise voyage within
+  // the user's cache directory. setting VOYAGE_CACHE_DIR empty
+  // disables the cache. the capacity in bytes may be set by
+  // VOYAGE_CACHE_SIZE.
+  static std::optional<CompileCache> fromEnvironment() {
+    std::filesystem::path directory;
+    if (char const *path = std::getenv("VOYAGE_CACHE_DIR")) {
+      directory = path;
+    } else if (char const *path = std::getenv("XDG_CACHE_HOME")) {
+      directory = std::filesystem::path{path} / "voyage";
+    } else if (char const *path = std::getenv("HOME")) {
+      directory = std::filesystem::path{path} / ".cache" / "voyage";
+    }
+
+    if (directory.empty()) {
+      return std::nullopt;
+    }
+
+    u64 capacity = default_capacity;
+    if (char const *size = std::getenv("VOYAGE_CACHE_SIZE")) {
+      std::string_view text{size};
+      std::from_chars(text.data(), text.data() + text.size(), capacity);
+    }
+    return CompileCache{std::move(directory), capacity};
+  }
+
+  [[nodiscard]] std::filesystem::path const &directory() const noexcept {
+    return m_directory;
+  }
+  [[nodiscard]] Statistics const &statistics() const noexcept {
+    return m_statistics;
+  }
+
+  // returns the cached chunk of the source, declaring its globals,
+  // or nothing on a miss.
+  std::optional<Bytecode> load(std::string_view source, Heap &heap,
+                               Globals &globals, Natives &natives) {
+    auto          path = pathOf(source);
+    std::ifstream file{path, std::ios::binary};
+    if (!file.is_open()) {
+      m_statistics.misses++;
+      return std::nullopt;
+    }
+
+    std::string data{std::istreambuf_iterator<char>{file}, {}};
+    auto bytecode = readArtifact(data, source, heap, globals, natives);
+    if (!bytecode) {
+      m_statistics.misses++;
+      return std::nullopt;
+    }
+
+    std::error_code error;
+    std::filesystem::last_write_time(
+        path, std::filesystem::file_time_type::clock::now(), error);
+    m_statistics.hits++;
+    return bytecode;
+  }
+
+  // stores the chunk which the source compiled to. failing to store
+  // is not an error, the script is simply compiled again next time.
+  void store(std::string_view source, Bytecode const &bytecode,
+             Globals const &globals, Natives const &natives) {
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    if (error) {
+      return;
+    }
+
+    // the temporary name is unique to this process and store, so
+    // concurrent writers never write to the same file.
+    static std::atomic<u64> counter = 0;
+    auto                    path    = pathOf(source);
+    auto                    temporary =
+        std::filesystem::path{path}.concat(std::format(
+            ".{:d}.{:d}.tmp", (u64)(::getpid()), counter.fetch_add(1)));
+
+    {
+      auto          data = writeArtifact(source, bytecode, globals, natives);
+      std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+      file.write(data.data(), (std::streamsize)(data.size()));
+      if (!file.good()) {
+        file.close();
+        std::filesystem::remove(temporary, error);
+        return;
+      }
+    }
+
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+      std::filesystem::remove(temporary, error);
+      return;
+    }
+
+    m_statistics.stores++;
+    evict();
+  }
+};
+
+inline void print(std::ostream                   &out,
+                  CompileCache::Statistics const &statistics) {
+  out << std::format("cache {:d} hits, {:d} misses, {:d} stores, {:d} "
+                     "evictions\n",
+                     statistics.hits, statistics.misses, statistics.stores,
+                     statistics.evictions);
+}
+
+inline std::ostream &operator<<(std::ostream                   &out,
+                                CompileCache::Statistics const &statistics) {
+  print(out, statistics);
+  return out;
+}
+} // namespace voyage
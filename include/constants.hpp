@@ -3,12 +3,13 @@
 #include <vector>
 
 #include "common.hpp"
+#include "memory.hpp"
 #include "value.hpp"
 
 namespace voyage {
 class Constants {
 public:
-  using Array           = std::vector<Value>;
+  using Array = std::vector<Value, Counted<Value, Subsystem::Constants>>;
   using iterator        = Array::iterator;
   using pointer         = Array::pointer;
   using reference       = Array::reference;
@@ -20,6 +21,8 @@ private:
   Array m_array;
 
 public:
+  [[nodiscard]] size_t size() const noexcept { return m_array.size(); }
+
   size_t write(Value value) {
     m_array.push_back(value);
     return m_array.size() - 1;
@@ -34,5 +37,12 @@ public:
     assert(position < m_array.size());
     return m_array[position];
   }
+
+  [[nodiscard]] iterator       begin() noexcept { return m_array.begin(); }
+  [[nodiscard]] iterator       end() noexcept { return m_array.end(); }
+  [[nodiscard]] const_iterator begin() const noexcept {
+    return m_array.begin();
+  }
+  [[nodiscard]] const_iterator end() const noexcept { return m_array.end(); }
 };
 } // namespace voyage
@@ -9,6 +9,7 @@ class Error {
 public:
   enum class Kind {
     Comptime,
+    Verify,
     Runtime,
   };
 
@@ -25,6 +26,8 @@ public:
     switch (m_kind) {
     case Kind::Comptime:
       return "Comptime";
+    case Kind::Verify:
+      return "Verify";
     case Kind::Runtime:
       return "Runtime";
     default:
@@ -35,12 +38,12 @@ public:
   size_t line() const noexcept { return m_line; }
 };
 
-void print(std::ostream &out, Error const &error) {
+inline void print(std::ostream &out, Error const &error) {
   out << std::format("[line: {:4d}] {:8s} {:s}", error.line(), error.kind(),
                      error.msg());
 }
 
-std::ostream &operator<<(std::ostream &out, Error const &error) {
+inline std::ostream &operator<<(std::ostream &out, Error const &error) {
   print(out, error);
   return out;
 }
@@ -0,0 +1,87 @@
+#pragma once
+#include <format>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "memory.hpp"
+#include "value.hpp"
+
+namespace voyage {
+// records the kinds of operand observed at each arithmetic
+// instruction within a chunk, indexed by instruction offset.
+// the virtual machine consults a site when deciding which
+// specialized instruction to rewrite the site to.
+class Feedback {
+public:
+  struct Site {
+    // bitmasks of the Value::Kinds seen on either side.
+    u8  lhs    = 0;
+    u8  rhs    = 0;
+    u16 deopts = 0;
+
+    [[nodiscard]] bool empty() const noexcept { return lhs == 0 && rhs == 0; }
+    [[nodiscard]] bool only(Value::Kind kind) const noexcept {
+      return (lhs == bit(kind)) && (rhs == bit(kind));
+    }
+  };
+
+  using Sites = std::vector<Site, Counted<Site, Subsystem::Feedback>>;
+
+private:
+  Sites m_sites;
+
+  static constexpr u8 bit(Value::Kind kind) noexcept {
+    return (u8)(1U << std::to_underlying(kind));
+  }
+
+public:
+  Site &record(size_t offset, Value const &a, Value const &b) {
+    if (offset >= m_sites.size()) {
+      m_sites.resize(offset + 1);
+    }
+
+    Site &site  = m_sites[offset];
+    site.lhs   |= bit(a.kind());
+    site.rhs   |= bit(b.kind());
+    return site;
+  }
+
+  [[nodiscard]] Sites const &sites() const noexcept { return m_sites; }
+};
+
+inline std::string kind_mask(u8 mask) {
+  static constexpr std::string_view names[] = {"Integer", "Real", "Object"};
+
+  std::string result;
+  for (size_t i = 0; i < std::size(names); ++i) {
+    if ((mask & (1U << i)) != 0) {
+      if (!result.empty()) {
+        result.append("|");
+      }
+      result.append(names[i]);
+    }
+  }
+  return result.empty() ? "none" : result;
+}
+
+inline void print(std::ostream &out, Feedback const &feedback) {
+  auto const &sites = feedback.sites();
+  for (size_t offset = 0; offset < sites.size(); ++offset) {
+    auto const &site = sites[offset];
+    if (site.empty()) {
+      continue;
+    }
+
+    out << std::format("{:04d} {:12s} {:12s} deopts {:d}\n", offset,
+                       kind_mask(site.lhs), kind_mask(site.rhs), site.deopts);
+  }
+}
+
+inline std::ostream &operator<<(std::ostream   &out,
+                                Feedback const &feedback) {
+  print(out, feedback);
+  return out;
+}
+} // namespace voyage
@@ -0,0 +1,301 @@
+#pragma once
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "common.hpp"
+#include "function.hpp"
+#include "memory.hpp"
+#include "object.hpp"
+#include "stack.hpp"
+#include "value.hpp"
+
+namespace voyage {
+// each frame is a window onto the stack, beginning at base.
+// function is nullptr for the frame of top level code.
+struct Frame {
+  Function          *function;
+  Bytecode          *bytecode;
+  Bytecode::iterator ip;
+  size_t             base;
+};
+
+using Frames = std::vector<Frame, Counted<Frame, Subsystem::Frames>>;
+
+// the stack and frames of one thread of execution. the strand
+// which runs is the state of the virtual machine itself, any other
+// is swapped in to run it.
+struct Strand {
+  Stack<Value> stack;
+  Frames       frames;
+  size_t       frame_count = 0;
+};
+
+class Fiber;
+
+// a queue of fibers, linked through the fibers themselves, so that
+// neither blocking nor scheduling allocates. a fiber is in at most
+// one queue at a time, that of the scheduler while it is ready to
+// run, or that of whatever it is blocked on.
+class FiberQueue {
+private:
+  Fiber *m_head = nullptr;
+  Fiber *m_tail = nullptr;
+
+public:
+  [[nodiscard]] bool empty() const noexcept { return m_head == nullptr; }
+
+  inline void   push(Fiber *fiber) noexcept;
+  inline Fiber *pop() noexcept;
+  void          clear() noexcept { m_head = m_tail = nullptr; }
+
+  template <class F> inline void forEach(F &&f) const;
+};
+
+// a function running concurrently with the code which spawned it,
+// on a strand of its own. fibers are scheduled cooperatively, the
+// running fiber keeps running until it returns, or blocks joining
+// another fiber or on a channel.
+class Fiber : public Object {
+public:
+  enum class Status : u8 {
+    Ready,
+    Blocked,
+    Done,
+    // the run which spawned the fiber ended before it returned.
+    Abandoned,
+  };
+
+private:
+  friend class FiberQueue;
+  friend class Scheduler;
+
+  Strand     m_strand;
+  Status     m_status = Status::Ready;
+  Value      m_result{i64{0}};
+  // the next fiber of the queue the fiber is in.
+  Fiber     *m_link = nullptr;
+  // the fibers blocked joining this one.
+  FiberQueue m_joiners;
+  // the main fiber of the run the fiber belongs to.
+  Fiber     *m_main = nullptr;
+  // the index of the fiber among the live fibers of its scheduler.
+  size_t     m_slot = 0;
+
+public:
+  Fiber() noexcept : Object(Kind::Fiber) {}
+
+  [[nodiscard]] Strand       &strand() noexcept { return m_strand; }
+  [[nodiscard]] Strand const &strand() const noexcept { return m_strand; }
+  [[nodiscard]] Status        status() const noexcept { return m_status; }
+  [[nodiscard]] Value const  &result() const noexcept { return m_result; }
+  [[nodiscard]] FiberQueue   &joiners() noexcept { return m_joiners; }
+  [[nodiscard]] FiberQueue const &joiners() const noexcept {
+    return m_joiners;
+  }
+
+  // frees the strand of a fiber which will not run again.
+  void release() noexcept { m_strand = Strand{}; }
+};
+
+inline void FiberQueue::push(Fiber *fiber) noexcept {
+  fiber->m_link = nullptr;
+  if (m_tail == nullptr) {
+    m_head = fiber;
+  } else {
+    m_tail->m_link = fiber;
+  }
+  m_tail = fiber;
+}
+
+inline Fiber *FiberQueue::pop() noexcept {
+  Fiber *fiber = m_head;
+  if (fiber != nullptr) {
+    m_head = fiber->m_link;
+    if (m_head == nullptr) {
+      m_tail = nullptr;
+    }
+  }
+  return fiber;
+}
+
+template <class F> inline void FiberQueue::forEach(F &&f) const {
+  for (Fiber *fiber = m_head; fiber != nullptr; fiber = fiber->m_link) {
+    f(fiber);
+  }
+}
+
+// a bounded queue of values, through which fibers communicate.
+// a fiber which sends to a full channel, or receives from an empty
+// one, blocks until another fiber receives or sends.
+//
+// #NOTE fibers share the thread of their virtual machine, so a
+// channel is only ever touched by one fiber at a time, and needs
+// neither locks nor atomics.
+class Channel : public Object {
+public:
+  static constexpr size_t max_capacity = 1 << 24;
+
+private:
+  std::vector<Value> m_buffer;
+  size_t             m_head  = 0;
+  size_t             m_count = 0;
+  FiberQueue         m_senders;
+  FiberQueue         m_receivers;
+
+public:
+  explicit Channel(size_t capacity)
+      : Object(Kind::Channel), m_buffer(capacity, Value{i64{0}}) {}
+
+  [[nodiscard]] size_t capacity() const noexcept { return m_buffer.size(); }
+  [[nodiscard]] size_t size() const noexcept { return m_count; }
+  [[nodiscard]] bool   empty() const noexcept { return m_count == 0; }
+  [[nodiscard]] bool   full() const noexcept {
+    return m_count == m_buffer.size();
+  }
+  [[nodiscard]] size_t bytes() const noexcept {
+    return sizeof(Channel) + m_buffer.size() * sizeof(Value);
+  }
+
+  [[nodiscard]] FiberQueue &senders() noexcept { return m_senders; }
+  [[nodiscard]] FiberQueue &receivers() noexcept { return m_receivers; }
+
+  // the channel must not be full.
+  void push(Value value) noexcept {
+    m_buffer[(m_head + m_count) % m_buffer.size()] = value;
+    m_count++;
+  }
+
+  // the channel must not be empty. the slot is cleared, so that
+  // the channel does not keep what it held alive.
+  Value pop() noexcept {
+    Value value      = m_buffer[m_head];
+    m_buffer[m_head] = Value{i64{0}};
+    m_head           = (m_head + 1) % m_buffer.size();
+    m_count--;
+    return value;
+  }
+
+  // calls f with each value held, then each blocked fiber.
+  template <class F, class G> void forEach(F &&f, G &&g) const {
+    for (size_t i = 0; i < m_count; ++i) {
+      f(m_buffer[(m_head + i) % m_buffer.size()]);
+    }
+    m_senders.forEach(g);
+    m_receivers.forEach(g);
+  }
+};
+
+// the fibers of one run. main is the fiber of top level code, which
+// is only created once it spawns a fiber, and running is the fiber
+// whose strand is the state of the virtual machine.
+//
+// #NOTE main and the live fibers are roots, a fiber which returned
+// lives on only while its result may yet be joined.
+class Scheduler {
+private:
+  Fiber              *m_main    = nullptr;
+  Fiber              *m_running = nullptr;
+  FiberQueue          m_ready;
+  // every fiber spawned which has neither returned nor been
+  // abandoned, main aside.
+  std::vector<Fiber *> m_live;
+
+  void remove(Fiber *fiber) noexcept {
+    Fiber *last           = m_live.back();
+    last->m_slot          = fiber->m_slot;
+    m_live[fiber->m_slot] = last;
+    m_live.pop_back();
+  }
+
+public:
+  [[nodiscard]] bool   active() const noexcept { return m_main != nullptr; }
+  [[nodiscard]] Fiber *main() const noexcept { return m_main; }
+  [[nodiscard]] Fiber *running() const noexcept { return m_running; }
+  [[nodiscard]] bool   ready() const noexcept { return !m_ready.empty(); }
+  [[nodiscard]] std::vector<Fiber *> const &live() const noexcept {
+    return m_live;
+  }
+
+  // true when the fiber belongs to this run, rather than to a run
+  // which ended, or to another task.
+  [[nodiscard]] bool owns(Fiber const *fiber) const noexcept {
+    return m_main != nullptr && fiber->m_main == m_main;
+  }
+
+  // begins scheduling, main being the fiber of the running code.
+  void begin(Fiber *main) noexcept {
+    m_main = m_running = main;
+    main->m_main       = main;
+  }
+
+  // a fiber which was just spawned, and is ready to run.
+  void spawn(Fiber *fiber) {
+    fiber->m_main = m_main;
+    fiber->m_slot = m_live.size();
+    m_live.push_back(fiber);
+    m_ready.push(fiber);
+  }
+
+  // the running fiber blocks in the given queue.
+  void block(FiberQueue &queue) noexcept {
+    m_running->m_status = Fiber::Status::Blocked;
+    queue.push(m_running);
+  }
+
+  // readies the first fiber of the queue which is still blocked,
+  // the others having been abandoned.
+  //
+  // #NOTE a channel may be shared between tasks through a global,
+  // but a fiber is only ever scheduled by its own task. a fiber of
+  // another task is dropped from the queue, and stays blocked.
+  void wake(FiberQueue &queue) noexcept {
+    while (Fiber *fiber = queue.pop()) {
+      if (fiber->m_status == Fiber::Status::Blocked && owns(fiber)) {
+        fiber->m_status = Fiber::Status::Ready;
+        m_ready.push(fiber);
+        return;
+      }
+    }
+  }
+
+  void wakeAll(FiberQueue &queue) noexcept {
+    while (!queue.empty()) {
+      wake(queue);
+    }
+  }
+
+  // the running fiber returned the given value.
+  void finish(Value result) noexcept {
+    Fiber *fiber    = m_running;
+    fiber->m_status = Fiber::Status::Done;
+    fiber->m_result = result;
+    wakeAll(fiber->m_joiners);
+    remove(fiber);
+  }
+
+  // the next fiber to run, which must be ready, becomes the running
+  // fiber. the strands are swapped by the caller.
+  Fiber *next() noexcept {
+    m_running           = m_ready.pop();
+    m_running->m_status = Fiber::Status::Ready;
+    return m_running;
+  }
+
+  // abandons every fiber which has not returned, and ends the run.
+  void abandon() noexcept {
+    for (Fiber *fiber : m_live) {
+      fiber->m_status = Fiber::Status::Abandoned;
+      fiber->release();
+    }
+    if (m_main != nullptr) {
+      m_main->m_status = Fiber::Status::Abandoned;
+      m_main->release();
+    }
+    m_live.clear();
+    m_ready.clear();
+    m_main = m_running = nullptr;
+  }
+};
+} // namespace voyage
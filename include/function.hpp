@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+#include "bytecode.hpp"
+#include "object.hpp"
+
+namespace voyage {
+// a function is compiled into its own chunk. when called, its
+// frame begins at the slot holding the function itself, which
+// is followed by the arguments, then the locals of the body.
+//
+// a function may be deferred, in which case it holds the source
+// text of its parameters and body, and is compiled the first time
+// it is called. the source is released once it is compiled.
+class Function : public Object {
+private:
+  String     *m_name;
+  u8          m_arity    = 0;
+  bool        m_compiled = true;
+  size_t      m_line     = 0;
+  // the line of the name of the function where it was declared,
+  // which identifies the function within a profile.
+  size_t      m_declared = 0;
+  std::string m_source;
+  Bytecode    m_bytecode;
+
+public:
+  explicit Function(String *name) noexcept
+      : Object(Kind::Function), m_name(name) {}
+
+  [[nodiscard]] bool             compiled() const noexcept { return m_compiled; }
+  [[nodiscard]] size_t           line() const noexcept { return m_line; }
+  [[nodiscard]] std::string_view source() const noexcept { return m_source; }
+
+  void defer(std::string_view source, size_t line) {
+    m_compiled = false;
+    m_line     = line;
+    m_source   = source;
+  }
+
+  void markCompiled() noexcept {
+    m_compiled = true;
+    m_source.clear();
+    m_source.shrink_to_fit();
+  }
+
+  [[nodiscard]] size_t declared() const noexcept { return m_declared; }
+  void setDeclared(size_t line) noexcept { m_declared = line; }
+
+  [[nodiscard]] String   *name() const noexcept { return m_name; }
+  [[nodiscard]] u8        arity() const noexcept { return m_arity; }
+  [[nodiscard]] Bytecode &bytecode() noexcept { return m_bytecode; }
+  [[nodiscard]] Bytecode const &bytecode() const noexcept {
+    return m_bytecode;
+  }
+
+  void setArity(u8 arity) noexcept { m_arity = arity; }
+};
+} // namespace voyage
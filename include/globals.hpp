@@ -0,0 +1,90 @@
+#pragma once
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+#include "common.hpp"
+#include "hash_map.hpp"
+#include "object.hpp"
+#include "value.hpp"
+
+namespace voyage {
+// the module level variables. the compiler resolves each global
+// name to a dense slot index when it compiles a reference, the
+// virtual machine only ever indexes the values by slot.
+class Globals {
+public:
+  using Names = HashMap<String *, u32>;
+
+  // slots are encoded as u16 immediates.
+  static constexpr size_t max_slots = UINT16_MAX + 1;
+
+private:
+  Names                 m_names;
+  std::vector<String *> m_slots;
+  std::vector<Value>    m_values;
+
+  static u64 hashOf(String *name) noexcept { return name->hash(); }
+
+public:
+  [[nodiscard]] size_t size() const noexcept { return m_values.size(); }
+
+  // #NOTE names are interned, so they compare by address.
+  [[nodiscard]] std::optional<u32> find(String *name) noexcept {
+    auto found = m_names.find(
+        name->hash(), [name](String *other) { return other == name; });
+    if (found == nullptr) {
+      return std::nullopt;
+    }
+    return found->value;
+  }
+
+  // returns the slot of the given name, allocating
+  // the next slot if the name is not yet declared.
+  u32 declare(String *name) {
+    if (auto slot = find(name)) {
+      return *slot;
+    }
+
+    auto slot = (u32)(m_values.size());
+    m_names.insert(name->hash(), name, slot, &Globals::hashOf);
+    m_slots.push_back(name);
+    m_values.emplace_back(i64{0});
+    return slot;
+  }
+
+  // returns every value to 0, as it was when declared.
+  void reset() noexcept { std::ranges::fill(m_values, Value{i64{0}}); }
+
+  // forgets every slot from the given one onwards, which were
+  // declared by a compilation that then failed.
+  void truncate(size_t size) {
+    while (m_slots.size() > size) {
+      String *name  = m_slots.back();
+      auto   *found = m_names.find(
+          name->hash(), [name](String *other) { return other == name; });
+      m_names.erase(found);
+      m_slots.pop_back();
+      m_values.pop_back();
+    }
+  }
+
+  [[nodiscard]] String *name(size_t slot) const noexcept {
+    return m_slots[slot];
+  }
+
+  [[nodiscard]] Value &operator[](size_t slot) noexcept {
+    return m_values[slot];
+  }
+  [[nodiscard]] Value const &operator[](size_t slot) const noexcept {
+    return m_values[slot];
+  }
+
+  [[nodiscard]] std::vector<String *> const &names() const noexcept {
+    return m_slots;
+  }
+  [[nodiscard]] std::vector<Value> const &values() const noexcept {
+    return m_values;
+  }
+};
+} // namespace voyage
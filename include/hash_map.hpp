@@ -0,0 +1,234 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "common.hpp"
+#include "memory.hpp"
+
+namespace voyage {
+// FNV-1a, followed by a finalizer so that both the high bits
+// (which select a group) and the low seven bits (which are stored
+// in the control bytes) are well mixed.
+constexpr inline u64 hashBytes(std::string_view bytes) noexcept {
+  u64 hash = 14695981039346656037ULL;
+  for (char c : bytes) {
+    hash ^= static_cast<u8>(c);
+    hash *= 1099511628211ULL;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+// an open addressing hash map in the style of the swiss table.
+// each slot has a control byte, which is either Empty, Deleted,
+// or holds the low seven bits of the hash of the key in the slot.
+// the control bytes are probed sixteen at a time, a group compares
+// every control byte against the seven bit hash in one instruction,
+// so most lookups touch the slots only for the key that matches.
+//
+// the hash of a key is supplied by the caller, which lets keys
+// cache their hash and lets a lookup be performed without a key,
+// (e.g. looking up a string by its text before interning it.)
+template <class Key, class T> class HashMap {
+public:
+  struct Slot {
+    Key                        key;
+    [[no_unique_address]] T value;
+  };
+
+  using Controls = std::vector<i8, Counted<i8, Subsystem::Tables>>;
+  using Slots    = std::vector<Slot, Counted<Slot, Subsystem::Tables>>;
+
+private:
+  static constexpr size_t group_width = 16;
+
+  enum Control : i8 {
+    Empty   = -128,
+    Deleted = -2,
+  };
+
+  Controls m_control;
+  Slots    m_slots;
+  size_t   m_size     = 0;
+  size_t   m_deleted  = 0;
+  size_t   m_rehashes = 0;
+
+  static constexpr u64 h1(u64 hash) noexcept { return hash >> 7; }
+  static constexpr i8  h2(u64 hash) noexcept { return (i8)(hash & 0x7F); }
+
+  // a bitmask with a bit set for each control byte in
+  // the group which is equal to the given control byte.
+  static u32 match(i8 const *group, i8 control) noexcept {
+#if defined(__SSE2__)
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<__m128i const *>(group));
+    return (u32)(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(bytes, _mm_set1_epi8(control))));
+#else
+    u32 mask = 0;
+    for (size_t i = 0; i < group_width; ++i) {
+      if (group[i] == control) {
+        mask |= 1U << i;
+      }
+    }
+    return mask;
+#endif
+  }
+
+  // Empty and Deleted are the only negative control bytes.
+  static u32 matchAvailable(i8 const *group) noexcept {
+#if defined(__SSE2__)
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<__m128i const *>(group));
+    return (u32)(_mm_movemask_epi8(bytes));
+#else
+    u32 mask = 0;
+    for (size_t i = 0; i < group_width; ++i) {
+      if (group[i] < 0) {
+        mask |= 1U << i;
+      }
+    }
+    return mask;
+#endif
+  }
+
+  size_t groups() const noexcept { return m_control.size() / group_width; }
+
+  // the slot a new entry with the given hash would be placed in.
+  size_t findAvailable(u64 hash) const noexcept {
+    size_t mask  = groups() - 1;
+    size_t group = h1(hash) & mask;
+    for (size_t probe = 1;; ++probe) {
+      u32 available = matchAvailable(&m_control[group * group_width]);
+      if (available != 0) {
+        return group * group_width + (size_t)(std::countr_zero(available));
+      }
+      // triangular probing visits every group when
+      // the number of groups is a power of two.
+      group = (group + probe) & mask;
+    }
+  }
+
+  void rehash(size_t capacity, auto &&hasher) {
+    Controls control(capacity, Empty);
+    Slots    slots(capacity);
+    std::swap(control, m_control);
+    std::swap(slots, m_slots);
+    m_deleted = 0;
+    m_rehashes++;
+
+    for (size_t i = 0; i < control.size(); ++i) {
+      if (control[i] >= 0) {
+        u64    hash     = hasher(slots[i].key);
+        size_t index    = findAvailable(hash);
+        m_control[index] = h2(hash);
+        m_slots[index]   = std::move(slots[i]);
+      }
+    }
+  }
+
+public:
+  [[nodiscard]] size_t size() const noexcept { return m_size; }
+  [[nodiscard]] bool   empty() const noexcept { return m_size == 0; }
+  [[nodiscard]] size_t capacity() const noexcept { return m_control.size(); }
+  // the number of times the entries have moved, by growing the
+  // table or by clearing its tombstones.
+  [[nodiscard]] size_t rehashes() const noexcept { return m_rehashes; }
+
+  // returns the slot holding a key with the given hash for
+  // which equal(key) is true, or nullptr if there is none.
+  template <class Equal>
+  Slot *find(u64 hash, Equal &&equal) noexcept {
+    if (m_control.empty()) {
+      return nullptr;
+    }
+
+    size_t mask  = groups() - 1;
+    size_t group = h1(hash) & mask;
+    for (size_t probe = 1; probe <= groups(); ++probe) {
+      i8 const *control = &m_control[group * group_width];
+      for (u32 matches = match(control, h2(hash)); matches != 0;
+           matches &= matches - 1) {
+        size_t index =
+            group * group_width + (size_t)(std::countr_zero(matches));
+        if (equal(m_slots[index].key)) {
+          return &m_slots[index];
+        }
+      }
+
+      if (match(control, Empty) != 0) {
+        return nullptr;
+      }
+      group = (group + probe) & mask;
+    }
+    return nullptr;
+  }
+
+  // inserts a key which is known not to be present. hasher
+  // recomputes the hash of existing keys should the table grow.
+  template <class Hasher>
+  Slot &insert(u64 hash, Key key, T value, Hasher &&hasher) {
+    // grow when more than 7/8ths of the slots are in use.
+    if ((m_size + m_deleted + 1) * 8 > capacity() * 7) {
+      size_t next = capacity() == 0 ? group_width : capacity() * 2;
+      // rehashing in place is enough to clear tombstones.
+      if ((m_size + 1) * 16 < capacity() * 7) {
+        next = capacity();
+      }
+      rehash(next, hasher);
+    }
+
+    size_t index = findAvailable(hash);
+    if (m_control[index] == Deleted) {
+      m_deleted--;
+    }
+    m_control[index] = h2(hash);
+    m_slots[index]   = Slot{std::move(key), std::move(value)};
+    m_size++;
+    return m_slots[index];
+  }
+
+  void erase(Slot *slot) noexcept {
+    assert(slot != nullptr);
+    size_t index     = (size_t)(slot - m_slots.data());
+    m_control[index] = Deleted;
+    m_slots[index]   = Slot{};
+    m_size--;
+    m_deleted++;
+  }
+
+  // removes each entry for which predicate(slot) is true, among
+  // count slots from the slot at from, and returns the slot which
+  // follows them, capacity() once every slot has been visited.
+  //
+  // #NOTE erasing leaves a tombstone, so the entries which follow
+  // stay where they are, until the table is rehashed.
+  template <class Predicate>
+  size_t eraseIf(Predicate &&predicate, size_t from, size_t count) {
+    size_t to = std::min(from + count, m_control.size());
+    for (size_t i = from; i < to; ++i) {
+      if (m_control[i] >= 0 && predicate(m_slots[i])) {
+        erase(&m_slots[i]);
+      }
+    }
+    return to;
+  }
+
+  template <class Function> void forEach(Function &&function) const {
+    for (size_t i = 0; i < m_control.size(); ++i) {
+      if (m_control[i] >= 0) {
+        function(m_slots[i]);
+      }
+    }
+  }
+};
+} // namespace voyage
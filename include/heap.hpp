@@ -0,0 +1,177 @@
+#pragma once
+#include <format>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include "array.hpp"
+#include "collector.hpp"
+#include "fiber.hpp"
+#include "function.hpp"
+#include "hash_map.hpp"
+#include "object.hpp"
+
+namespace voyage {
+// allocates every Object, which the Collector then owns, and
+// holds the table of interned strings. the intern table is weak,
+// strings referenced only by the table are collected.
+class Heap {
+public:
+  using Strings = HashMap<String *, std::monostate>;
+
+  // the calls of intern which found the string, and those which
+  // created it.
+  struct Interning {
+    u64 hits   = 0;
+    u64 misses = 0;
+  };
+
+private:
+  // the number of slots of the intern table visited between
+  // checks of the clock.
+  static constexpr size_t strings_slice = 1024;
+
+  Collector m_collector;
+  Strings   m_strings;
+  Interning m_interning;
+  // where the weak sweep of the intern table resumes, and the
+  // count of rehashes when it began.
+  size_t    m_cursor   = 0;
+  size_t    m_rehashes = 0;
+
+  static u64 hashOf(String *string) noexcept { return string->hash(); }
+
+  template <class T, class... Args> T *allocate(Args &&...args) {
+    T *object = new T(std::forward<Args>(args)...);
+    m_collector.track(object);
+    return object;
+  }
+
+  // removes the strings left White from the intern table until
+  // the deadline, returning true once the whole table is visited.
+  bool sweepStrings(Collector::Clock::time_point deadline) {
+    // #NOTE a string interned in the meantime may rehash the table,
+    // moving entries behind the cursor, so the walk begins again.
+    if (m_strings.rehashes() != m_rehashes) {
+      m_rehashes = m_strings.rehashes();
+      m_cursor   = 0;
+    }
+
+    do {
+      m_cursor = m_strings.eraseIf(
+          [](Strings::Slot const &slot) {
+            return slot.key->color() == Object::Color::White;
+          },
+          m_cursor, strings_slice);
+      if (m_cursor == m_strings.capacity()) {
+        m_cursor = 0;
+        return true;
+      }
+    } while (Collector::Clock::now() < deadline);
+    return false;
+  }
+
+public:
+  Heap() noexcept = default;
+  Heap(Heap const &)            = delete;
+  Heap &operator=(Heap const &) = delete;
+
+  [[nodiscard]] Collector       &collector() noexcept { return m_collector; }
+  [[nodiscard]] Collector const &collector() const noexcept {
+    return m_collector;
+  }
+  [[nodiscard]] Strings const &strings() const noexcept { return m_strings; }
+  [[nodiscard]] Interning const &interning() const noexcept {
+    return m_interning;
+  }
+
+  // advances garbage collection, roots(collector) must mark
+  // every value the caller can still reach.
+  template <class Roots> void step(Roots &&roots) {
+    m_collector.step(std::forward<Roots>(roots),
+                     [this](Collector::Clock::time_point deadline) {
+                       return sweepStrings(deadline);
+                     });
+  }
+
+  // returns the one String with the given text,
+  // creating it if it does not exist yet.
+  String *intern(std::string_view text) {
+    u64  hash  = hashBytes(text);
+    auto found = m_strings.find(
+        hash, [text](String *string) { return string->view() == text; });
+    if (found != nullptr) {
+      m_interning.hits++;
+      m_collector.revive(found->key);
+      return found->key;
+    }
+
+    m_interning.misses++;
+    String *string = allocate<String>(text, hash);
+    m_strings.insert(hash, string, {}, &Heap::hashOf);
+    return string;
+  }
+
+  Function *function(String *name) { return allocate<Function>(name); }
+
+  // an array of the given length, whose elements the caller fills
+  // before the array is reachable from anything else.
+  Array *array(size_t length) {
+    return allocate<Array>(Array::allocate(length), length);
+  }
+
+  // the elements of the array from start up to end, which must lie
+  // within it. the whole array is itself, any other range is a view.
+  Array *slice(Array &array, size_t start, size_t end) {
+    if (start == 0 && end == array.length()) {
+      return &array;
+    }
+    return allocate<Array>(array, start, end - start);
+  }
+
+  Fiber   *fiber() { return allocate<Fiber>(); }
+  Channel *channel(size_t capacity) { return allocate<Channel>(capacity); }
+
+  String *concatenate(String const &a, String const &b) {
+    std::string text;
+    text.reserve(a.length() + b.length());
+    text.append(a.view());
+    text.append(b.view());
+    return intern(text);
+  }
+};
+
+inline void print(std::ostream &out, Object const &object) {
+  switch (object.kind()) {
+  case Object::Kind::String:
+    out << static_cast<String const &>(object).view();
+    break;
+
+  case Object::Kind::Function:
+    out << "<fn " << static_cast<Function const &>(object).name()->view()
+        << ">";
+    break;
+
+  case Object::Kind::Array: {
+    auto const &array = static_cast<Array const &>(object);
+    out << "[";
+    for (size_t i = 0; i < array.length(); ++i) {
+      out << std::format("{:s}{:.5g}", i == 0 ? "" : ", ", array.data()[i]);
+    }
+    out << "]";
+    break;
+  }
+
+  case Object::Kind::Fiber:
+    out << "<fiber>";
+    break;
+
+  case Object::Kind::Channel:
+    out << "<channel>";
+    break;
+
+  default:
+    std::unreachable();
+  }
+}
+} // namespace voyage
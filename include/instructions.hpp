@@ -5,16 +5,158 @@ namespace voyage {
 enum class Instruction : u8 {
   RETURN,
 
+  // the immediate is the number of arguments. TAIL_CALL reuses
+  // the frame of the caller, it is emitted for a call which is
+  // the operand of a return statement.
+  CALL,
+  TAIL_CALL,
+  // the immediate is the index of the native, whose arity was
+  // checked when the call was compiled. only the arguments are
+  // on the stack.
+  CALL_NATIVE,
+
   CONSTANT_U8,
   CONSTANT_U16,
   CONSTANT_U32,
   CONSTANT_U64,
 
+  POP,
+
+  // local slots are relative to the base of the stack,
+  // global slots index the module level Globals.
+  GET_LOCAL,
+  SET_LOCAL,
+  GET_GLOBAL,
+  SET_GLOBAL,
+  DEFINE_GLOBAL,
+
   NEGATE,
 
   ADD,
   SUB,
   MUL,
   DIV,
+
+  // emitted when both operands are known to be integers,
+  // each falls back to the generic operation when they are not.
+  ADD_INT,
+  SUB_INT,
+  MUL_INT,
+
+  // never emitted by the compiler, generic instructions are
+  // rewritten to these once both operands are observed to be real.
+  ADD_REAL,
+  SUB_REAL,
+  MUL_REAL,
+  DIV_REAL,
+
+  // the immediate of ARRAY is the number of elements on the stack,
+  // which it replaces with an array of them. INDEX replaces an array
+  // and an index with the element. the immediate of SLICE holds
+  // slice_start and slice_end when the start and end of the range
+  // are on the stack, above the array, otherwise the range extends
+  // to that end of the array.
+  ARRAY,
+  INDEX,
+  SLICE,
+
+  // SPAWN takes the operands of a CALL, and replaces them with a
+  // fiber running the call. JOIN replaces a fiber with its result,
+  // CHANNEL a capacity with a channel, RECEIVE a channel with the
+  // value received, and SEND a channel and a value with the value
+  // sent. JOIN, SEND and RECEIVE block the running fiber while they
+  // can not complete, and are executed again once it is woken.
+  SPAWN,
+  JOIN,
+  CHANNEL,
+  SEND,
+  RECEIVE,
 };
+
+constexpr inline u8 slice_start = 1 << 0;
+constexpr inline u8 slice_end   = 1 << 1;
+
+// #NOTE any byte which is not listed here is not an
+// instruction, and a chunk containing one is malformed.
+constexpr inline bool isInstruction(u8 byte) noexcept {
+  switch (static_cast<Instruction>(byte)) {
+  case Instruction::RETURN:
+  case Instruction::CALL:
+  case Instruction::TAIL_CALL:
+  case Instruction::CALL_NATIVE:
+  case Instruction::CONSTANT_U8:
+  case Instruction::CONSTANT_U16:
+  case Instruction::CONSTANT_U32:
+  case Instruction::CONSTANT_U64:
+  case Instruction::POP:
+  case Instruction::GET_LOCAL:
+  case Instruction::SET_LOCAL:
+  case Instruction::GET_GLOBAL:
+  case Instruction::SET_GLOBAL:
+  case Instruction::DEFINE_GLOBAL:
+  case Instruction::NEGATE:
+  case Instruction::ADD:
+  case Instruction::SUB:
+  case Instruction::MUL:
+  case Instruction::DIV:
+  case Instruction::ADD_INT:
+  case Instruction::SUB_INT:
+  case Instruction::MUL_INT:
+  case Instruction::ADD_REAL:
+  case Instruction::SUB_REAL:
+  case Instruction::MUL_REAL:
+  case Instruction::DIV_REAL:
+  case Instruction::ARRAY:
+  case Instruction::INDEX:
+  case Instruction::SLICE:
+  case Instruction::SPAWN:
+  case Instruction::JOIN:
+  case Instruction::CHANNEL:
+  case Instruction::SEND:
+  case Instruction::RECEIVE:
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+// the number of immediate bytes which follow the
+// given instruction within a chunk.
+constexpr inline size_t immediateBytes(Instruction instruction) noexcept {
+  switch (instruction) {
+  case Instruction::CALL:
+  case Instruction::TAIL_CALL:
+  case Instruction::SPAWN:
+    return sizeof(u8);
+  case Instruction::CALL_NATIVE:
+    return sizeof(u16);
+
+  case Instruction::CONSTANT_U8:
+    return sizeof(u8);
+  case Instruction::CONSTANT_U16:
+    return sizeof(u16);
+  case Instruction::CONSTANT_U32:
+    return sizeof(u32);
+  case Instruction::CONSTANT_U64:
+    return sizeof(u64);
+
+  case Instruction::GET_LOCAL:
+  case Instruction::SET_LOCAL:
+    return sizeof(u8);
+
+  case Instruction::GET_GLOBAL:
+  case Instruction::SET_GLOBAL:
+  case Instruction::DEFINE_GLOBAL:
+    return sizeof(u16);
+
+  case Instruction::ARRAY:
+    return sizeof(u16);
+  case Instruction::SLICE:
+    return sizeof(u8);
+
+  default:
+    return 0;
+  }
+}
 } // namespace voyage
@@ -0,0 +1,778 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <format>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "arithmetic.hpp"
+#include "bytecode.hpp"
+#include "instructions.hpp"
+#include "natives.hpp"
+
+namespace voyage {
+// an SSA form of a chunk, which the optimizer lifts each chunk into
+// once the parser has emitted it, simplifies, and lowers back into
+// stack code.
+//
+// a chunk is straight line code, so lifting runs the stack abstractly,
+// each slot holding the node which produced its value. locals become
+// the nodes assigned to them, and local loads and stores disappear.
+// every node is defined before it is used, in the order the chunk
+// would execute it.
+namespace ir {
+using Id = u32;
+
+enum class Op : u8 {
+  Param,        // the value of an argument slot on entry
+  Constant,     // a constant, folded or from the pool
+  GetGlobal,    // a load of a global slot
+  Negate,       // NEGATE
+  Binary,       // ADD, SUB, MUL, DIV, or a specialized variant
+  Call,         // callee, then its arguments
+  TailCall,     // callee, then its arguments
+  CallNative,   // the arguments of the native at immediate
+  SetGlobal,    // a store of its operand into a global slot
+  DefineGlobal, // a definition of a global slot
+  Return,       // the result of the chunk
+};
+
+// what is known of the value a node produces.
+enum class Type : u8 {
+  Unknown,
+  Number,
+};
+
+struct Node {
+  Op          op          = Op::Constant;
+  // the instruction of a Negate or Binary node, as emitted.
+  Instruction instruction = Instruction::RETURN;
+  Type        type        = Type::Unknown;
+  // whether the node may raise a runtime error.
+  bool        may_fail    = false;
+  // the argument slot, global slot, or native index.
+  u32         immediate   = 0;
+  // the operands of the node, a range of Graph::operands.
+  u32         first       = 0;
+  u32         count       = 0;
+  // the version of the globals a GetGlobal reads.
+  u64         stamp       = 0;
+  Value       constant{i64{0}};
+  size_t      line = 0;
+
+  // nodes which must stay where they are, relative to each other.
+  [[nodiscard]] bool effect() const noexcept {
+    switch (op) {
+    case Op::Call:
+    case Op::TailCall:
+    case Op::CallNative:
+    case Op::SetGlobal:
+    case Op::DefineGlobal:
+    case Op::Return:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  // nodes whose value is pushed onto the stack.
+  [[nodiscard]] bool produces() const noexcept {
+    return op != Op::DefineGlobal && op != Op::Return;
+  }
+};
+
+// the nodes of a chunk, and their operands, which are kept in one
+// array rather than one per node.
+struct Graph {
+  std::vector<Node> nodes;
+  std::vector<Id>   operands;
+  size_t            params = 0;
+
+  void clear(size_t argument_slots) noexcept {
+    nodes.clear();
+    operands.clear();
+    params = argument_slots;
+  }
+
+  Node &add(Op op, size_t line) {
+    Node &node = nodes.emplace_back();
+    node.op    = op;
+    node.line  = line;
+    node.first = (u32)(operands.size());
+    return node;
+  }
+
+  [[nodiscard]] std::span<Id> operandsOf(Node const &node) noexcept {
+    return {operands.data() + node.first, node.count};
+  }
+  [[nodiscard]] std::span<Id const>
+  operandsOf(Node const &node) const noexcept {
+    return {operands.data() + node.first, node.count};
+  }
+};
+
+// the arithmetic a specialized instruction performs.
+constexpr inline Instruction generic(Instruction instruction) noexcept {
+  switch (instruction) {
+  case Instruction::ADD_INT:
+  case Instruction::ADD_REAL:
+    return Instruction::ADD;
+  case Instruction::SUB_INT:
+  case Instruction::SUB_REAL:
+    return Instruction::SUB;
+  case Instruction::MUL_INT:
+  case Instruction::MUL_REAL:
+    return Instruction::MUL;
+  case Instruction::DIV_REAL:
+    return Instruction::DIV;
+  default:
+    return instruction;
+  }
+}
+
+// lifts the chunk of a function with the given number of argument
+// slots, including the function itself, or of top level code with
+// none, into the graph. returns false for any chunk which does not
+// lift cleanly, which is then left as it is.
+inline bool lift(Bytecode const &bytecode, size_t params,
+                 Natives const &natives, Graph &graph) {
+  graph.clear(params);
+  graph.nodes.reserve(params + bytecode.size() / 2 + 1);
+
+  std::vector<Id> stack;
+  for (size_t i = 0; i < params; ++i) {
+    graph.add(Op::Param, 0).immediate = (u32)(i);
+    stack.push_back((Id)(i));
+  }
+
+  auto next = [&]() { return (Id)(graph.nodes.size()); };
+
+  // moves the operands of a new node off the stack, and pushes the
+  // node when it produces a value.
+  auto take = [&](Op op, size_t count, size_t line) -> Node * {
+    if (stack.size() < count) {
+      return nullptr;
+    }
+    Id    id   = next();
+    Node &node = graph.add(op, line);
+    graph.operands.insert(graph.operands.end(),
+                          stack.end() - (std::ptrdiff_t)(count), stack.end());
+    node.count = (u32)(count);
+    stack.resize(stack.size() - count);
+    if (node.produces()) {
+      stack.push_back(id);
+    }
+    return &node;
+  };
+
+  // the line of each instruction, found by walking the line runs
+  // alongside the instructions.
+  auto const &runs = bytecode.lines().runs();
+  size_t      run  = 0;
+  size_t      end  = runs.empty() ? 0 : runs[0].m_length;
+
+  size_t offset = 0;
+  while (offset < bytecode.size()) {
+    while (end <= offset && run + 1 < runs.size()) {
+      end += runs[++run].m_length;
+    }
+    if (end <= offset || !isInstruction(bytecode[offset])) {
+      return false;
+    }
+
+    auto   instruction = static_cast<Instruction>(bytecode[offset]);
+    size_t bytes       = immediateBytes(instruction);
+    if (offset + 1 + bytes > bytecode.size()) {
+      return false;
+    }
+    size_t immediate =
+        bytes == 0 ? 0 : bytecode.readImmediate(offset + 1, bytes);
+    size_t line  = runs[run].m_line;
+    offset      += 1 + bytes;
+
+    Node *node = nullptr;
+    switch (instruction) {
+    case Instruction::CONSTANT_U8:
+    case Instruction::CONSTANT_U16:
+    case Instruction::CONSTANT_U32:
+    case Instruction::CONSTANT_U64:
+      if (immediate >= bytecode.constantCount()) {
+        return false;
+      }
+      node           = take(Op::Constant, 0, line);
+      node->constant = bytecode.constants()[immediate];
+      break;
+
+    case Instruction::POP:
+      if (stack.empty()) {
+        return false;
+      }
+      stack.pop_back();
+      continue;
+
+    case Instruction::GET_LOCAL:
+      if (immediate >= stack.size()) {
+        return false;
+      }
+      stack.push_back(stack[immediate]);
+      continue;
+
+    case Instruction::SET_LOCAL:
+      if (immediate >= stack.size()) {
+        return false;
+      }
+      stack[immediate] = stack.back();
+      continue;
+
+    case Instruction::GET_GLOBAL:
+      node = take(Op::GetGlobal, 0, line);
+      break;
+
+    // the value stored stays on the stack, as the node stored.
+    case Instruction::SET_GLOBAL: {
+      if (stack.empty()) {
+        return false;
+      }
+      Id value = stack.back();
+      node     = take(Op::SetGlobal, 1, line);
+      stack.back() = value;
+      break;
+    }
+
+    case Instruction::DEFINE_GLOBAL:
+      node = take(Op::DefineGlobal, 1, line);
+      break;
+
+    case Instruction::NEGATE:
+      node = take(Op::Negate, 1, line);
+      break;
+
+    case Instruction::ADD:
+    case Instruction::SUB:
+    case Instruction::MUL:
+    case Instruction::DIV:
+    case Instruction::ADD_INT:
+    case Instruction::SUB_INT:
+    case Instruction::MUL_INT:
+    case Instruction::ADD_REAL:
+    case Instruction::SUB_REAL:
+    case Instruction::MUL_REAL:
+    case Instruction::DIV_REAL:
+      node = take(Op::Binary, 2, line);
+      break;
+
+    case Instruction::CALL:
+      node = take(Op::Call, immediate + 1, line);
+      break;
+
+    case Instruction::TAIL_CALL:
+      node = take(Op::TailCall, immediate + 1, line);
+      break;
+
+    case Instruction::CALL_NATIVE:
+      if (immediate >= natives.size()) {
+        return false;
+      }
+      node = take(Op::CallNative, natives[immediate].arity, line);
+      break;
+
+    // an empty stack returns zero, and the rest of the chunk is
+    // never reached.
+    case Instruction::RETURN:
+      if (stack.empty()) {
+        take(Op::Constant, 0, line)->constant = Value{0.0};
+      }
+      return take(Op::Return, 1, line) != nullptr;
+
+    default:
+      return false;
+    }
+
+    if (node == nullptr) {
+      return false;
+    }
+    node->instruction = instruction;
+    node->immediate   = (u32)(immediate);
+  }
+  return false;
+}
+
+// the result of simplifying a graph, and the tables which simplifying
+// it needed, which are kept to be reused for the next graph.
+struct Simplified {
+  size_t            folded  = 0;
+  size_t            merged  = 0;
+  size_t            removed = 0;
+  // the number of live nodes which use each node.
+  std::vector<u32>  uses;
+  std::vector<bool> live;
+
+  using Key = std::tuple<u8, u8, u64, u64, u64>;
+  struct Hash {
+    size_t operator()(Key const &key) const noexcept {
+      auto [op, variant, a, b, c] = key;
+      u64 hash = ((u64)(op) << 8) | variant;
+      for (u64 part : {a, b, c}) {
+        hash  = (hash ^ part) * 0x100000001B3ULL;
+        hash ^= hash >> 29;
+      }
+      return (size_t)(hash);
+    }
+  };
+
+  // the node each node was merged into, itself otherwise.
+  std::vector<Id>                   forward;
+  std::unordered_map<Key, Id, Hash> values;
+  // the time each global was last stored to, and the value stored,
+  // which is known until the next call.
+  std::vector<u64>                  written;
+  std::vector<Id>                   stored;
+
+  void reset(size_t nodes) {
+    folded = merged = removed = 0;
+    forward.resize(nodes);
+    for (Id id = 0; id < nodes; ++id) {
+      forward[id] = id;
+    }
+    // #NOTE clearing a map costs its bucket count, so a map grown
+    // by a large chunk is dropped rather than cleared.
+    if (values.bucket_count() > 4 * nodes + 64) {
+      values = {};
+    } else {
+      values.clear();
+    }
+    written.clear();
+    stored.clear();
+  }
+};
+
+// folds arithmetic on constants, merges nodes which compute the same
+// value (global value numbering, where a load of a global is keyed
+// by the stores and calls which came before it), forwards stored
+// values to later loads, then removes the nodes nothing uses. a node
+// which may fail is only removed by merging it with an earlier copy,
+// which fails first.
+inline void simplify(Graph &graph, Simplified &result) {
+  using Key  = Simplified::Key;
+  auto &nodes = graph.nodes;
+  result.reset(nodes.size());
+
+  u64  clock     = 0;
+  u64  clobbered = 0;
+  auto number    = [&](Id id) { return nodes[id].type == Type::Number; };
+  auto merge     = [&](Id id, Key const &key) {
+    auto [found, inserted] = result.values.try_emplace(key, id);
+    if (!inserted) {
+      result.forward[id] = found->second;
+      result.merged++;
+    }
+  };
+
+  for (Id id = 0; id < nodes.size(); ++id) {
+    Node &node     = nodes[id];
+    auto  operands = graph.operandsOf(node);
+    for (Id &operand : operands) {
+      operand = result.forward[operand];
+    }
+
+    if (node.op == Op::Negate || node.op == Op::Binary) {
+      bool constant =
+          std::all_of(operands.begin(), operands.end(), [&](Id operand) {
+            return nodes[operand].op == Op::Constant &&
+                   nodes[operand].constant.isNumber();
+          });
+      if (constant) {
+        Value a = nodes[operands[0]].constant;
+        if (node.op == Op::Negate) {
+          node.constant = negate(a);
+        } else {
+          Value b = nodes[operands[1]].constant;
+          switch (generic(node.instruction)) {
+          case Instruction::ADD: node.constant = add(a, b); break;
+          case Instruction::SUB: node.constant = sub(a, b); break;
+          case Instruction::MUL: node.constant = mul(a, b); break;
+          default:               node.constant = div(a, b); break;
+          }
+        }
+        node.op    = Op::Constant;
+        node.count = 0;
+        result.folded++;
+      }
+    }
+
+    switch (node.op) {
+    case Op::Param:
+      break;
+
+    case Op::Constant: {
+      Value const &value = node.constant;
+      node.type = value.isNumber() ? Type::Number : Type::Unknown;
+      u64 bits  = value.isInteger() ? (u64)(value.integer())
+                  : value.isReal()  ? std::bit_cast<u64>(value.real())
+                                    : std::bit_cast<u64>(value.object());
+      merge(id, Key{std::to_underlying(node.op),
+                    std::to_underlying(value.kind()), bits, 0, 0});
+      break;
+    }
+
+    case Op::GetGlobal: {
+      u64 last = node.immediate < result.written.size()
+                     ? result.written[node.immediate]
+                     : 0;
+      if (last > clobbered) {
+        result.forward[id] = result.stored[node.immediate];
+        result.merged++;
+        break;
+      }
+      node.stamp = std::max(last, clobbered);
+      merge(id, Key{std::to_underlying(node.op), 0, node.immediate,
+                    node.stamp, 0});
+      break;
+    }
+
+    // #NOTE arithmetic on an array is an array, so only arithmetic
+    // on numbers is known to be a number.
+    case Op::Negate:
+      node.type     = number(operands[0]) ? Type::Number : Type::Unknown;
+      node.may_fail = !number(operands[0]);
+      merge(id, Key{std::to_underlying(node.op), 0, operands[0], 0, 0});
+      break;
+
+    case Op::Binary: {
+      Instruction arithmetic = generic(node.instruction);
+      bool        both       = number(operands[0]) && number(operands[1]);
+      node.type              = both ? Type::Number : Type::Unknown;
+      node.may_fail          = !both;
+      merge(id, Key{std::to_underlying(node.op),
+                    std::to_underlying(arithmetic), operands[0], operands[1],
+                    0});
+      break;
+    }
+
+    // a function may store to any global, a native can not.
+    case Op::Call:
+    case Op::TailCall:
+      clobbered     = ++clock;
+      node.may_fail = true;
+      break;
+
+    case Op::CallNative:
+      node.may_fail = true;
+      break;
+
+    case Op::SetGlobal:
+    case Op::DefineGlobal:
+      if (node.immediate >= result.written.size()) {
+        result.written.resize(node.immediate + 1, 0);
+        result.stored.resize(node.immediate + 1, 0);
+      }
+      result.written[node.immediate] = ++clock;
+      result.stored[node.immediate]  = operands[0];
+      break;
+
+    case Op::Return:
+      break;
+    }
+  }
+
+  result.uses.assign(nodes.size(), 0);
+  result.live.assign(nodes.size(), false);
+  for (Id id = (Id)(nodes.size()); id-- > 0;) {
+    Node const &node = nodes[id];
+    if (result.forward[id] != id) {
+      continue;
+    }
+    if (!node.effect() && !node.may_fail && result.uses[id] == 0) {
+      if (node.op != Op::Param) {
+        result.removed++;
+      }
+      continue;
+    }
+    result.live[id] = true;
+    for (Id operand : graph.operandsOf(node)) {
+      result.uses[operand]++;
+    }
+  }
+}
+
+// lowers a simplified graph back into stack code.
+//
+// the nodes which must keep their order, those with effects, those
+// which may fail, and loads of globals, are emitted in the order they
+// were lifted. any other node is emitted where it is used, and a value
+// used more than once is computed once and left in a stack slot which
+// later uses copy with GET_LOCAL. operands already on top of the stack
+// in order are consumed in place when this is their last use.
+class Lowering {
+private:
+  Graph const     *m_graph = nullptr;
+  std::vector<u32> m_remaining;
+  std::vector<Id>  m_stack;
+  Bytecode         m_out;
+  bool             m_failed = false;
+
+  Node const &node(Id id) const noexcept { return m_graph->nodes[id]; }
+
+  bool ordered(Node const &node) const noexcept {
+    return node.effect() || node.may_fail || node.op == Op::GetGlobal;
+  }
+
+  std::optional<size_t> slotOf(Id id) const noexcept {
+    for (size_t slot = m_stack.size(); slot-- > 0;) {
+      if (m_stack[slot] == id) {
+        return slot;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // emits the nodes used more than once within the operands of a
+  // node, so each is computed once.
+  void materialize(Id id) {
+    Node const &value = node(id);
+    if (ordered(value) || value.op == Op::Param || slotOf(id)) {
+      return;
+    }
+    for (Id operand : m_graph->operandsOf(value)) {
+      materialize(operand);
+    }
+    if (m_remaining[id] > 1) {
+      emit(id);
+    }
+  }
+
+  // pushes a copy of a value, or computes it if it was never placed.
+  void push(Id id, size_t line) {
+    if (auto slot = slotOf(id)) {
+      if (*slot > UINT8_MAX) {
+        m_failed = true;
+        return;
+      }
+      m_out.emitGetLocal(*slot, line);
+      m_stack.push_back(id);
+      return;
+    }
+
+    if (ordered(node(id)) || node(id).op == Op::Param) {
+      m_failed = true;
+      return;
+    }
+    emit(id);
+  }
+
+  void place(std::span<Id const> operands, size_t line) {
+    // the longest run of operands which is the top of the stack, each
+    // used for the last time. the argument slots are never consumed.
+    size_t run = std::min(operands.size(), m_stack.size() - m_graph->params);
+    for (; run > 0; --run) {
+      size_t base  = m_stack.size() - run;
+      bool   found = true;
+      for (size_t i = 0; i < run && found; ++i) {
+        Id id = operands[i];
+        found = m_stack[base + i] == id && m_remaining[id] == 1 &&
+                std::count(operands.begin(), operands.end(), id) == 1;
+      }
+      if (found) {
+        break;
+      }
+    }
+
+    for (size_t i = run; i < operands.size() && !m_failed; ++i) {
+      push(operands[i], line);
+    }
+    for (Id id : operands) {
+      m_remaining[id]--;
+    }
+  }
+
+  void emit(Id id) {
+    Node const &value    = node(id);
+    auto        operands = m_graph->operandsOf(value);
+    for (Id operand : operands) {
+      materialize(operand);
+    }
+    place(operands, value.line);
+    if (m_failed) {
+      return;
+    }
+
+    size_t line = value.line;
+    switch (value.op) {
+    case Op::Param:
+      m_failed = true;
+      return;
+    case Op::Constant:
+      m_out.emitConstant(value.constant, line);
+      break;
+    case Op::GetGlobal:
+      m_out.emitGetGlobal(value.immediate, line);
+      break;
+    case Op::Negate:
+    case Op::Binary:
+      // every arithmetic instruction has the same encoding.
+      m_out.emitNegate(line);
+      m_out.patch(m_out.lastOffset(), value.instruction);
+      break;
+    case Op::Call:
+      m_out.emitCall(operands.size() - 1, line);
+      break;
+    case Op::TailCall:
+      m_out.emitCall(operands.size() - 1, line);
+      m_out.patch(m_out.lastOffset(), Instruction::TAIL_CALL);
+      break;
+    case Op::CallNative:
+      m_out.emitCallNative(value.immediate, line);
+      break;
+    case Op::SetGlobal:
+      m_out.emitSetGlobal(value.immediate, line);
+      break;
+    case Op::DefineGlobal:
+      m_out.emitDefineGlobal(value.immediate, line);
+      break;
+    case Op::Return:
+      m_out.emitReturn(line);
+      break;
+    }
+
+    m_stack.resize(m_stack.size() - operands.size());
+    if (value.op == Op::SetGlobal) {
+      m_stack.push_back(operands[0]);
+    } else if (value.produces()) {
+      m_stack.push_back(id);
+    }
+  }
+
+public:
+  std::optional<Bytecode> lower(Graph const &graph,
+                                Simplified const &simplified) {
+    m_graph = &graph;
+    m_remaining.assign(simplified.uses.begin(), simplified.uses.end());
+    m_stack.clear();
+    for (size_t i = 0; i < graph.params; ++i) {
+      m_stack.push_back((Id)(i));
+    }
+    m_out    = Bytecode{};
+    m_failed = false;
+
+    for (Id id = 0; id < graph.nodes.size() && !m_failed; ++id) {
+      if (!simplified.live[id] || !ordered(node(id))) {
+        continue;
+      }
+      emit(id);
+      if (node(id).op == Op::Return) {
+        break;
+      }
+
+      // drops values with no uses left, such as the result of an
+      // expression statement.
+      while (m_stack.size() > graph.params &&
+             m_remaining[m_stack.back()] == 0 && !m_failed) {
+        m_out.emitPop(node(id).line);
+        m_stack.pop_back();
+      }
+      if (m_stack.size() > UINT8_MAX + 1) {
+        m_failed = true;
+      }
+    }
+
+    if (m_failed) {
+      return std::nullopt;
+    }
+    return std::move(m_out);
+  }
+};
+} // namespace ir
+
+// runs the IR over the chunks of functions as the parser emits them,
+// and keeps the result only where it is smaller than the chunk it
+// replaces. the graph and tables of each chunk are reused by the next.
+//
+// #NOTE top level code runs once, so optimizing it never repays the
+// time spent, and it is left as it was emitted.
+class Optimizer {
+public:
+  struct Statistics {
+    size_t                   chunks    = 0; // chunks lifted
+    size_t                   rewritten = 0; // chunks replaced
+    size_t                   folded    = 0;
+    size_t                   merged    = 0;
+    size_t                   removed   = 0;
+    size_t                   before    = 0; // bytes of chunks replaced
+    size_t                   after     = 0;
+    std::chrono::nanoseconds time{0};
+
+    Statistics &operator+=(Statistics const &other) noexcept {
+      chunks    += other.chunks;
+      rewritten += other.rewritten;
+      folded    += other.folded;
+      merged    += other.merged;
+      removed   += other.removed;
+      before    += other.before;
+      after     += other.after;
+      time      += other.time;
+      return *this;
+    }
+  };
+
+private:
+  Natives const  &m_natives;
+  Statistics      m_statistics;
+  ir::Graph       m_graph;
+  ir::Simplified  m_simplified;
+  ir::Lowering    m_lowering;
+
+public:
+  explicit Optimizer(Natives const &natives) noexcept : m_natives(natives) {}
+
+  [[nodiscard]] Statistics const &statistics() const noexcept {
+    return m_statistics;
+  }
+
+  // optimizes the chunk of a function with the given number of
+  // argument slots, the function itself and its parameters.
+  // returns whether the chunk was replaced.
+  bool optimize(Bytecode &bytecode, size_t params) {
+    auto start  = std::chrono::steady_clock::now();
+    bool result = false;
+    if (ir::lift(bytecode, params, m_natives, m_graph)) {
+      m_statistics.chunks++;
+      ir::simplify(m_graph, m_simplified);
+      auto lowered = m_lowering.lower(m_graph, m_simplified);
+      if (lowered && lowered->size() < bytecode.size()) {
+        m_statistics.rewritten++;
+        m_statistics.folded  += m_simplified.folded;
+        m_statistics.merged  += m_simplified.merged;
+        m_statistics.removed += m_simplified.removed;
+        m_statistics.before  += bytecode.size();
+        m_statistics.after   += lowered->size();
+        bytecode              = std::move(*lowered);
+        result                = true;
+      }
+    }
+    m_statistics.time += std::chrono::steady_clock::now() - start;
+    return result;
+  }
+};
+
+inline void print(std::ostream &out, Optimizer::Statistics const &statistics) {
+  out << std::format(
+      "optimized {:d} of {:d} chunks, {:d} folded, {:d} merged, {:d} "
+      "removed, {:d} to {:d} bytes, in {:d}us\n",
+      statistics.rewritten, statistics.chunks, statistics.folded,
+      statistics.merged, statistics.removed, statistics.before,
+      statistics.after,
+      std::chrono::duration_cast<std::chrono::microseconds>(statistics.time)
+          .count());
+}
+
+inline std::ostream &operator<<(std::ostream                &out,
+                                Optimizer::Statistics const &statistics) {
+  print(out, statistics);
+  return out;
+}
+} // namespace voyage
@@ -0,0 +1,159 @@
+#pragma once
+#include "common.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VOYAGE_KERNELS_AVX2 1
+#endif
+
+namespace voyage::kernels {
+// the loops which apply arithmetic to every element of an array.
+// each has a vector form of four doubles at a time, compiled for
+// AVX2 whatever the build targets, which runs when the processor
+// supports it, and a scalar form otherwise, which the compiler is
+// free to vectorize for the baseline of the build.
+//
+// an operand is either an array of count elements, or a scalar
+// which is broadcast against each. the result is a fresh array,
+// whose elements are aligned, while the operands may be views
+// onto any element of another array.
+
+struct Add {
+  static f64 scalar(f64 a, f64 b) noexcept { return a + b; }
+#if defined(VOYAGE_KERNELS_AVX2)
+  [[gnu::target("avx2")]] static __m256d vector(__m256d a,
+                                                __m256d b) noexcept {
+    return _mm256_add_pd(a, b);
+  }
+#endif
+};
+
+struct Sub {
+  static f64 scalar(f64 a, f64 b) noexcept { return a - b; }
+#if defined(VOYAGE_KERNELS_AVX2)
+  [[gnu::target("avx2")]] static __m256d vector(__m256d a,
+                                                __m256d b) noexcept {
+    return _mm256_sub_pd(a, b);
+  }
+#endif
+};
+
+struct Mul {
+  static f64 scalar(f64 a, f64 b) noexcept { return a * b; }
+#if defined(VOYAGE_KERNELS_AVX2)
+  [[gnu::target("avx2")]] static __m256d vector(__m256d a,
+                                                __m256d b) noexcept {
+    return _mm256_mul_pd(a, b);
+  }
+#endif
+};
+
+struct Div {
+  static f64 scalar(f64 a, f64 b) noexcept { return a / b; }
+#if defined(VOYAGE_KERNELS_AVX2)
+  [[gnu::target("avx2")]] static __m256d vector(__m256d a,
+                                                __m256d b) noexcept {
+    return _mm256_div_pd(a, b);
+  }
+#endif
+};
+
+// one operand of a kernel, count elements, or one broadcast scalar.
+struct Operand {
+  f64 const *data;
+  bool       scalar;
+};
+
+template <class Op, bool scalar_a, bool scalar_b>
+void binaryScalar(f64 *out, f64 const *a, f64 const *b,
+                  size_t count) noexcept {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = Op::scalar(scalar_a ? *a : a[i], scalar_b ? *b : b[i]);
+  }
+}
+
+inline void negateScalar(f64 *out, f64 const *a, size_t count) noexcept {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = -a[i];
+  }
+}
+
+#if defined(VOYAGE_KERNELS_AVX2)
+template <class Op, bool scalar_a, bool scalar_b>
+[[gnu::target("avx2")]] void binaryAvx2(f64 *out, f64 const *a,
+                                        f64 const *b, size_t count) noexcept {
+  __m256d va = _mm256_set1_pd(*a);
+  __m256d vb = _mm256_set1_pd(*b);
+  size_t  i  = 0;
+  for (; i + 4 <= count; i += 4) {
+    if constexpr (!scalar_a) {
+      va = _mm256_loadu_pd(a + i);
+    }
+    if constexpr (!scalar_b) {
+      vb = _mm256_loadu_pd(b + i);
+    }
+    _mm256_store_pd(out + i, Op::vector(va, vb));
+  }
+  for (; i < count; ++i) {
+    out[i] = Op::scalar(scalar_a ? *a : a[i], scalar_b ? *b : b[i]);
+  }
+}
+
+[[gnu::target("avx2")]] inline void negateAvx2(f64 *out, f64 const *a,
+                                               size_t count) noexcept {
+  __m256d const sign = _mm256_set1_pd(-0.0);
+  size_t        i    = 0;
+  for (; i + 4 <= count; i += 4) {
+    _mm256_store_pd(out + i, _mm256_xor_pd(_mm256_loadu_pd(a + i), sign));
+  }
+  for (; i < count; ++i) {
+    out[i] = -a[i];
+  }
+}
+
+// #NOTE checked once, the answer can not change while we run.
+inline bool hasAvx2() noexcept {
+  static bool const supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+#endif
+
+// out[i] = a[i] op b[i], where at most one of the operands is a
+// scalar. out must be aligned to Array::alignment.
+template <class Op>
+void binary(f64 *out, Operand a, Operand b, size_t count) noexcept {
+  if (count == 0) {
+    return;
+  }
+#if defined(VOYAGE_KERNELS_AVX2)
+  if (hasAvx2()) {
+    if (a.scalar) {
+      binaryAvx2<Op, true, false>(out, a.data, b.data, count);
+    } else if (b.scalar) {
+      binaryAvx2<Op, false, true>(out, a.data, b.data, count);
+    } else {
+      binaryAvx2<Op, false, false>(out, a.data, b.data, count);
+    }
+    return;
+  }
+#endif
+  if (a.scalar) {
+    binaryScalar<Op, true, false>(out, a.data, b.data, count);
+  } else if (b.scalar) {
+    binaryScalar<Op, false, true>(out, a.data, b.data, count);
+  } else {
+    binaryScalar<Op, false, false>(out, a.data, b.data, count);
+  }
+}
+
+// out[i] = -a[i], which flips the sign of zeros and NaNs alike.
+inline void negate(f64 *out, f64 const *a, size_t count) noexcept {
+#if defined(VOYAGE_KERNELS_AVX2)
+  if (hasAvx2()) {
+    negateAvx2(out, a, count);
+    return;
+  }
+#endif
+  negateScalar(out, a, count);
+}
+} // namespace voyage::kernels
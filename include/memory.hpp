@@ -0,0 +1,217 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "common.hpp"
+
+namespace voyage {
+// the parts of the compiler and virtual machine whose memory
+// is accounted separately.
+enum class Subsystem : u8 {
+  Chunk,     // instructions of every Bytecode
+  Constants, // constant pools
+  Lines,     // line number runs
+  Feedback,  // arithmetic type feedback
+  Stack,     // value stacks
+  Frames,    // call frames
+  Tables,    // globals, natives, and interned strings
+  Objects,   // Strings and Functions owned by the Collector
+  Profile,   // execution counts of profiling builds
+};
+
+constexpr inline size_t subsystem_count =
+    std::to_underlying(Subsystem::Profile) + 1;
+
+inline std::string_view name(Subsystem subsystem) noexcept {
+  static constexpr std::string_view names[] = {
+      "chunk",  "constants", "lines",   "feedback", "stack",
+      "frames", "tables",    "objects", "profile",
+  };
+  return names[std::to_underlying(subsystem)];
+}
+
+// the memory use of one subsystem, summed across every thread.
+struct MemoryCounters {
+  u64 allocated   = 0; // bytes allocated over the life of the process
+  u64 freed       = 0;
+  u64 live        = 0;
+  u64 peak        = 0; // the most bytes live at once
+  u64 allocations = 0;
+};
+
+using MemoryStats = std::array<MemoryCounters, subsystem_count>;
+
+namespace memory {
+// the counters of one thread. only the owning thread writes them,
+// so an update is a plain load and store, rather than an atomic
+// read-modify-write, while a snapshot may read them from any thread.
+struct Block {
+  struct Counters {
+    std::atomic<u64> allocated   = 0;
+    std::atomic<u64> freed       = 0;
+    std::atomic<i64> peak        = 0;
+    std::atomic<u64> allocations = 0;
+  };
+
+  std::array<Counters, subsystem_count> counters;
+};
+
+// every block, which outlive their threads so that their counts
+// are kept. the block of a thread which exits is reused by the
+// next thread to allocate.
+class Registry {
+private:
+  std::mutex           m_mutex;
+  std::vector<Block *> m_blocks;
+  std::vector<Block *> m_released;
+
+public:
+  Block *acquire() {
+    std::lock_guard lock{m_mutex};
+    if (!m_released.empty()) {
+      Block *block = m_released.back();
+      m_released.pop_back();
+      return block;
+    }
+    m_blocks.push_back(new Block);
+    return m_blocks.back();
+  }
+
+  void release(Block *block) {
+    std::lock_guard lock{m_mutex};
+    m_released.push_back(block);
+  }
+
+  template <class F> void each(F &&f) {
+    std::lock_guard lock{m_mutex};
+    for (Block const *block : m_blocks) {
+      f(*block);
+    }
+  }
+};
+
+inline Registry &registry() {
+  // #NOTE never destroyed, threads may release their block during
+  // static destruction.
+  static Registry *registry = new Registry;
+  return *registry;
+}
+
+struct Local {
+  Block *block = registry().acquire();
+  ~Local() { registry().release(block); }
+};
+
+inline Block::Counters &counters(Subsystem subsystem) {
+  thread_local Local local;
+  return local.block->counters[std::to_underlying(subsystem)];
+}
+
+inline void add(std::atomic<u64> &counter, u64 amount) noexcept {
+  counter.store(counter.load(std::memory_order_relaxed) + amount,
+                std::memory_order_relaxed);
+}
+
+inline void allocated(Subsystem subsystem, size_t bytes) {
+  auto &counter = counters(subsystem);
+  add(counter.allocated, bytes);
+  add(counter.allocations, 1);
+  auto live = (i64)(counter.allocated.load(std::memory_order_relaxed) -
+                    counter.freed.load(std::memory_order_relaxed));
+  if (live > counter.peak.load(std::memory_order_relaxed)) {
+    counter.peak.store(live, std::memory_order_relaxed);
+  }
+}
+
+inline void freed(Subsystem subsystem, size_t bytes) {
+  add(counters(subsystem).freed, bytes);
+}
+} // namespace memory
+
+// the counters of every subsystem, summed across every thread.
+//
+// #NOTE memory may be freed by another thread than allocated it,
+// so the peak of a subsystem is the sum of the peaks of each thread,
+// which is exact for a single thread and an upper bound otherwise.
+inline MemoryStats memoryStats() {
+  MemoryStats stats;
+  memory::registry().each([&](memory::Block const &block) {
+    for (size_t i = 0; i < subsystem_count; ++i) {
+      auto const &counter  = block.counters[i];
+      auto       &total    = stats[i];
+      total.allocated     += counter.allocated.load(std::memory_order_relaxed);
+      total.freed         += counter.freed.load(std::memory_order_relaxed);
+      total.peak += (u64)(
+          std::max<i64>(counter.peak.load(std::memory_order_relaxed), 0));
+      total.allocations +=
+          counter.allocations.load(std::memory_order_relaxed);
+    }
+  });
+  for (auto &total : stats) {
+    total.live = total.allocated - total.freed;
+  }
+  return stats;
+}
+
+// a standard allocator which accounts every allocation against
+// the given subsystem.
+template <class T, Subsystem S> class Counted {
+public:
+  using value_type = T;
+
+  template <class U> struct rebind {
+    using other = Counted<U, S>;
+  };
+
+  Counted() noexcept = default;
+  template <class U> Counted(Counted<U, S> const &) noexcept {}
+
+  T *allocate(size_t count) {
+    T *pointer = std::allocator<T>{}.allocate(count);
+    memory::allocated(S, count * sizeof(T));
+    return pointer;
+  }
+
+  void deallocate(T *pointer, size_t count) noexcept {
+    memory::freed(S, count * sizeof(T));
+    std::allocator<T>{}.deallocate(pointer, count);
+  }
+
+  friend bool operator==(Counted const &, Counted const &) noexcept {
+    return true;
+  }
+};
+
+inline void print(std::ostream &out, MemoryStats const &stats) {
+  out << std::format("{:10s} {:>12s} {:>12s} {:>12s} {:>12s}\n", "memory",
+                     "allocated", "live", "peak", "allocations");
+  MemoryCounters total;
+  for (size_t i = 0; i < subsystem_count; ++i) {
+    auto const &counters = stats[i];
+    out << std::format("{:10s} {:12d} {:12d} {:12d} {:12d}\n",
+                       name(static_cast<Subsystem>(i)), counters.allocated,
+                       counters.live, counters.peak, counters.allocations);
+    total.allocated   += counters.allocated;
+    total.live        += counters.live;
+    total.peak        += counters.peak;
+    total.allocations += counters.allocations;
+  }
+  // #NOTE the subsystems peak at different times, so the total
+  // peak is an upper bound on the peak of the process.
+  out << std::format("{:10s} {:12d} {:12d} {:12d} {:12d}\n", "total",
+                     total.allocated, total.live, total.peak,
+                     total.allocations);
+}
+
+inline std::ostream &operator<<(std::ostream &out, MemoryStats const &stats) {
+  print(out, stats);
+  return out;
+}
+} // namespace voyage
@@ -0,0 +1,170 @@
+#pragma once
+#include <algorithm>
+#include <expected>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+#include "hash_map.hpp"
+#include "heap.hpp"
+#include "value.hpp"
+
+namespace voyage {
+// a host function callable from scripts. the arguments are the
+// argument slots of the stack, viewed in place, and the error is
+// a message with static lifetime.
+using NativeFn = std::expected<Value, std::string_view> (*)(
+    Heap &heap, std::span<Value const> arguments);
+
+struct Native {
+  String  *name;
+  u8       arity;
+  NativeFn function;
+};
+
+// the native functions of a virtual machine. the compiler binds
+// a call to a native by its index, so a call performs no lookup,
+// and an index stays valid once it is defined.
+class Natives {
+public:
+  using Names = HashMap<String *, u32>;
+
+  // indices are encoded as u16 immediates.
+  static constexpr size_t max_natives = UINT16_MAX + 1;
+
+private:
+  Names               m_names;
+  std::vector<Native> m_natives;
+
+  static u64 hashOf(String *name) noexcept { return name->hash(); }
+
+public:
+  [[nodiscard]] size_t size() const noexcept { return m_natives.size(); }
+
+  [[nodiscard]] std::optional<u32> find(String *name) noexcept {
+    auto found = m_names.find(
+        name->hash(), [name](String *other) { return other == name; });
+    if (found == nullptr) {
+      return std::nullopt;
+    }
+    return found->value;
+  }
+
+  // returns the index of the native, or nothing when there are
+  // too many natives. a native may be redefined with the same
+  // arity, code which was compiled against it has already been
+  // checked against that arity.
+  std::optional<u32> define(String *name, u8 arity, NativeFn function) {
+    if (auto index = find(name)) {
+      Native &native = m_natives[*index];
+      if (native.arity != arity) {
+        return std::nullopt;
+      }
+      native.function = function;
+      return index;
+    }
+
+    if (m_natives.size() == max_natives) {
+      return std::nullopt;
+    }
+
+    auto index = (u32)(m_natives.size());
+    m_names.insert(name->hash(), name, index, &Natives::hashOf);
+    m_natives.emplace_back(Native{name, arity, function});
+    return index;
+  }
+
+  [[nodiscard]] Native const &operator[](size_t index) const noexcept {
+    return m_natives[index];
+  }
+
+  [[nodiscard]] std::vector<Native> const &natives() const noexcept {
+    return m_natives;
+  }
+};
+
+// converts between a Value and a parameter or result type of
+// an ordinary C++ function.
+template <class T> struct Convert;
+
+template <> struct Convert<Value> {
+  static bool  accepts(Value const &) noexcept { return true; }
+  static Value from(Value const &value) noexcept { return value; }
+  static Value to(Heap &, Value value) noexcept { return value; }
+};
+
+template <> struct Convert<i64> {
+  static bool accepts(Value const &value) noexcept {
+    return value.isInteger();
+  }
+  static i64   from(Value const &value) noexcept { return value.integer(); }
+  static Value to(Heap &, i64 integer) noexcept { return Value{integer}; }
+};
+
+template <> struct Convert<f64> {
+  static bool accepts(Value const &value) noexcept { return value.isNumber(); }
+  static f64  from(Value const &value) noexcept { return value.toReal(); }
+  static Value to(Heap &, f64 real) noexcept { return Value{real}; }
+};
+
+// #NOTE the view is valid only for the duration of the call.
+template <> struct Convert<std::string_view> {
+  static bool accepts(Value const &value) noexcept {
+    return value.isString();
+  }
+  static std::string_view from(Value const &value) noexcept {
+    return value.string()->view();
+  }
+  static Value to(Heap &heap, std::string_view text) {
+    return Value{heap.intern(text)};
+  }
+};
+
+template <> struct Convert<std::string> : Convert<std::string_view> {
+  static std::string from(Value const &value) {
+    return std::string{value.string()->view()};
+  }
+};
+
+// #NOTE as for strings, the elements are valid only for the duration
+// of the call. a result is copied into a new array.
+template <> struct Convert<std::span<f64 const>> {
+  static bool accepts(Value const &value) noexcept {
+    return value.isArray();
+  }
+  static std::span<f64 const> from(Value const &value) noexcept {
+    return value.array()->elements();
+  }
+  static Value to(Heap &heap, std::span<f64 const> elements) {
+    Array *array = heap.array(elements.size());
+    std::copy(elements.begin(), elements.end(), array->data());
+    return Value{array};
+  }
+};
+
+// generates the NativeFn of an ordinary function, checking and
+// converting each argument, then converting the result.
+template <auto F> struct Adapter;
+
+template <class R, class... Args, R (*F)(Args...)> struct Adapter<F> {
+  static constexpr size_t arity = sizeof...(Args);
+  static_assert(arity <= UINT8_MAX, "too many parameters for a native");
+
+  static std::expected<Value, std::string_view>
+  call(Heap &heap, std::span<Value const> arguments) {
+    return [&]<size_t... I>(std::index_sequence<I...>)
+               -> std::expected<Value, std::string_view> {
+      if (!(Convert<std::decay_t<Args>>::accepts(arguments[I]) && ...)) {
+        return std::unexpected{"invalid argument to native function"};
+      }
+      return Convert<std::decay_t<R>>::to(
+          heap, F(Convert<std::decay_t<Args>>::from(arguments[I])...));
+    }(std::index_sequence_for<Args...>{});
+  }
+};
+} // namespace voyage
@@ -0,0 +1,75 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "common.hpp"
+
+namespace voyage {
+// the header shared by every heap allocated value. objects
+// are owned by the Heap, which links them into a list.
+class Object {
+public:
+  enum class Kind : u8 {
+    String,
+    Function,
+    Array,
+    Fiber,
+    Channel,
+  };
+
+  // the tri-color abstraction of the collector. White objects are
+  // not yet known to be reachable, Gray objects are reachable but
+  // their references have not been traced, Black objects are
+  // reachable and traced.
+  enum class Color : u8 {
+    White,
+    Gray,
+    Black,
+  };
+
+private:
+  Kind    m_kind;
+  Color   m_color = Color::White;
+  Object *m_next  = nullptr;
+
+protected:
+  explicit Object(Kind kind) noexcept : m_kind(kind) {}
+
+public:
+  Object(Object const &)            = delete;
+  Object &operator=(Object const &) = delete;
+
+  [[nodiscard]] Kind    kind() const noexcept { return m_kind; }
+  [[nodiscard]] Color   color() const noexcept { return m_color; }
+  [[nodiscard]] Object *next() const noexcept { return m_next; }
+  void                  setColor(Color color) noexcept { m_color = color; }
+  void                  setNext(Object *next) noexcept { m_next = next; }
+};
+
+// strings are immutable and interned, there is only ever one
+// String with any given text, so two strings are equal exactly
+// when they are the same object. the hash is computed once when
+// the string is interned.
+class String : public Object {
+private:
+  u64         m_hash;
+  std::string m_text;
+
+public:
+  String(std::string_view text, u64 hash)
+      : Object(Kind::String), m_hash(hash), m_text(text) {}
+
+  [[nodiscard]] u64              hash() const noexcept { return m_hash; }
+  [[nodiscard]] std::string_view view() const noexcept { return m_text; }
+  [[nodiscard]] size_t           length() const noexcept {
+    return m_text.size();
+  }
+  [[nodiscard]] size_t bytes() const noexcept {
+    return sizeof(String) + m_text.capacity();
+  }
+};
+
+// #NOTE defined in heap.hpp, which sees every kind of object.
+inline void print(std::ostream &out, Object const &object);
+} // namespace voyage
@@ -0,0 +1,168 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <unistd.h>
+
+#include "common.hpp"
+#include "heap.hpp"
+#include "value.hpp"
+
+namespace voyage {
+// how a real is written. Shortest is the fewest digits which read
+// back as the same double, Fixed is five significant digits, which
+// matches print(std::ostream&, Value const&).
+enum class RealFormat : u8 {
+  Shortest,
+  Fixed,
+};
+
+// enough for the longest integer or shortest double, including the
+// sign and exponent.
+constexpr inline size_t max_number_length = 32;
+
+// writes the text of a number into the given buffer, which must hold
+// max_number_length characters, returning the end of the text.
+inline char *formatNumber(char *first, Value const &value,
+                          RealFormat format) noexcept {
+  char *last = first + max_number_length;
+  if (value.isInteger()) {
+    return std::to_chars(first, last, value.integer()).ptr;
+  }
+
+  // #NOTE std::to_chars finds the shortest representation with
+  // Ryu, and formats with a precision exactly as std::format does.
+  if (format == RealFormat::Shortest) {
+    return std::to_chars(first, last, value.real()).ptr;
+  }
+  return std::to_chars(first, last, value.real(), std::chars_format::general,
+                       5)
+      .ptr;
+}
+
+// appends the text of a value to the given string.
+inline void appendValue(std::string &out, Value const &value,
+                        RealFormat format) {
+  if (value.isNumber()) {
+    char  buffer[max_number_length];
+    char *end = formatNumber(buffer, value, format);
+    out.append(buffer, end);
+    return;
+  }
+
+  if (value.isString()) {
+    out.append(value.string()->view());
+  } else if (value.isArray()) {
+    auto elements = value.array()->elements();
+    char buffer[max_number_length];
+    out.push_back('[');
+    for (size_t i = 0; i < elements.size(); ++i) {
+      if (i > 0) {
+        out.append(", ");
+      }
+      out.append(buffer, formatNumber(buffer, Value{elements[i]}, format));
+    }
+    out.push_back(']');
+  } else if (value.isFiber()) {
+    out.append("<fiber>");
+  } else if (value.isChannel()) {
+    out.append("<channel>");
+  } else {
+    out.append("<fn ");
+    out.append(value.function()->name()->view());
+    out.append(">");
+  }
+}
+
+// a buffer in front of a file descriptor, which is written with a
+// single write(2) each time the buffer fills, rather than one stream
+// insertion per value.
+class Output {
+public:
+  static constexpr size_t default_capacity = 1024 * 1024;
+
+private:
+  int                     m_fd;
+  RealFormat              m_format;
+  size_t                  m_capacity;
+  size_t                  m_used = 0;
+  std::unique_ptr<char[]> m_buffer;
+  bool                    m_failed = false;
+
+  void writeAll(char const *data, size_t length) noexcept {
+    while (length > 0 && !m_failed) {
+      auto count = ::write(m_fd, data, length);
+      if (count < 0) {
+        if (errno != EINTR) {
+          m_failed = true;
+        }
+        continue;
+      }
+      data   += count;
+      length -= (size_t)(count);
+    }
+  }
+
+  void reserve(size_t length) {
+    if (m_capacity - m_used < length) {
+      flush();
+    }
+  }
+
+public:
+  explicit Output(int fd, RealFormat format = RealFormat::Shortest,
+                  size_t capacity = default_capacity)
+      : m_fd(fd), m_format(format),
+        m_capacity(std::max(capacity, max_number_length)),
+        m_buffer(std::make_unique<char[]>(m_capacity)) {}
+
+  Output(Output const &)            = delete;
+  Output &operator=(Output const &) = delete;
+
+  ~Output() { flush(); }
+
+  // whether any write has failed, the output which failed is dropped.
+  [[nodiscard]] bool failed() const noexcept { return m_failed; }
+
+  void flush() noexcept {
+    writeAll(m_buffer.get(), m_used);
+    m_used = 0;
+  }
+
+  void write(std::string_view text) {
+    if (text.size() > m_capacity) {
+      // too large to buffer, write it through.
+      flush();
+      writeAll(text.data(), text.size());
+      return;
+    }
+
+    reserve(text.size());
+    std::memcpy(m_buffer.get() + m_used, text.data(), text.size());
+    m_used += text.size();
+  }
+
+  void write(char c) {
+    reserve(1);
+    m_buffer[m_used++] = c;
+  }
+
+  void write(Value const &value) {
+    if (!value.isNumber()) {
+      std::string text;
+      appendValue(text, value, m_format);
+      write(text);
+      return;
+    }
+
+    reserve(max_number_length);
+    char *end = formatNumber(m_buffer.get() + m_used, value, m_format);
+    m_used    = (size_t)(end - m_buffer.get());
+  }
+};
+} // namespace voyage
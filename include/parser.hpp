@@ -4,9 +4,16 @@
 #include <iostream>
 #include <optional>
 #include <sstream>
+#include <string>
 
 #include "bytecode.hpp"
 #include "error.hpp"
+#include "function.hpp"
+#include "globals.hpp"
+#include "heap.hpp"
+#include "ir.hpp"
+#include "natives.hpp"
+#include "profile.hpp"
 #include "scanner.hpp"
 
 namespace voyage {
@@ -35,12 +42,51 @@ public:
     Precedence precedence;
   };
 
+  // a local variable lives in a fixed stack slot, its index in
+  // locals. depth is the scope depth the local was declared in,
+  // or -1 while its initializer is being compiled.
+  struct Local {
+    std::string_view name;
+    int              depth;
+  };
+
+  // local slots are encoded as u8 immediates.
+  static constexpr size_t max_locals = UINT8_MAX + 1;
+
 private:
   bool    had_error;
   bool    panic_mode;
-  Scanner scanner;
-  Token   current;
-  Token   previous;
+  // the first error reported since parsing began.
+  std::optional<Error> first_error;
+  // set when the most recently compiled expression is known
+  // to produce an integer, so arithmetic on it can be emitted
+  // as the integer specialized instruction.
+  bool    integral;
+  // set when the expression being parsed may be the target of
+  // an assignment.
+  bool               can_assign;
+  // set when function bodies are deferred until their first call.
+  bool               lazy;
+  // set when errors are only recorded in first_error, for callers
+  // which report them themselves, rather than printed as well.
+  bool               quiet = false;
+  // when set, the deferred functions which were called in the
+  // profiled run are compiled as soon as the program is parsed.
+  Profile const         *profile = nullptr;
+  std::vector<Function *> hot;
+  // when set, the chunk of each function is optimized as soon as
+  // it is emitted.
+  Optimizer              *optimizer = nullptr;
+  // the function being compiled, nullptr for top level code.
+  Function          *function;
+  Heap              &heap;
+  Globals           &globals;
+  Natives           &natives;
+  std::vector<Local> locals;
+  int                scope_depth;
+  Scanner            scanner;
+  Token              current;
+  Token              previous;
 
   void errorAt(Token &token, std::string_view msg) {
     if (panic_mode) {
@@ -49,17 +95,25 @@ private:
 
     panic_mode = true;
     had_error  = true;
-    std::cerr << std::format("[line {:d}] Error", token.line);
 
+    std::string where;
     if (token.kind == Token::END) {
-      std::cerr << " at end";
+      where = " at end";
     } else if (token.kind == Token::ERROR) {
       // nothing
     } else {
-      std::cerr << std::format(" at '{:s}'", token.text);
+      where = std::format(" at '{:s}'", token.text);
     }
 
-    std::cerr << std::format(": {:s}\n", msg);
+    if (!quiet) {
+      std::cerr << std::format("[line {:d}] Error{:s}: {:s}\n", token.line,
+                               where, msg);
+    }
+    if (!first_error) {
+      first_error = Error{Error::Kind::Comptime,
+                          std::format("Error{:s}: {:s}", where, msg),
+                          token.line};
+    }
   }
 
   void errorAtCurrent(std::string_view msg) { errorAt(current, msg); }
@@ -90,18 +144,591 @@ private:
     errorAtCurrent(msg);
   }
 
+  bool check(Token::Kind kind) const noexcept { return current.kind == kind; }
+
+  bool match(Token::Kind kind) noexcept {
+    if (!check(kind)) {
+      return false;
+    }
+    next();
+    return true;
+  }
+
+  // skip tokens until we reach a statement boundary,
+  // so one error does not cascade into many.
+  void synchronize() noexcept {
+    panic_mode = false;
+
+    while (current.kind != Token::END) {
+      if (previous.kind == Token::SEMICOLON) {
+        return;
+      }
+
+      switch (current.kind) {
+      case Token::CLASS:
+      case Token::FUN:
+      case Token::VAR:
+      case Token::FOR:
+      case Token::IF:
+      case Token::WHILE:
+      case Token::PRINT:
+      case Token::RETURN:
+        return;
+
+      default:
+        next();
+      }
+    }
+  }
+
   ParseRule *getRule(Token::Kind kind);
   void       expression(Bytecode &bc);
   void       parsePrecedence(Bytecode &bc, Precedence precedence);
 
+  void beginScope() noexcept { scope_depth++; }
+
+  void endScope(Bytecode &bc) {
+    scope_depth--;
+
+    while (!locals.empty() && locals.back().depth > scope_depth) {
+      bc.emitPop(previous.line);
+      locals.pop_back();
+    }
+  }
+
+  // returns the slot of the named local, if there is one.
+  std::optional<size_t> resolveLocal(std::string_view name) {
+    for (size_t i = locals.size(); i > 0; --i) {
+      Local &local = locals[i - 1];
+      if (local.name == name) {
+        if (local.depth == -1) {
+          error("Can't read local variable in its own initializer.");
+        }
+        return i - 1;
+      }
+    }
+    return std::nullopt;
+  }
+
+  void declareLocal(std::string_view name) {
+    for (size_t i = locals.size(); i > 0; --i) {
+      Local &local = locals[i - 1];
+      if (local.depth != -1 && local.depth < scope_depth) {
+        break;
+      }
+
+      if (local.name == name) {
+        error("Already a variable with this name in this scope.");
+      }
+    }
+
+    if (locals.size() == max_locals) {
+      error("Too many local variables in scope.");
+      return;
+    }
+
+    locals.emplace_back(Local{name, -1});
+  }
+
+  std::optional<size_t> declareGlobal(std::string_view name) {
+    String *string = heap.intern(name);
+    if (!globals.find(string) && globals.size() == Globals::max_slots) {
+      error("Too many global variables.");
+      return std::nullopt;
+    }
+    return globals.declare(string);
+  }
+
+  // the body of a function is compiled into the chunk of the
+  // function, with its own locals. slot zero holds the function
+  // itself, the parameters follow.
+  //
+  // #NOTE there are no closures, a function body may refer to
+  // its own locals and to globals, but not to enclosing locals.
+  void functionBody(Function *compiled) {
+    Function          *enclosing_function = function;
+    std::vector<Local> enclosing_locals   = std::move(locals);
+    int                enclosing_depth    = scope_depth;
+    function                              = compiled;
+    locals.clear();
+    scope_depth = 0;
+
+    Bytecode &bc = compiled->bytecode();
+    beginScope();
+    locals.emplace_back(Local{std::string_view{}, scope_depth});
+
+    expect(Token::LEFT_PAREN, "Expect '(' after function name.");
+    size_t arity = 0;
+    if (!check(Token::RIGHT_PAREN)) {
+      do {
+        if (arity == UINT8_MAX) {
+          errorAtCurrent("Can't have more than 255 parameters.");
+        }
+        arity++;
+
+        expect(Token::IDENTIFIER, "Expect parameter name.");
+        declareLocal(previous.text);
+        if (!locals.empty()) {
+          locals.back().depth = scope_depth;
+        }
+      } while (match(Token::COMMA));
+    }
+    expect(Token::RIGHT_PAREN, "Expect ')' after parameters.");
+    compiled->setArity((u8)(arity));
+
+    expect(Token::LEFT_BRACE, "Expect '{' before function body.");
+    block(bc);
+
+    // #TODO return nil
+    bc.emitConstant(Value{i64{0}}, previous.line);
+    bc.emitReturn(previous.line);
+
+    if (optimizer != nullptr && !had_error) {
+      optimizer->optimize(bc, arity + 1);
+    }
+
+    if constexpr (debug_print) {
+      if (!had_error) {
+        std::cout << std::format("== {:s} ==\n", compiled->name()->view());
+        print(std::cout, bc);
+      }
+    }
+
+    function    = enclosing_function;
+    locals      = std::move(enclosing_locals);
+    scope_depth = enclosing_depth;
+  }
+
+  // records the source of the parameters and body of a function,
+  // from the '(' up to the matching '}', without compiling it.
+  // the tokens are only counted, so errors within the body are
+  // reported when it is compiled on its first call.
+  void deferredBody(Function *deferred) {
+    if (!check(Token::LEFT_PAREN)) {
+      errorAtCurrent("Expect '(' after function name.");
+      return;
+    }
+
+    auto   begin  = current.text.begin();
+    size_t line   = current.line;
+    size_t braces = 0;
+    bool   opened = false;
+    while (!check(Token::END)) {
+      if (check(Token::LEFT_BRACE)) {
+        braces++;
+        opened = true;
+      } else if (check(Token::RIGHT_BRACE) && braces > 0) {
+        braces--;
+      }
+
+      next();
+      if (opened && braces == 0) {
+        break;
+      }
+    }
+
+    if (!opened || braces != 0) {
+      errorAtCurrent("Expect '}' after block.");
+      return;
+    }
+
+    deferred->defer(std::string_view{begin, previous.text.end()}, line);
+  }
+
+  Function *functionDeclaration(Token name) {
+    Function *declared = heap.function(heap.intern(name.text));
+    declared->setDeclared(name.line);
+    if (lazy) {
+      deferredBody(declared);
+      if (profile != nullptr && profile->calls(name.text, name.line) != 0) {
+        hot.push_back(declared);
+      }
+    } else {
+      functionBody(declared);
+    }
+    return declared;
+  }
+
+  void funDeclaration(Bytecode &bc) {
+    expect(Token::IDENTIFIER, "Expect function name.");
+    Token name = previous;
+
+    // the name is declared before the body is compiled,
+    // so that a global function may call itself.
+    if (scope_depth > 0) {
+      declareLocal(name.text);
+      if (!locals.empty()) {
+        locals.back().depth = scope_depth;
+      }
+      bc.emitConstant(Value{functionDeclaration(name)}, name.line);
+      return;
+    }
+
+    auto slot = declareGlobal(name.text);
+    bc.emitConstant(Value{functionDeclaration(name)}, name.line);
+    if (slot) {
+      bc.emitDefineGlobal(*slot, name.line);
+    }
+  }
+
+  void returnStatement(Bytecode &bc) {
+    if (function == nullptr) {
+      error("Can't return from top-level code.");
+    }
+
+    if (match(Token::SEMICOLON)) {
+      // #TODO return nil
+      bc.emitConstant(Value{i64{0}}, previous.line);
+      bc.emitReturn(previous.line);
+      return;
+    }
+
+    expression(bc);
+    // a call which is the entire operand of a return
+    // statement is in tail position.
+    if (static_cast<Instruction>(bc[bc.lastOffset()]) == Instruction::CALL) {
+      bc.patch(bc.lastOffset(), Instruction::TAIL_CALL);
+    }
+    expect(Token::SEMICOLON, "Expect ';' after return value.");
+    bc.emitReturn(previous.line);
+  }
+
+  void varDeclaration(Bytecode &bc) {
+    expect(Token::IDENTIFIER, "Expect variable name.");
+    Token name = previous;
+
+    if (scope_depth > 0) {
+      declareLocal(name.text);
+    }
+
+    if (match(Token::EQUAL)) {
+      expression(bc);
+    } else {
+      // #TODO initialize to nil
+      bc.emitConstant(Value{i64{0}}, name.line);
+    }
+    expect(Token::SEMICOLON, "Expect ';' after variable declaration.");
+
+    if (scope_depth > 0) {
+      // the value of the initializer is already in the locals slot.
+      if (!locals.empty()) {
+        locals.back().depth = scope_depth;
+      }
+      return;
+    }
+
+    // #NOTE the global is declared after the initializer is compiled,
+    // so the initializer cannot refer to the global itself.
+    if (auto slot = declareGlobal(name.text)) {
+      bc.emitDefineGlobal(*slot, name.line);
+    }
+  }
+
+  void block(Bytecode &bc) {
+    while (!check(Token::RIGHT_BRACE) && !check(Token::END)) {
+      declaration(bc);
+    }
+
+    expect(Token::RIGHT_BRACE, "Expect '}' after block.");
+  }
+
+  void expressionStatement(Bytecode &bc) {
+    expression(bc);
+    expect(Token::SEMICOLON, "Expect ';' after expression.");
+    bc.emitPop(previous.line);
+  }
+
+  void statement(Bytecode &bc) {
+    if (match(Token::RETURN)) {
+      returnStatement(bc);
+    } else if (match(Token::LEFT_BRACE)) {
+      beginScope();
+      block(bc);
+      endScope(bc);
+    } else {
+      expressionStatement(bc);
+    }
+  }
+
+  void declaration(Bytecode &bc) {
+    if (match(Token::FUN)) {
+      funDeclaration(bc);
+    } else if (match(Token::VAR)) {
+      varDeclaration(bc);
+    } else {
+      statement(bc);
+    }
+
+    if (panic_mode) {
+      synchronize();
+    }
+  }
+
+  // a program is a sequence of declarations, optionally followed
+  // by an expression without a trailing ';', whose value is the
+  // result of the program.
+  void program(Bytecode &bc) {
+    while (!check(Token::END)) {
+      if (check(Token::FUN) || check(Token::VAR) || check(Token::RETURN) ||
+          check(Token::LEFT_BRACE)) {
+        declaration(bc);
+        continue;
+      }
+
+      expression(bc);
+      if (check(Token::END)) {
+        break;
+      }
+
+      expect(Token::SEMICOLON, "Expect ';' after expression.");
+      bc.emitPop(previous.line);
+
+      if (panic_mode) {
+        synchronize();
+      }
+    }
+  }
+
+  void variable(Bytecode &bc) {
+    Token name       = previous;
+    bool  assignable = can_assign;
+    integral         = false;
+
+    if (auto slot = resolveLocal(name.text)) {
+      if (assignable && match(Token::EQUAL)) {
+        expression(bc);
+        bc.emitSetLocal(*slot, name.line);
+      } else {
+        bc.emitGetLocal(*slot, name.line);
+      }
+      return;
+    }
+
+    String *string = heap.intern(name.text);
+    auto    slot   = globals.find(string);
+    if (!slot) {
+      if (auto index = natives.find(string)) {
+        nativeCall(bc, *index);
+        return;
+      }
+      error(std::format("Undefined variable '{:s}'.", name.text));
+      return;
+    }
+
+    if (assignable && match(Token::EQUAL)) {
+      expression(bc);
+      bc.emitSetGlobal(*slot, name.line);
+    } else {
+      bc.emitGetGlobal(*slot, name.line);
+    }
+  }
+
   void number(Bytecode &bc) {
-    double value = 0.0;
-    auto [ptr, ec] =
-        std::from_chars(previous.text.begin(), previous.text.end(), value);
+    auto begin = std::to_address(previous.text.begin());
+    auto end   = std::to_address(previous.text.end());
+
+    // #NOTE a literal without a decimal point is an integer,
+    // unless it is too large to be represented as one.
+    if (previous.text.find('.') == std::string_view::npos) {
+      i64 value      = 0;
+      auto [ptr, ec] = std::from_chars(begin, end, value);
+      if (ec == std::errc{}) {
+        integral = true;
+        bc.emitConstant(Value{value}, previous.line);
+        return;
+      }
+
+      if (ec != std::errc::result_out_of_range) {
+        error(ec);
+      }
+    }
+
+    double value   = 0.0;
+    auto [ptr, ec] = std::from_chars(begin, end, value);
     if (ec != std::errc{}) {
       error(ec);
     }
-    bc.emitConstant({value}, previous.line);
+    integral = false;
+    bc.emitConstant(Value{value}, previous.line);
+  }
+
+  void string(Bytecode &bc) {
+    // #NOTE the token includes the surrounding quotes.
+    auto    text   = previous.text.substr(1, previous.text.size() - 2);
+    String *string = heap.intern(text);
+    integral       = false;
+    bc.emitConstant(Value{string}, previous.line);
+  }
+
+  // reads an array literal whose elements are all number literals,
+  // each possibly negated, into an array, which the literal then
+  // pushes as a constant rather than building it each time it runs.
+  // otherwise the tokens read are given back, and nothing is returned.
+  Array *constantArray() {
+    Scanner          scanned  = scanner;
+    Token            ahead    = current;
+    Token            behind   = previous;
+    bool             constant = true;
+    std::vector<f64> elements;
+    if (!check(Token::RIGHT_BRACKET)) {
+      do {
+        bool negated = match(Token::MINUS);
+        f64  value   = 0.0;
+        auto text    = current.text;
+        if (!check(Token::NUMBER) ||
+            std::from_chars(text.data(), text.data() + text.size(), value)
+                    .ec != std::errc{}) {
+          constant = false;
+          break;
+        }
+        next();
+        if (!check(Token::COMMA) && !check(Token::RIGHT_BRACKET)) {
+          constant = false;
+          break;
+        }
+        elements.push_back(negated ? -value : value);
+      } while (match(Token::COMMA));
+    }
+
+    if (!constant || !match(Token::RIGHT_BRACKET)) {
+      scanner  = scanned;
+      current  = ahead;
+      previous = behind;
+      return nullptr;
+    }
+
+    Array *array = heap.array(elements.size());
+    std::copy(elements.begin(), elements.end(), array->data());
+    return array;
+  }
+
+  void array(Bytecode &bc) {
+    size_t line = previous.line;
+    integral    = false;
+    if (Array *constant = constantArray()) {
+      bc.emitConstant(Value{constant}, line);
+      return;
+    }
+
+    size_t count = 0;
+    if (!check(Token::RIGHT_BRACKET)) {
+      do {
+        expression(bc);
+        if (count == UINT16_MAX) {
+          error("Can't have more than 65535 elements in an array.");
+        }
+        count++;
+      } while (match(Token::COMMA));
+    }
+    expect(Token::RIGHT_BRACKET, "Expect ']' after array elements.");
+    integral = false;
+    bc.emitArray(count, line);
+  }
+
+  // an index, a[i], or a slice, a[i:j], where either bound of
+  // a slice may be left out.
+  void subscript(Bytecode &bc) {
+    size_t line   = previous.line;
+    u8     bounds = 0;
+    if (!check(Token::COLON)) {
+      expression(bc);
+      bounds |= slice_start;
+    }
+
+    if (match(Token::COLON)) {
+      if (!check(Token::RIGHT_BRACKET)) {
+        expression(bc);
+        bounds |= slice_end;
+      }
+      expect(Token::RIGHT_BRACKET, "Expect ']' after slice.");
+      bc.emitSlice(bounds, line);
+    } else {
+      expect(Token::RIGHT_BRACKET, "Expect ']' after index.");
+      bc.emitIndex(line);
+    }
+    integral = false;
+  }
+
+  size_t argumentList(Bytecode &bc) {
+    size_t arguments = 0;
+    if (!check(Token::RIGHT_PAREN)) {
+      do {
+        expression(bc);
+        if (arguments == UINT8_MAX) {
+          error("Can't have more than 255 arguments.");
+        }
+        arguments++;
+      } while (match(Token::COMMA));
+    }
+    expect(Token::RIGHT_PAREN, "Expect ')' after arguments.");
+    return arguments;
+  }
+
+  void call(Bytecode &bc) {
+    size_t arguments = argumentList(bc);
+    integral         = false;
+    bc.emitCall(arguments, previous.line);
+  }
+
+  // a native is bound by its index where it is called, so it
+  // may only be called, and its arity is checked here.
+  void nativeCall(Bytecode &bc, u32 index) {
+    expect(Token::LEFT_PAREN, "Can only call a native function.");
+    size_t arguments = argumentList(bc);
+    if (arguments != natives[index].arity) {
+      error(std::format("Expected {:d} arguments but got {:d}.",
+                        natives[index].arity, arguments));
+    }
+    integral = false;
+    bc.emitCallNative(index, previous.line);
+  }
+
+  // a call, compiled as any other, which then runs in a fiber of its
+  // own, rather than in the caller, to which the fiber is returned.
+  void spawn(Bytecode &bc) {
+    size_t start = bc.size();
+    parsePrecedence(bc, Precedence::CALL);
+    if (bc.size() == start ||
+        static_cast<Instruction>(bc[bc.lastOffset()]) != Instruction::CALL) {
+      error("Can only spawn a call.");
+      return;
+    }
+    bc.patch(bc.lastOffset(), Instruction::SPAWN);
+    integral = false;
+  }
+
+  // join(fiber), channel(capacity), send(channel, value) and
+  // receive(channel) read as calls, but each compiles to an
+  // instruction of its own.
+  void builtin(Bytecode &bc) {
+    Token name = previous;
+    if (!match(Token::LEFT_PAREN)) {
+      errorAtCurrent(std::format("Expect '(' after '{:s}'.", name.text));
+    }
+    size_t arguments = argumentList(bc);
+    size_t arity     = name.kind == Token::SEND ? 2 : 1;
+    if (arguments != arity) {
+      error(std::format("Expected {:d} arguments but got {:d}.", arity,
+                        arguments));
+    }
+    integral = false;
+
+    switch (name.kind) {
+    case Token::JOIN:
+      bc.emitJoin(previous.line);
+      break;
+    case Token::CHANNEL:
+      bc.emitChannel(previous.line);
+      break;
+    case Token::SEND:
+      bc.emitSend(previous.line);
+      break;
+    case Token::RECEIVE:
+      bc.emitReceive(previous.line);
+      break;
+    default:
+      std::unreachable();
+    }
   }
 
   void grouping(Bytecode &bc) {
@@ -129,40 +756,134 @@ private:
   void binary(Bytecode &bc) {
     Token::Kind operator_kind = previous.kind;
     ParseRule  *rule          = getRule(operator_kind);
+    bool        lhs_integral  = integral;
     parsePrecedence(bc, (Precedence)(rule->precedence + 1));
+    bool both_integral = lhs_integral && integral;
 
     switch (operator_kind) {
     case Token::PLUS:
-      bc.emitAdd(previous.line);
+      if (both_integral) {
+        bc.emitAddInt(previous.line);
+      } else {
+        bc.emitAdd(previous.line);
+      }
       break;
 
     case Token::MINUS:
-      bc.emitSub(previous.line);
+      if (both_integral) {
+        bc.emitSubInt(previous.line);
+      } else {
+        bc.emitSub(previous.line);
+      }
       break;
 
     case Token::STAR:
-      bc.emitMul(previous.line);
+      if (both_integral) {
+        bc.emitMulInt(previous.line);
+      } else {
+        bc.emitMul(previous.line);
+      }
       break;
 
     case Token::SLASH:
       bc.emitDiv(previous.line);
+      both_integral = false;
       break;
 
     default: {
       std::unreachable();
     }
     }
+
+    integral = both_integral;
+  }
+
+  bool compileBody(Function &deferred) {
+    scanner.set(deferred.source(), deferred.line());
+    had_error   = false;
+    panic_mode  = false;
+    first_error.reset();
+    function    = nullptr;
+    scope_depth = 0;
+    locals.clear();
+
+    next();
+    functionBody(&deferred);
+    if (!check(Token::END)) {
+      errorAtCurrent("Expect end of function body.");
+    }
+
+    if (had_error) {
+      // the body is compiled again if the function is called again.
+      deferred.bytecode() = Bytecode{};
+      return false;
+    }
+
+    deferred.markCompiled();
+    return true;
+  }
+
+  // compiles the hot functions, once every global they may refer to
+  // has been declared, so they resolve as they would when compiled
+  // on their first call. a function which fails to compile stays
+  // deferred, and reports its errors when it is called.
+  void compileHot() {
+    while (!hot.empty()) {
+      Function *deferred = hot.back();
+      hot.pop_back();
+      compileBody(*deferred);
+    }
   }
 
 public:
-  Parser() noexcept : had_error(false), panic_mode(false) {}
+  Parser(Heap &heap, Globals &globals, Natives &natives,
+         bool lazy = true) noexcept
+      : had_error(false), panic_mode(false), integral(false),
+        can_assign(false), lazy(lazy), function(nullptr), heap(heap),
+        globals(globals), natives(natives), scope_depth(0) {}
+
+  // guides the compilation of later programs by the given profile,
+  // which must outlive the parser, or by none.
+  void guide(Profile const *guide) noexcept { profile = guide; }
+
+  // optimizes the functions compiled from now on with the given
+  // optimizer, which must outlive the parser, or with none.
+  void optimizeWith(Optimizer *optimizing) noexcept {
+    optimizer = optimizing;
+  }
+
+  // records errors in firstError only, without printing them.
+  void quieten(bool quieting) noexcept { quiet = quieting; }
+
+  [[nodiscard]] std::optional<Error> const &firstError() const noexcept {
+    return first_error;
+  }
+
+  // compiles the body of a deferred function into its chunk.
+  // globals are resolved now, rather than where the function
+  // was declared.
+  bool compile(Function &deferred) {
+    if (!compileBody(deferred)) {
+      hot.clear();
+      return false;
+    }
+    compileHot();
+    return true;
+  }
 
   std::optional<Bytecode> parse(std::string_view text) {
     scanner.set(text);
+    had_error   = false;
+    panic_mode  = false;
+    first_error.reset();
+    function    = nullptr;
+    scope_depth = 0;
+    locals.clear();
 
     Bytecode bc;
+    hot.clear();
     next();
-    expression(bc);
+    program(bc);
 
     if (had_error) {
       return std::nullopt;
@@ -173,16 +894,18 @@ public:
         print(std::cout, bc);
       }
 
+      compileHot();
       return bc;
     }
   }
 };
 
-void Parser::expression(Bytecode &bc) {
+inline void Parser::expression(Bytecode &bc) {
   parsePrecedence(bc, Precedence::ASSIGNMENT);
 }
 
-void Parser::parsePrecedence(Bytecode &bc, Precedence precedence) {
+inline void Parser::parsePrecedence(Bytecode  &bc,
+                                    Precedence precedence) {
   next();
   ParseFn prefix = getRule(previous.kind)->prefix;
   if (prefix == nullptr) {
@@ -190,62 +913,77 @@ void Parser::parsePrecedence(Bytecode &bc, Precedence precedence) {
     return;
   }
 
+  bool assignable = precedence <= Precedence::ASSIGNMENT;
+  can_assign      = assignable;
   (this->*prefix)(bc);
 
   while (precedence <= getRule(current.kind)->precedence) {
     next();
     ParseFn infix = getRule(previous.kind)->infix;
+    can_assign    = assignable;
     (this->*infix)(bc);
   }
+
+  if (assignable && match(Token::EQUAL)) {
+    error("Invalid assignment target.");
+  }
 }
 
-Parser::ParseRule *Parser::getRule(Token::Kind kind) {
+inline Parser::ParseRule *Parser::getRule(Token::Kind kind) {
   static ParseRule rules[] = {
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-
-      {&Parser::grouping, nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-
-      {&Parser::unary,    &Parser::binary, Precedence::TERM  },
-      {nullptr,           &Parser::binary, Precedence::TERM  },
-      {nullptr,           &Parser::binary, Precedence::FACTOR},
-      {nullptr,           &Parser::binary, Precedence::FACTOR},
-
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {&Parser::number,   nullptr,         Precedence::NONE  },
-
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
-      {nullptr,           nullptr,         Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+
+      {&Parser::grouping, &Parser::call,      Precedence::CALL  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {&Parser::array,    &Parser::subscript, Precedence::CALL  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+
+      {&Parser::unary,    &Parser::binary,    Precedence::TERM  },
+      {nullptr,           &Parser::binary,    Precedence::TERM  },
+      {nullptr,           &Parser::binary,    Precedence::FACTOR},
+      {nullptr,           &Parser::binary,    Precedence::FACTOR},
+
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+
+      {&Parser::variable, nullptr,            Precedence::NONE  },
+      {&Parser::string,   nullptr,            Precedence::NONE  },
+      {&Parser::number,   nullptr,            Precedence::NONE  },
+
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {&Parser::builtin,  nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {&Parser::builtin,  nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {&Parser::builtin,  nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {&Parser::builtin,  nullptr,            Precedence::NONE  },
+      {&Parser::spawn,    nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
+      {nullptr,           nullptr,            Precedence::NONE  },
   };
 
   return &rules[kind];
@@ -0,0 +1,183 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "common.hpp"
+#include "function.hpp"
+
+namespace voyage {
+// the execution counts of a run of a script, mapped from the
+// offsets of instructions onto the source lines they were compiled
+// from, so that a profile stays meaningful when the script is
+// compiled again. the counts are taken by builds configured with
+// VOYAGE_PROFILE, and guide the compiler, which compiles the
+// functions that were called as soon as the program is parsed, and
+// leaves only those which were not deferred until their first call.
+//
+// a profile is written as text, a header line followed by one
+// record per line:
+//
+//   voyage-profile 1
+//   line <line> <instructions executed>
+//   call <line> <calls> <name>
+//
+// where the line of a call is the line the function was declared on.
+class Profile {
+public:
+  using Key = std::pair<std::string, size_t>;
+
+  static constexpr std::string_view header = "voyage-profile 1";
+
+private:
+  std::map<size_t, u64> m_lines;
+  std::map<Key, u64>    m_calls;
+
+public:
+  [[nodiscard]] bool empty() const noexcept {
+    return m_lines.empty() && m_calls.empty();
+  }
+  [[nodiscard]] std::map<size_t, u64> const &lines() const noexcept {
+    return m_lines;
+  }
+  [[nodiscard]] std::map<Key, u64> const &calls() const noexcept {
+    return m_calls;
+  }
+
+  // the number of times the named function, declared on the given
+  // line, was called.
+  [[nodiscard]] u64 calls(std::string_view name, size_t line) const {
+    auto found = m_calls.find(Key{std::string{name}, line});
+    return found == m_calls.end() ? 0 : found->second;
+  }
+
+  // adds the counts of the chunk, and of every function compiled
+  // within it. a function is called once for each time the first
+  // instruction of its chunk was executed.
+  void record(Bytecode const &bytecode) {
+    auto const &counts = bytecode.counts();
+    for (size_t offset = 0; offset < counts.size(); ++offset) {
+      if (counts[offset] != 0) {
+        m_lines[bytecode.getLine(offset)] += counts[offset];
+      }
+    }
+
+    for (Value const &constant : bytecode.constants()) {
+      if (!constant.isFunction()) {
+        continue;
+      }
+      auto const *function = constant.function();
+      if (!function->compiled()) {
+        continue;
+      }
+
+      auto const &body = function->bytecode();
+      if (!body.counts().empty() && body.counts()[0] != 0) {
+        m_calls[Key{std::string{function->name()->view()},
+                    function->declared()}] += body.counts()[0];
+      }
+      record(body);
+    }
+  }
+
+  [[nodiscard]] std::string write() const {
+    std::string out{header};
+    out.push_back('\n');
+    for (auto const &[line, count] : m_lines) {
+      out.append(std::format("line {:d} {:d}\n", line, count));
+    }
+    for (auto const &[key, count] : m_calls) {
+      out.append(std::format("call {:d} {:d} {:s}\n", key.second, count,
+                             key.first));
+    }
+    return out;
+  }
+
+  // reads a profile written by write, or returns nothing when the
+  // text is not a profile.
+  static std::optional<Profile> read(std::string_view text) {
+    auto next_line = [&]() -> std::string_view {
+      size_t end  = std::min(text.find('\n'), text.size());
+      auto   line = text.substr(0, end);
+      text.remove_prefix(std::min(end + 1, text.size()));
+      return line;
+    };
+    auto next_field = [](std::string_view &line) -> std::string_view {
+      size_t end   = std::min(line.find(' '), line.size());
+      auto   field = line.substr(0, end);
+      line.remove_prefix(std::min(end + 1, line.size()));
+      return field;
+    };
+    auto number = [](std::string_view field) -> std::optional<u64> {
+      u64  value = 0;
+      auto [ptr, ec] =
+          std::from_chars(field.data(), field.data() + field.size(), value);
+      if (ec != std::errc{} || ptr != field.data() + field.size()) {
+        return std::nullopt;
+      }
+      return value;
+    };
+
+    if (next_line() != header) {
+      return std::nullopt;
+    }
+
+    Profile profile;
+    while (!text.empty()) {
+      auto line = next_line();
+      if (line.empty()) {
+        continue;
+      }
+
+      auto kind  = next_field(line);
+      auto at    = number(next_field(line));
+      auto count = number(next_field(line));
+      if (!at || !count) {
+        return std::nullopt;
+      }
+
+      if (kind == "line") {
+        profile.m_lines[*at] += *count;
+      } else if (kind == "call" && !line.empty()) {
+        profile.m_calls[Key{std::string{line}, *at}] += *count;
+      } else {
+        return std::nullopt;
+      }
+    }
+    return profile;
+  }
+};
+
+// the hottest lines of the profile, and the calls of each function.
+inline void print(std::ostream &out, Profile const &profile,
+                  size_t limit = 10) {
+  std::vector<std::pair<size_t, u64>> lines{profile.lines().begin(),
+                                            profile.lines().end()};
+  std::sort(lines.begin(), lines.end(), [](auto const &a, auto const &b) {
+    return a.second > b.second;
+  });
+  lines.resize(std::min(lines.size(), limit));
+
+  out << "line      instructions\n";
+  for (auto const &[line, count] : lines) {
+    out << std::format("{:4d} {:17d}\n", line, count);
+  }
+  out << "line             calls function\n";
+  for (auto const &[key, count] : profile.calls()) {
+    out << std::format("{:4d} {:17d} {:s}\n", key.second, count, key.first);
+  }
+}
+
+inline std::ostream &operator<<(std::ostream &out, Profile const &profile) {
+  print(out, profile);
+  return out;
+}
+} // namespace voyage
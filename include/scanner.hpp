@@ -12,6 +12,8 @@ public:
 private:
   iterator m_start;
   iterator m_cursor;
+  // #NOTE the text is a view, which need not be followed by '\0'.
+  iterator m_end;
   size_t   m_line;
 
   static bool isDigit(char c) noexcept { return c >= '0' && c <= '9'; }
@@ -33,12 +35,18 @@ private:
     return m_cursor[-1];
   }
 
-  char peek() const noexcept { return *m_cursor; }
-  char peekNext() const noexcept {
+  char peek() const noexcept {
     if (atEnd()) {
       return '\0';
     }
 
+    return *m_cursor;
+  }
+  char peekNext() const noexcept {
+    if (std::distance(m_cursor, m_end) < 2) {
+      return '\0';
+    }
+
     return m_cursor[1];
   }
 
@@ -82,7 +90,7 @@ private:
   }
 
   Token string() noexcept {
-    while (peek() != '\n' && !atEnd()) {
+    while (peek() != '"' && !atEnd()) {
       if (peek() == '\n') {
         m_line++;
       }
@@ -132,7 +140,15 @@ private:
     case 'a':
       return checkKeyword(1, 2, "nd", Token::AND);
     case 'c':
-      return checkKeyword(1, 4, "lass", Token::CLASS);
+      if (std::distance(m_start, m_cursor) > 1) {
+        switch (m_start[1]) {
+        case 'h':
+          return checkKeyword(2, 5, "annel", Token::CHANNEL);
+        case 'l':
+          return checkKeyword(2, 3, "ass", Token::CLASS);
+        }
+      }
+      break;
     case 'e':
       return checkKeyword(1, 3, "lse", Token::ELSE);
     case 'f':
@@ -151,6 +167,8 @@ private:
       break;
     case 'i':
       return checkKeyword(1, 1, "f", Token::IF);
+    case 'j':
+      return checkKeyword(1, 3, "oin", Token::JOIN);
     case 'n':
       return checkKeyword(1, 2, "il", Token::NIL);
     case 'o':
@@ -158,9 +176,29 @@ private:
     case 'p':
       return checkKeyword(1, 4, "rint", Token::PRINT);
     case 'r':
-      return checkKeyword(1, 5, "eturn", Token::RETURN);
+      // #NOTE both keywords begin "re", the third letter tells them
+      // apart.
+      if (std::distance(m_start, m_cursor) > 2 && m_start[1] == 'e') {
+        switch (m_start[2]) {
+        case 'c':
+          return checkKeyword(3, 4, "eive", Token::RECEIVE);
+        case 't':
+          return checkKeyword(3, 3, "urn", Token::RETURN);
+        }
+      }
+      break;
     case 's':
-      return checkKeyword(1, 4, "uper", Token::SUPER);
+      if (std::distance(m_start, m_cursor) > 1) {
+        switch (m_start[1]) {
+        case 'e':
+          return checkKeyword(2, 2, "nd", Token::SEND);
+        case 'p':
+          return checkKeyword(2, 3, "awn", Token::SPAWN);
+        case 'u':
+          return checkKeyword(2, 3, "per", Token::SUPER);
+        }
+      }
+      break;
     case 't':
       if (std::distance(m_start, m_cursor) > 1) {
         switch (m_start[1]) {
@@ -192,15 +230,21 @@ public:
   Scanner() noexcept : m_line(1) {}
 
   void reset() noexcept {
-    m_start = m_cursor = iterator{};
-    m_line             = 1;
+    m_start = m_cursor = m_end = iterator{};
+    m_line                     = 1;
   }
 
   void set(std::string_view text) noexcept {
     m_start = m_cursor = text.begin();
+    m_end              = text.end();
+  }
+
+  void set(std::string_view text, size_t line) noexcept {
+    set(text);
+    m_line = line;
   }
 
-  bool atEnd() const noexcept { return *m_cursor == '\0'; }
+  bool atEnd() const noexcept { return m_cursor == m_end; }
 
   size_t line() const noexcept { return m_line; }
 
@@ -222,8 +266,14 @@ public:
       return make(Token::LEFT_BRACE);
     case '}':
       return make(Token::RIGHT_BRACE);
+    case '[':
+      return make(Token::LEFT_BRACKET);
+    case ']':
+      return make(Token::RIGHT_BRACKET);
     case ';':
       return make(Token::SEMICOLON);
+    case ':':
+      return make(Token::COLON);
     case ',':
       return make(Token::COMMA);
     case '.':
@@ -0,0 +1,28 @@
+#pragma once
+#include <string_view>
+
+namespace voyage {
+// serves evaluation requests on a Unix domain socket until it is
+// interrupted, then reports the latency percentiles of the requests
+// it served. returns the exit status of the process.
+//
+// every integer is big endian. a request is a frame:
+//
+//   u32 length   of the rest of the frame
+//   u32 length   source
+//   u16 count    of inputs, each of which is
+//     u16 length name
+//     u8  kind   0 integer, 1 real, 2 string
+//     i64 | f64 | u32 length text
+//
+// and each request is answered, in order, with a frame:
+//
+//   u32 length   of the rest of the frame
+//   u8  status   0 the text is the result, 1 the text is an error
+//   text
+//
+// requests are routed to workers by the hash of their source, each
+// worker caches the programs it has compiled, so a repeated source
+// is not parsed again.
+int serve(std::string_view path, unsigned workers);
+} // namespace voyage
@@ -0,0 +1,440 @@
+#pragma once
+#include <bit>
+#include <expected>
+#include <format>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "artifact.hpp"
+#include "function.hpp"
+#include "globals.hpp"
+#include "heap.hpp"
+#include "natives.hpp"
+
+namespace voyage {
+// the state of a virtual machine once a script has run, its globals
+// and every function they reach, written so that a later process
+// starts from it rather than parsing and running the script again.
+// every integer is big endian, and a snapshot is
+//
+//   "voyage-snapshot" magic
+//   u32 format        snapshot_format
+//   text version      of the compiler which wrote it
+//   u64 length        of the header
+//   header
+//   u64 checksum      of the header
+//   the body of each function
+//
+// where the header is
+//
+//   u32 count of natives, each a text name followed by a u8 arity
+//   u32 count of functions, each a text name, u64 declared line,
+//       u8 arity, then the u64 offset, u64 length and u64 checksum
+//       of its body
+//   u32 count of globals, each a text name followed by a value
+//
+// a value is a u8 tag followed by
+//
+//   0 i64 | 1 f64 | 2 text | 3 u32 index of a function
+//   4 u64 count of elements, each an f64
+//
+// and the body of a function is a u8 which is 1 when it was compiled,
+// followed by its chunk, as in an artifact but for its constants being
+// values, otherwise a u64 line and the text of its deferred body.
+//
+// a snapshot is restored by mapping it into memory, where only the
+// header is read up front. the body of each function is read, and
+// its checksum checked, on the first call of the function, so the
+// cost of a restore follows the pages of the snapshot a run touches
+// rather than its size.
+//
+// #NOTE the stack of a virtual machine is empty between runs, and is
+// not part of a snapshot. neither are suspended tasks, nor fibers
+// and channels, a global holding either fails the snapshot.
+constexpr inline u32              snapshot_format = 3;
+constexpr inline std::string_view snapshot_magic  = "voyage-snapshot";
+
+namespace snapshot {
+// the indices of the functions of a snapshot.
+using Indices = std::unordered_map<Function const *, u32>;
+
+inline void value(artifact::Writer &writer, Value const &value,
+                  Indices const &indices) {
+  switch (value.kind()) {
+  case Value::Kind::Integer:
+    writer.integer(std::to_underlying(artifact::Tag::Integer), sizeof(u8));
+    writer.integer((u64)(value.integer()), sizeof(u64));
+    break;
+  case Value::Kind::Real:
+    writer.integer(std::to_underlying(artifact::Tag::Real), sizeof(u8));
+    writer.integer(std::bit_cast<u64>(value.real()), sizeof(u64));
+    break;
+  case Value::Kind::Object:
+    if (value.isString()) {
+      writer.integer(std::to_underlying(artifact::Tag::String), sizeof(u8));
+      writer.text(value.string()->view());
+    } else if (value.isArray()) {
+      writer.integer(std::to_underlying(artifact::Tag::Array), sizeof(u8));
+      writer.array(*value.array());
+    } else {
+      writer.integer(std::to_underlying(artifact::Tag::Function), sizeof(u8));
+      writer.integer(indices.at(value.function()), sizeof(u32));
+    }
+    break;
+  }
+}
+
+inline std::optional<Value> value(artifact::Reader &reader, Heap &heap,
+                                  std::vector<Function *> const &functions) {
+  switch (static_cast<artifact::Tag>(reader.integer(sizeof(u8)))) {
+  case artifact::Tag::Integer:
+    return Value{(i64)(reader.integer(sizeof(u64)))};
+  case artifact::Tag::Real:
+    return Value{std::bit_cast<f64>(reader.integer(sizeof(u64)))};
+  case artifact::Tag::String:
+    return Value{heap.intern(reader.text())};
+  case artifact::Tag::Function: {
+    u64 index = reader.integer(sizeof(u32));
+    if (index >= functions.size()) {
+      return std::nullopt;
+    }
+    return Value{functions[index]};
+  }
+  case artifact::Tag::Array:
+    if (Array *array = reader.array()) {
+      return Value{array};
+    }
+    return std::nullopt;
+  default:
+    return std::nullopt;
+  }
+}
+
+inline std::string body(Function const &function, Indices const &indices) {
+  artifact::Writer writer;
+  writer.integer(function.compiled(), sizeof(u8));
+  if (!function.compiled()) {
+    writer.integer(function.line(), sizeof(u64));
+    writer.text(function.source());
+    return writer.release();
+  }
+
+  auto const &bytecode = function.bytecode();
+  writer.integer(bytecode.size(), sizeof(u64));
+  for (u8 byte : bytecode) {
+    writer.integer(byte, sizeof(u8));
+  }
+  auto const &runs = bytecode.lines().runs();
+  writer.integer(runs.size(), sizeof(u64));
+  for (auto const &run : runs) {
+    writer.integer(run.m_length, sizeof(u64));
+    writer.integer(run.m_line, sizeof(u64));
+  }
+  writer.integer(bytecode.constantCount(), sizeof(u64));
+  for (Value const &constant : bytecode.constants()) {
+    value(writer, constant, indices);
+  }
+  return writer.release();
+}
+
+// reads the body of a function into it, or returns false when it
+// is damaged.
+inline bool body(artifact::Reader &reader, Function &function, Heap &heap,
+                 std::vector<Function *> const &functions) {
+  if (reader.integer(sizeof(u8)) == 0) {
+    size_t line   = reader.integer(sizeof(u64));
+    auto   source = reader.text();
+    if (reader.failed() || !reader.done()) {
+      return false;
+    }
+    function.defer(source, line);
+    return true;
+  }
+
+  auto            code = reader.bytes(reader.integer(sizeof(u64)));
+  Bytecode::Chunk instructions{code.begin(), code.end()};
+
+  Bytecode::Lines lines;
+  u64             runs = reader.integer(sizeof(u64));
+  for (u64 i = 0; i < runs && !reader.failed(); ++i) {
+    size_t length = reader.integer(sizeof(u64));
+    size_t line   = reader.integer(sizeof(u64));
+    lines.append({length, line});
+  }
+
+  Constants constants;
+  u64       count = reader.integer(sizeof(u64));
+  for (u64 i = 0; i < count && !reader.failed(); ++i) {
+    auto constant = value(reader, heap, functions);
+    if (!constant) {
+      return false;
+    }
+    constants.write(*constant);
+  }
+
+  if (reader.failed() || !reader.done()) {
+    return false;
+  }
+  function.bytecode() = Bytecode{std::move(instructions),
+                                 std::move(constants), std::move(lines)};
+  function.markCompiled();
+  return true;
+}
+} // namespace snapshot
+
+// a snapshot mapped into memory, whose functions are restored as
+// they are first called.
+//
+// #NOTE until it is restored, a function of a snapshot is deferred
+// with an empty body, only the virtual machine which restored the
+// snapshot knows where its body is.
+class Snapshot {
+private:
+  struct Unmap {
+    size_t size;
+    void   operator()(void *data) const noexcept { munmap(data, size); }
+  };
+
+  struct Image {
+    std::string_view bytes;
+    u64              checksum;
+  };
+
+  std::unique_ptr<void, Unmap>                m_mapping;
+  std::vector<Function *>                     m_functions;
+  std::unordered_map<Function const *, Image> m_images;
+  // roots every function of the snapshot, which the collector cannot
+  // reach through the bodies of those not yet restored.
+  Bytecode                                    m_roots;
+
+  Snapshot(void *data, size_t size) : m_mapping(data, Unmap{size}) {}
+
+  static std::unexpected<Error> invalid(std::string_view path,
+                                        std::string_view why) {
+    return std::unexpected{Error{
+        Error::Kind::Verify, std::format("snapshot [ {:s} ] {:s}", path, why),
+        0}};
+  }
+
+  static std::unexpected<Error> damaged(Function const &function) {
+    return std::unexpected{
+        Error{Error::Kind::Verify,
+              std::format("the snapshot of function '{:s}' is damaged",
+                          function.name()->view()),
+              function.declared()}};
+  }
+
+public:
+  // writes the globals, and every function they reach.
+  static std::string write(Globals const &globals, Natives const &natives) {
+    snapshot::Indices       indices;
+    std::vector<Function *> functions;
+    auto reach = [&](Value const &value) {
+      if (value.isFunction() && !indices.contains(value.function())) {
+        indices.emplace(value.function(), (u32)(functions.size()));
+        functions.push_back(value.function());
+      }
+    };
+    for (Value const &value : globals.values()) {
+      reach(value);
+    }
+    for (size_t i = 0; i < functions.size(); ++i) {
+      if (functions[i]->compiled()) {
+        for (Value const &constant : functions[i]->bytecode().constants()) {
+          reach(constant);
+        }
+      }
+    }
+
+    artifact::Writer header;
+    header.integer(natives.size(), sizeof(u32));
+    for (Native const &native : natives.natives()) {
+      header.text(native.name->view());
+      header.integer(native.arity, sizeof(u8));
+    }
+
+    std::string bodies;
+    header.integer(functions.size(), sizeof(u32));
+    for (Function const *function : functions) {
+      auto body = snapshot::body(*function, indices);
+      header.text(function->name()->view());
+      header.integer(function->declared(), sizeof(u64));
+      header.integer(function->arity(), sizeof(u8));
+      header.integer(bodies.size(), sizeof(u64));
+      header.integer(body.size(), sizeof(u64));
+      header.integer(hashBytes(body), sizeof(u64));
+      bodies.append(body);
+    }
+
+    header.integer(globals.size(), sizeof(u32));
+    for (size_t slot = 0; slot < globals.size(); ++slot) {
+      header.text(globals.name(slot)->view());
+      snapshot::value(header, globals.values()[slot], indices);
+    }
+    auto checked = header.finish();
+
+    artifact::Writer prefix;
+    prefix.text(snapshot_magic);
+    prefix.integer(snapshot_format, sizeof(u32));
+    prefix.text(artifact_version);
+    prefix.integer(checked.size() - sizeof(u64), sizeof(u64));
+
+    auto out = prefix.release();
+    out.append(checked);
+    out.append(bodies);
+    return out;
+  }
+
+  // maps the snapshot at the path, declaring and assigning its
+  // globals, or describes why it cannot be restored here. nothing is
+  // declared unless the whole header is valid.
+  static std::expected<std::unique_ptr<Snapshot>, Error>
+  map(std::string const &path, Heap &heap, Globals &globals,
+      Natives &natives) {
+    int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) {
+      return invalid(path, "cannot be opened");
+    }
+    struct stat status{};
+    if (::fstat(descriptor, &status) != 0 || status.st_size == 0) {
+      ::close(descriptor);
+      return invalid(path, "is empty");
+    }
+    auto  size = (size_t)(status.st_size);
+    void *data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);
+    if (data == MAP_FAILED) {
+      return invalid(path, "cannot be mapped");
+    }
+    std::unique_ptr<Snapshot> snapshot{new Snapshot{data, size}};
+    std::string_view          bytes{static_cast<char const *>(data), size};
+
+    artifact::Reader prefix{bytes, heap};
+    if (prefix.text() != snapshot_magic ||
+        prefix.integer(sizeof(u32)) != snapshot_format ||
+        prefix.text() != artifact_version) {
+      return invalid(path, "was written by another version of voyage");
+    }
+    auto header   = prefix.bytes(prefix.integer(sizeof(u64)));
+    auto checksum = prefix.integer(sizeof(u64));
+    if (prefix.failed() || checksum != hashBytes(header)) {
+      return invalid(path, "is damaged");
+    }
+    auto bodies = bytes.substr(bytes.size() - prefix.remaining());
+
+    artifact::Reader reader{header, heap};
+    u64              count = reader.integer(sizeof(u32));
+    for (u64 index = 0; index < count && !reader.failed(); ++index) {
+      auto name  = reader.text();
+      auto arity = reader.integer(sizeof(u8));
+      if (index >= natives.size() || natives[index].name->view() != name ||
+          natives[index].arity != arity) {
+        return invalid(path, std::format("refers to native '{:s}', which "
+                                         "is not defined here",
+                                         name));
+      }
+    }
+
+    Constants roots;
+    count = reader.integer(sizeof(u32));
+    for (u64 index = 0; index < count && !reader.failed(); ++index) {
+      Function *function = heap.function(heap.intern(reader.text()));
+      function->setDeclared(reader.integer(sizeof(u64)));
+      function->setArity((u8)(reader.integer(sizeof(u8))));
+      function->defer("", function->declared());
+
+      u64 offset = reader.integer(sizeof(u64));
+      u64 length = reader.integer(sizeof(u64));
+      u64 check  = reader.integer(sizeof(u64));
+      if (offset > bodies.size() || length > bodies.size() - offset) {
+        return invalid(path, "is damaged");
+      }
+      snapshot->m_images.emplace(function,
+                                 Image{bodies.substr(offset, length), check});
+      snapshot->m_functions.push_back(function);
+      roots.write(Value{function});
+    }
+    snapshot->m_roots = Bytecode{{}, std::move(roots), {}};
+
+    // the same check as readArtifact, globals are only ever appended,
+    // so those declared here must be the first of the snapshot.
+    count = reader.integer(sizeof(u32));
+    if (count > Globals::max_slots) {
+      return invalid(path, "declares too many globals");
+    }
+    std::vector<std::pair<std::string_view, Value>> assigned;
+    for (u64 slot = 0; slot < count && !reader.failed(); ++slot) {
+      auto name  = reader.text();
+      auto value = snapshot::value(reader, heap, snapshot->m_functions);
+      if (!value) {
+        return invalid(path, "is damaged");
+      }
+      assigned.emplace_back(name, *value);
+    }
+    if (reader.failed() || !reader.done()) {
+      return invalid(path, "is damaged");
+    }
+    for (size_t slot = 0; slot < globals.size(); ++slot) {
+      if (slot >= assigned.size() ||
+          globals.name(slot)->view() != assigned[slot].first) {
+        return invalid(path, "was written against other globals");
+      }
+    }
+
+    for (size_t slot = 0; slot < assigned.size(); ++slot) {
+      auto const &[name, value] = assigned[slot];
+      if (slot >= globals.size() &&
+          globals.declare(heap.intern(name)) != slot) {
+        return invalid(path, "was written against other globals");
+      }
+      globals[slot] = value;
+    }
+    return snapshot;
+  }
+
+  [[nodiscard]] Bytecode &roots() noexcept { return m_roots; }
+
+  // reads the body of a function of the snapshot on its first call,
+  // returning whether it is now compiled. a function whose body was
+  // deferred when the snapshot was written is deferred again, and is
+  // then compiled as any other.
+  std::expected<bool, Error> restore(Function &function, Heap &heap) {
+    auto found = m_images.find(&function);
+    if (found == m_images.end()) {
+      return false;
+    }
+
+    auto const &image = found->second;
+    if (hashBytes(image.bytes) != image.checksum) {
+      return damaged(function);
+    }
+    artifact::Reader reader{image.bytes, heap};
+    if (!snapshot::body(reader, function, heap, m_functions)) {
+      return damaged(function);
+    }
+    m_images.erase(found);
+    return function.compiled();
+  }
+
+  // restores every function not yet called, as writing another
+  // snapshot must.
+  std::expected<void, Error> restoreAll(Heap &heap) {
+    for (Function *function : m_functions) {
+      if (auto restored = restore(*function, heap); !restored) {
+        return std::unexpected{restored.error()};
+      }
+    }
+    return {};
+  }
+};
+} // namespace voyage
@@ -4,10 +4,12 @@
 
 #include <vector>
 
+#include "memory.hpp"
+
 namespace voyage {
 template <class T> class Stack {
 public:
-  using Data           = std::vector<T>;
+  using Data           = std::vector<T, Counted<T, Subsystem::Stack>>;
   using iterator       = Data::iterator;
   using const_iterator = Data::const_iterator;
 
@@ -20,6 +22,8 @@ public:
     m_data.clear();
     m_top = 0;
   }
+  void reserve(size_t capacity) { m_data.reserve(capacity); }
+
   [[nodiscard]] bool   empty() const noexcept { return m_data.empty(); }
   [[nodiscard]] size_t size() const noexcept { return m_data.size(); }
 
@@ -33,11 +37,21 @@ public:
     m_top--;
     return t;
   }
+  // discards everything above the given size.
+  void truncate(size_t size) noexcept {
+    m_data.erase(m_data.begin() + (std::ptrdiff_t)(size), m_data.end());
+    m_top = size;
+  }
+
   T &peek(size_t offset = 0) noexcept {
     size_t index = m_top - 1U - offset;
     return m_data[index];
   }
 
+  // index from the bottom of the stack.
+  T &operator[](size_t index) noexcept { return m_data[index]; }
+  T const &operator[](size_t index) const noexcept { return m_data[index]; }
+
   [[nodiscard]] iterator       begin() noexcept { return m_data.begin(); }
   [[nodiscard]] iterator       end() noexcept { return m_data.end(); }
   [[nodiscard]] const_iterator begin() const noexcept { return m_data.begin(); }
@@ -11,9 +11,12 @@ struct Token {
     RIGHT_PAREN,
     LEFT_BRACE,
     RIGHT_BRACE,
+    LEFT_BRACKET,
+    RIGHT_BRACKET,
     COMMA,
     DOT,
     SEMICOLON,
+    COLON,
     MINUS,
     PLUS,
     SLASH,
@@ -33,16 +36,21 @@ struct Token {
     NUMBER,
 
     AND,
+    CHANNEL,
     CLASS,
     ELSE,
     FALSE,
     FOR,
     FUN,
     IF,
+    JOIN,
     NIL,
     OR,
     PRINT,
+    RECEIVE,
     RETURN,
+    SEND,
+    SPAWN,
     SUPER,
     THIS,
     TRUE,
@@ -2,16 +2,124 @@
 #include <format>
 #include <ostream>
 
+#include "array.hpp"
+#include "common.hpp"
+#include "object.hpp"
+
 namespace voyage {
-struct Value {
-  double data;
+class Channel;
+class Fiber;
+class Function;
+
+class Value {
+public:
+  enum class Kind : u8 {
+    Integer,
+    Real,
+    Object,
+  };
+
+private:
+  Kind m_kind;
+  union {
+    i64             m_integer;
+    f64             m_real;
+    voyage::Object *m_object;
+  };
+
+public:
+  constexpr explicit Value(i64 integer) noexcept
+      : m_kind(Kind::Integer), m_integer(integer) {}
+  constexpr explicit Value(f64 real) noexcept
+      : m_kind(Kind::Real), m_real(real) {}
+  constexpr explicit Value(voyage::Object *object) noexcept
+      : m_kind(Kind::Object), m_object(object) {}
+
+  [[nodiscard]] constexpr Kind kind() const noexcept { return m_kind; }
+  [[nodiscard]] constexpr bool isInteger() const noexcept {
+    return m_kind == Kind::Integer;
+  }
+  [[nodiscard]] constexpr bool isReal() const noexcept {
+    return m_kind == Kind::Real;
+  }
+  [[nodiscard]] constexpr bool isNumber() const noexcept {
+    return isInteger() || isReal();
+  }
+  [[nodiscard]] constexpr bool isObject() const noexcept {
+    return m_kind == Kind::Object;
+  }
+  [[nodiscard]] bool isString() const noexcept {
+    return isObject() && m_object->kind() == voyage::Object::Kind::String;
+  }
+  [[nodiscard]] bool isFunction() const noexcept {
+    return isObject() && m_object->kind() == voyage::Object::Kind::Function;
+  }
+  [[nodiscard]] bool isArray() const noexcept {
+    return isObject() && m_object->kind() == voyage::Object::Kind::Array;
+  }
+  [[nodiscard]] bool isFiber() const noexcept {
+    return isObject() && m_object->kind() == voyage::Object::Kind::Fiber;
+  }
+  [[nodiscard]] bool isChannel() const noexcept {
+    return isObject() && m_object->kind() == voyage::Object::Kind::Channel;
+  }
+
+  [[nodiscard]] constexpr i64 integer() const noexcept { return m_integer; }
+  [[nodiscard]] constexpr f64 real() const noexcept { return m_real; }
+  [[nodiscard]] constexpr voyage::Object *object() const noexcept {
+    return m_object;
+  }
+  [[nodiscard]] String *string() const noexcept {
+    return static_cast<String *>(m_object);
+  }
+  [[nodiscard]] Array *array() const noexcept {
+    return static_cast<Array *>(m_object);
+  }
+  // #NOTE Function is only complete where function.hpp is included.
+  template <class F = Function> [[nodiscard]] F *function() const noexcept {
+    return static_cast<F *>(m_object);
+  }
+  // #NOTE as are Fiber and Channel where fiber.hpp is.
+  template <class F = Fiber> [[nodiscard]] F *fiber() const noexcept {
+    return static_cast<F *>(m_object);
+  }
+  template <class C = Channel> [[nodiscard]] C *channel() const noexcept {
+    return static_cast<C *>(m_object);
+  }
+
+  // the value as a double, converting an integer if need be.
+  [[nodiscard]] constexpr f64 toReal() const noexcept {
+    return isInteger() ? static_cast<f64>(m_integer) : m_real;
+  }
+
+  // #NOTE strings are interned, so comparing objects
+  // by address is enough to compare strings by value.
+  friend constexpr bool operator==(Value const &a, Value const &b) noexcept {
+    if (a.isNumber() && b.isNumber()) {
+      if (a.isInteger() && b.isInteger()) {
+        return a.m_integer == b.m_integer;
+      }
+      return a.toReal() == b.toReal();
+    }
+    return a.isObject() && b.isObject() && a.m_object == b.m_object;
+  }
 };
 
-void print(std::ostream &out, Value const &value) {
-  out << std::format("{:.5g}", value.data);
+inline void print(std::ostream &out, Value const &value) {
+  switch (value.kind()) {
+  case Value::Kind::Integer:
+    out << std::format("{:d}", value.integer());
+    break;
+  case Value::Kind::Real:
+    out << std::format("{:.5g}", value.real());
+    break;
+  case Value::Kind::Object:
+    print(out, *value.object());
+    break;
+  }
 }
 
-std::ostream &operator<<(std::ostream &out, Value const &value) {
+inline std::ostream &operator<<(std::ostream &out, Value const &value) {
   print(out, value);
   return out;
 }
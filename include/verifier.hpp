@@ -0,0 +1,281 @@
+#pragma once
+#include <expected>
+#include <format>
+
+#include "bytecode.hpp"
+#include "error.hpp"
+#include "function.hpp"
+#include "natives.hpp"
+
+namespace voyage {
+// walks a chunk once before it is executed, checking every
+// property the virtual machine would otherwise have to check
+// on each instruction: that each opcode is valid, that each
+// immediate lies within the chunk, that each constant index
+// lies within the constants, that the stack never underflows,
+// that each RETURN of a function finds its value above the
+// callee and its arguments, and that the chunk ends with a
+// RETURN. top level code which ends in a statement returns
+// with an empty stack, and the virtual machine returns 0 for
+// it. a chunk which passes is marked verified, and the virtual
+// machine executes it without any of those checks.
+class Verifier {
+private:
+  Bytecode      &m_bytecode;
+  size_t         m_globals;
+  Natives const &m_natives;
+  // the slots the frame begins with, the callee and its arguments.
+  size_t         m_reserved;
+  size_t         m_depth;
+  size_t         m_max_depth;
+
+  auto error(size_t offset, std::string_view msg)
+      -> std::expected<void, Error> {
+    return std::unexpected{
+        Error{Error::Kind::Verify, msg, m_bytecode.getLine(offset)}
+    };
+  }
+
+  bool pop(size_t count) noexcept {
+    if (m_depth < count) {
+      return false;
+    }
+    m_depth -= count;
+    return true;
+  }
+
+  void push() noexcept {
+    m_depth++;
+    if (m_depth > m_max_depth) {
+      m_max_depth = m_depth;
+    }
+  }
+
+public:
+  Verifier(Bytecode &bytecode, size_t globals, Natives const &natives,
+           size_t reserved = 0) noexcept
+      : m_bytecode(bytecode), m_globals(globals), m_natives(natives),
+        m_reserved(reserved), m_depth(reserved), m_max_depth(reserved) {}
+
+  std::expected<void, Error> verify() {
+    if (m_bytecode.empty()) {
+      return error(0, "empty chunk");
+    }
+
+    Instruction last = Instruction::RETURN;
+    for (size_t offset = 0; offset < m_bytecode.size();) {
+      u8 byte = m_bytecode[offset];
+      if (!isInstruction(byte)) {
+        return error(offset, std::format("invalid opcode [{:d}]", byte));
+      }
+
+      auto   instruction = static_cast<Instruction>(byte);
+      size_t bytes       = immediateBytes(instruction);
+      if (offset + 1 + bytes > m_bytecode.size()) {
+        return error(offset, "immediate extends past the end of the chunk");
+      }
+
+      switch (instruction) {
+      case Instruction::RETURN: {
+        // #NOTE only top level code may return without a value,
+        // the virtual machine returns 0 for an empty stack.
+        if (m_reserved == 0) {
+          break;
+        }
+        if (m_depth <= m_reserved) {
+          return error(offset, "no value to RETURN");
+        }
+        // #NOTE the code which follows a RETURN is unreachable, but
+        // is still checked, at the depth the RETURN left it: the
+        // POPs which close the enclosing blocks, and the implicit
+        // return which ends each function body.
+        pop(1);
+        break;
+      }
+
+      case Instruction::TAIL_CALL:
+        // #NOTE the top level has no frame of its own to reuse.
+        if (m_reserved == 0) {
+          return error(offset, "TAIL_CALL outside of a function");
+        }
+        [[fallthrough]];
+      case Instruction::CALL:
+      case Instruction::SPAWN: {
+        size_t arguments = m_bytecode.readImmediate(offset + 1, bytes);
+        if (!pop(arguments + 1)) {
+          return error(offset, "stack underflow");
+        }
+        push();
+        break;
+      }
+
+      case Instruction::CALL_NATIVE: {
+        size_t index = m_bytecode.readImmediate(offset + 1, bytes);
+        if (index >= m_natives.size()) {
+          return error(offset, std::format("native [{:d}] out of bounds",
+                                           index));
+        }
+        if (!pop(m_natives[index].arity)) {
+          return error(offset, "stack underflow");
+        }
+        push();
+        break;
+      }
+
+      case Instruction::CONSTANT_U8:
+      case Instruction::CONSTANT_U16:
+      case Instruction::CONSTANT_U32:
+      case Instruction::CONSTANT_U64: {
+        size_t index = m_bytecode.readImmediate(offset + 1, bytes);
+        if (index >= m_bytecode.constantCount()) {
+          return error(offset, std::format("constant [{:d}] out of bounds",
+                                           index));
+        }
+
+        Value constant = m_bytecode.constantAt(index);
+        if (constant.isFunction()) {
+          // #NOTE a deferred function is verified once it is compiled.
+          auto *function = constant.function();
+          if (function->compiled() && !function->bytecode().verified()) {
+            Verifier verifier{function->bytecode(), m_globals, m_natives,
+                              (size_t)(function->arity()) + 1};
+            if (auto result = verifier.verify(); !result) {
+              return result;
+            }
+          }
+        }
+        push();
+        break;
+      }
+
+      case Instruction::POP: {
+        if (!pop(1)) {
+          return error(offset, "stack underflow");
+        }
+        break;
+      }
+
+      case Instruction::GET_LOCAL:
+      case Instruction::SET_LOCAL: {
+        size_t slot = m_bytecode.readImmediate(offset + 1, bytes);
+        if (slot >= m_depth) {
+          return error(offset, std::format("local slot [{:d}] out of bounds",
+                                           slot));
+        }
+        if (instruction == Instruction::GET_LOCAL) {
+          push();
+        }
+        break;
+      }
+
+      case Instruction::GET_GLOBAL:
+      case Instruction::SET_GLOBAL:
+      case Instruction::DEFINE_GLOBAL: {
+        size_t slot = m_bytecode.readImmediate(offset + 1, bytes);
+        if (slot >= m_globals) {
+          return error(offset, std::format("global slot [{:d}] out of bounds",
+                                           slot));
+        }
+        if (instruction == Instruction::GET_GLOBAL) {
+          push();
+        } else if (!pop(1)) {
+          return error(offset, "stack underflow");
+        } else if (instruction == Instruction::SET_GLOBAL) {
+          push();
+        }
+        break;
+      }
+
+      case Instruction::NEGATE:
+      case Instruction::JOIN:
+      case Instruction::CHANNEL:
+      case Instruction::RECEIVE: {
+        if (!pop(1)) {
+          return error(offset, "stack underflow");
+        }
+        push();
+        break;
+      }
+
+      case Instruction::ADD:
+      case Instruction::SUB:
+      case Instruction::MUL:
+      case Instruction::DIV:
+      case Instruction::ADD_INT:
+      case Instruction::SUB_INT:
+      case Instruction::MUL_INT:
+      case Instruction::ADD_REAL:
+      case Instruction::SUB_REAL:
+      case Instruction::MUL_REAL:
+      case Instruction::DIV_REAL: {
+        if (!pop(2)) {
+          return error(offset, "stack underflow");
+        }
+        push();
+        break;
+      }
+
+      case Instruction::ARRAY: {
+        size_t count = m_bytecode.readImmediate(offset + 1, bytes);
+        if (!pop(count)) {
+          return error(offset, "stack underflow");
+        }
+        push();
+        break;
+      }
+
+      case Instruction::INDEX:
+      case Instruction::SEND: {
+        if (!pop(2)) {
+          return error(offset, "stack underflow");
+        }
+        push();
+        break;
+      }
+
+      case Instruction::SLICE: {
+        size_t bounds = m_bytecode.readImmediate(offset + 1, bytes);
+        if ((bounds & ~(size_t)(slice_start | slice_end)) != 0) {
+          return error(offset, std::format("invalid slice bounds [{:d}]",
+                                           bounds));
+        }
+        size_t operands = 1 + ((bounds & slice_start) != 0) +
+                          ((bounds & slice_end) != 0);
+        if (!pop(operands)) {
+          return error(offset, "stack underflow");
+        }
+        push();
+        break;
+      }
+
+      default:
+        std::unreachable();
+      }
+
+      last    = instruction;
+      offset += 1 + bytes;
+    }
+
+    if (last != Instruction::RETURN) {
+      return error(m_bytecode.size() - 1, "chunk does not end in RETURN");
+    }
+
+    m_bytecode.markVerified(m_max_depth);
+    return {};
+  }
+};
+
+// globals is the number of global slots the chunk may refer to.
+inline std::expected<void, Error> verify(Bytecode &bytecode, size_t globals,
+                                         Natives const &natives) {
+  Verifier verifier{bytecode, globals, natives};
+  return verifier.verify();
+}
+
+inline std::expected<void, Error> verify(Function &function, size_t globals,
+                                         Natives const &natives) {
+  Verifier verifier{function.bytecode(), globals, natives,
+                    (size_t)(function.arity()) + 1};
+  return verifier.verify();
+}
+} // namespace voyage
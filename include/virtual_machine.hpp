@@ -3,116 +3,1438 @@
 #include <iostream>
 #endif
 
+#include <algorithm>
+#include <chrono>
 #include <expected>
+#include <functional>
+#include <optional>
+#include <vector>
 
+#include "arithmetic.hpp"
 #include "bytecode.hpp"
 #include "common.hpp"
 #include "error.hpp"
+#include "fiber.hpp"
+#include "globals.hpp"
+#include "heap.hpp"
+#include "ir.hpp"
+#include "natives.hpp"
+#include "parser.hpp"
+#include "snapshot.hpp"
 #include "stack.hpp"
+#include "verifier.hpp"
 
 namespace voyage {
 class VirtualMachine {
 public:
+  static constexpr size_t max_frames = 1024;
+
+  // how long a task may run before it is suspended, whichever of
+  // the instruction count or the time runs out first.
+  struct Budget {
+    size_t                              instructions = SIZE_MAX;
+    std::chrono::steady_clock::duration time =
+        std::chrono::steady_clock::duration::max();
+  };
+
+  // the result of running a task for one slice, nothing when the
+  // task ran out of budget, and may be resumed.
+  using Slice = std::expected<std::optional<Value>, Error>;
+
+  // the state of a script which runs in slices, its strand and its
+  // fibers. they are swapped into the virtual machine while the
+  // task runs, and out again when it is suspended, so that many
+  // tasks may be multiplexed onto one virtual machine.
+  class Task {
+  private:
+    friend class VirtualMachine;
+
+    VirtualMachine *m_vm;
+    Strand          m_strand;
+    Scheduler       m_scheduler;
+    bool            m_checked  = false;
+    size_t          m_executed = 0;
+
+  public:
+    explicit Task(VirtualMachine &vm) : m_vm(&vm) {
+      vm.m_tasks.push_back(this);
+    }
+    Task(Task const &)            = delete;
+    Task &operator=(Task const &) = delete;
+    ~Task() {
+      m_scheduler.abandon();
+      std::erase(m_vm->m_tasks, this);
+    }
+
+    // true when the task has returned, or was never started.
+    [[nodiscard]] bool done() const noexcept {
+      return m_strand.frame_count == 0;
+    }
+
+    // the instructions executed since the task was started.
+    [[nodiscard]] size_t executed() const noexcept { return m_executed; }
+  };
+
 private:
+  Heap         m_heap;
+  Globals      m_globals;
+  Natives      m_natives;
   Stack<Value> m_stack;
+  // #NOTE the frames of the virtual machine are allocated up front,
+  // the frames of a task grow as it calls deeper.
+  Frames       m_frames;
+  size_t       m_frame_count = 0;
+  // chunks which outlive a single call to interpret, such as
+  // compiled programs, whose constants must stay alive between
+  // runs.
+  std::vector<Bytecode *>  m_retained;
+  // globals of their own, which programs swap in while they run.
+  std::vector<Globals *>   m_retained_globals;
+  // every task, whose state is a root while it is suspended.
+  std::vector<Task *>      m_tasks;
+  // the fibers of the current run.
+  Scheduler                m_scheduler;
+  // optimizes the functions compiled on their first call, when set.
+  std::optional<Optimizer> m_optimizer;
+  // the snapshot the state was restored from, whose functions are
+  // read from it on their first call.
+  std::unique_ptr<Snapshot> m_snapshot;
 
-  void reset() noexcept { m_stack.reset(); }
+  void reset() noexcept {
+    settle();
+    m_stack.reset();
+    m_frame_count = 0;
+  }
 
-  auto result(Value value) -> std::expected<Value, Error> { return {value}; }
-  auto result(Error error) -> std::expected<Value, Error> {
+  // exchanges the running strand with the given one.
+  void swap(Strand &strand) noexcept {
+    std::swap(m_stack, strand.stack);
+    std::swap(m_frames, strand.frames);
+    std::swap(m_frame_count, strand.frame_count);
+  }
+
+  // exchanges the state of the virtual machine with that of a task.
+  void swap(Task &task) noexcept {
+    swap(task.m_strand);
+    std::swap(m_scheduler, task.m_scheduler);
+  }
+
+  // ends the fibers of a run, which either returned from its top
+  // level code or failed. the strand of top level code, which holds
+  // the frames allocated up front, is swapped back in first.
+  void settle() noexcept {
+    if (!m_scheduler.active()) {
+      return;
+    }
+    if (m_scheduler.running() != m_scheduler.main()) {
+      swap(m_scheduler.running()->strand());
+      swap(m_scheduler.main()->strand());
+    }
+    m_scheduler.abandon();
+  }
+
+  // switches from the running fiber to the next which is ready. the
+  // strand of a fiber changes only while it runs, so the fiber is
+  // traced again if it was traced before.
+  void yield() {
+    Fiber *running = m_scheduler.running();
+    swap(running->strand());
+    m_heap.collector().barrier(running);
+    swap(m_scheduler.next()->strand());
+  }
+
+  // moves a call, the callee and its arguments on the top of the
+  // stack, onto the strand of a new fiber, which replaces them. the
+  // call must be valid. the code which spawns the first fiber of a
+  // run becomes its main fiber.
+  template <bool checked> void spawn(size_t arguments) {
+    if (!m_scheduler.active()) {
+      m_scheduler.begin(m_heap.fiber());
+    }
+
+    size_t    base     = m_stack.size() - arguments - 1;
+    auto     *function = m_stack[base].function();
+    Bytecode &bytecode = function->bytecode();
+    Fiber    *fiber    = m_heap.fiber();
+    Strand   &strand   = fiber->strand();
+    strand.stack.reserve(std::max(arguments + 1, bytecode.maxDepth()));
+    for (size_t i = base; i < m_stack.size(); ++i) {
+      strand.stack.push(m_stack[i]);
+    }
+    strand.frames.push_back(
+        Frame{function, &bytecode, entry<checked>(bytecode), 0});
+    strand.frame_count = 1;
+
+    m_scheduler.spawn(fiber);
+    m_stack.truncate(base);
+    m_stack.push(Value{fiber});
+  }
+
+  auto result(Value value) -> Slice { return {value}; }
+  auto result(std::nullopt_t) -> Slice { return {std::nullopt}; }
+  auto result(Error error) -> Slice {
     return std::unexpected{std::move(error)};
   }
 
-public:
-  std::expected<Value, Error> interpret(Bytecode &bytecode) noexcept {
-    Bytecode::iterator ip = bytecode.begin();
-    auto read_byte        = [&]() { return *ip++; };
-    auto read_constant    = [&](size_t bytes) -> Value {
-      auto index  = bytecode.readImmediate(ip, bytes);
-      ip         += (std::ptrdiff_t)(bytes);
-      return bytecode.constantAt(index);
+  // pushes the frame of top level code.
+  void enter(Bytecode &bytecode) {
+    if (m_frame_count == m_frames.size()) {
+      m_frames.emplace_back();
+    }
+    m_frames[m_frame_count++] =
+        Frame{nullptr, &bytecode,
+              bytecode.verified() ? entry<false>(bytecode)
+                                  : entry<true>(bytecode),
+              m_stack.size()};
+    if (bytecode.verified()) {
+      m_stack.reserve(m_stack.size() + bytecode.maxDepth());
+    }
+  }
+
+  // a safepoint, reached after each instruction which allocates.
+  // the roots are the stack and frames of the running state, of
+  // each fiber which has yet to return and of each task, the
+  // globals, and each retained set of globals, the names of natives,
+  // and the constants of each retained chunk. a frame roots its
+  // function, or the constants of top level code.
+  void collect() {
+    if (!m_heap.collector().pending()) {
+      return;
+    }
+
+    m_heap.step([&](Collector &collector) {
+      // the strand of a fiber is traced through the fiber, so that
+      // many fibers do not lengthen the pause which scans the roots.
+      auto mark_fibers = [&](Scheduler const &scheduler) {
+        if (!scheduler.active()) {
+          return;
+        }
+        collector.mark(scheduler.main());
+        for (Fiber *fiber : scheduler.live()) {
+          collector.mark(fiber);
+        }
+      };
+
+      collector.mark(m_stack, m_frames, m_frame_count);
+      mark_fibers(m_scheduler);
+      for (Task *task : m_tasks) {
+        collector.mark(task->m_strand);
+        mark_fibers(task->m_scheduler);
+      }
+      for (String *name : m_globals.names()) {
+        collector.mark(name);
+      }
+      for (Value const &value : m_globals.values()) {
+        collector.mark(value);
+      }
+      for (Globals const *globals : m_retained_globals) {
+        for (String *name : globals->names()) {
+          collector.mark(name);
+        }
+        for (Value const &value : globals->values()) {
+          collector.mark(value);
+        }
+      }
+      for (Native const &native : m_natives.natives()) {
+        collector.mark(native.name);
+      }
+      for (Bytecode *bytecode : m_retained) {
+        for (Value const &value : bytecode->constants()) {
+          collector.mark(value);
+        }
+      }
+    });
+  }
+
+#if defined(VOYAGE_SPLIT_CHUNK)
+  static constexpr bool split_layout = true;
+#else
+  static constexpr bool split_layout = false;
+#endif
+
+  // the first instruction of a chunk, in the layout executed by the
+  // checked or unchecked dispatch loop. only the unchecked loop runs
+  // the split layout, as only a verified chunk is laid out.
+  template <bool checked>
+  static Bytecode::iterator entry(Bytecode &bytecode) noexcept {
+    if constexpr (split_layout && !checked) {
+      return bytecode.opcodes();
+    } else {
+      return bytecode.begin();
+    }
+  }
+
+#if defined(VOYAGE_TOS_CACHE)
+  // the number of values held by the top of stack cache, as a
+  // type, so that each handler variant is specialized for it.
+  template <size_t n> using Count = std::integral_constant<size_t, n>;
+  template <size_t n> static constexpr Count<n> state{};
+
+  // the dispatch key of the handler variant of an instruction.
+  static constexpr size_t variant(Instruction instruction,
+                                  size_t      cached) noexcept {
+    return ((size_t)(instruction) << 2) | cached;
+  }
+#endif
+
+  // compiles a deferred function on its first call. the function
+  // may already have been traced by the collector, so it is traced
+  // again to reach the constants of its new chunk.
+  std::optional<Error> compile(Function &function, size_t line) {
+    if (m_snapshot) {
+      auto restored = m_snapshot->restore(function, m_heap);
+      if (!restored) {
+        return restored.error();
+      }
+      if (*restored) {
+        m_heap.collector().barrier(&function);
+        return std::nullopt;
+      }
+    }
+
+    // #NOTE the error is returned, and reported by the caller.
+    Parser parser{m_heap, m_globals, m_natives};
+    parser.optimizeWith(optimizer());
+    parser.quieten(true);
+    if (!parser.compile(function)) {
+      if (auto const &failure = parser.firstError()) {
+        return *failure;
+      }
+      return Error{Error::Kind::Comptime,
+                   std::format("failed to compile function '{:s}'",
+                               function.name()->view()),
+                   line};
+    }
+
+    m_heap.collector().barrier(&function);
+    return std::nullopt;
+  }
+
+  // rewrites a generic arithmetic instruction to the variant
+  // specialized for the operand kinds observed at the site. a
+  // site which has seen both kinds stays generic.
+  static void quicken(Bytecode &bytecode, size_t offset, Value const &a,
+                      Value const &b, Instruction integer, Instruction real) {
+    auto &site = bytecode.feedback().record(offset, a, b);
+    if (site.only(Value::Kind::Integer)) {
+      bytecode.patch(offset, integer);
+    } else if (site.only(Value::Kind::Real)) {
+      bytecode.patch(offset, real);
+    }
+  }
+
+  // a specialized instruction observed operands it does not
+  // handle, so the site goes back to the generic instruction,
+  // which consults the now wider feedback before specializing.
+  static void deoptimize(Bytecode &bytecode, size_t offset, Value const &a,
+                         Value const &b, Instruction generic) {
+    auto &site = bytecode.feedback().record(offset, a, b);
+    site.deopts++;
+    bytecode.patch(offset, generic);
+  }
+
+  // #NOTE when checked is false the bytecode has been verified,
+  // so none of the checks which guard against malformed bytecode
+  // are compiled into the dispatch loop.
+  //
+  // execution continues from the topmost frame. when budgeted is
+  // true, execution is suspended, between instructions, once the
+  // budget is exhausted, and the instructions executed are added
+  // to spent, however the slice ends.
+  template <bool checked, bool budgeted = false>
+  Slice execute([[maybe_unused]] Budget budget = {},
+                [[maybe_unused]] size_t *spent = nullptr) noexcept {
+    Frame *frame = &m_frames[m_frame_count - 1];
+
+    Bytecode          *chunk = frame->bytecode;
+    Bytecode::iterator ip    = frame->ip;
+    auto read_byte           = [&]() { return *ip++; };
+    // #NOTE in the split layout ip only walks the opcodes, and the
+    // immediate of the instruction just read lies beside it, rather
+    // than after it.
+    constexpr bool split = split_layout && !checked;
+    auto read_immediate  = [&](size_t bytes) -> size_t {
+      if constexpr (split) {
+        return chunk->operand(ip - 1);
+      } else {
+        auto immediate  = chunk->readImmediate(ip, bytes);
+        ip             += (std::ptrdiff_t)(bytes);
+        return immediate;
+      }
+    };
+    auto read_constant = [&](size_t bytes) -> Value {
+      return chunk->constantAt(read_immediate(bytes));
+    };
+    // the offset within the chunk of the instruction at i.
+    auto offset_of = [&](Bytecode::iterator i) -> size_t {
+      if constexpr (split) {
+        return chunk->offsetOf(i);
+      } else {
+        return (size_t)(std::distance(chunk->begin(), i));
+      }
+    };
+    // true when an immediate of the given size lies within the
+    // chunk, and is less than the given bound.
+    auto valid_immediate = [&](size_t bytes, size_t bound) -> bool {
+      if ((size_t)(std::distance(ip, chunk->end())) < bytes) {
+        return false;
+      }
+      return chunk->readImmediate(ip, bytes) < bound;
+    };
+    auto valid_constant = [&](size_t bytes) -> bool {
+      return valid_immediate(bytes, chunk->constantCount());
+    };
+    // the offset of the instruction currently being executed.
+    auto offset = [&]() -> size_t { return offset_of(ip - 1); };
+    auto error = [&](std::string_view msg) {
+      return result(Error{Error::Kind::Runtime, msg, chunk->getLine(offset())});
+    };
+
+    // describes why callee can not be called with the given number
+    // of arguments, if it can not, compiling it if need be.
+    auto callable = [&](Value callee,
+                        size_t arguments) -> std::optional<Error> {
+      if (!callee.isFunction()) {
+        return Error{Error::Kind::Runtime, "can only call functions",
+                     chunk->getLine(offset())};
+      }
+
+      auto *function = callee.function();
+      if (!function->compiled()) {
+        if (auto failure = compile(*function, chunk->getLine(offset()))) {
+          return failure;
+        }
+      }
+
+      if (function->arity() != arguments) {
+        return Error{Error::Kind::Runtime,
+                     std::format("expected {:d} arguments but got {:d}",
+                                 function->arity(), arguments),
+                     chunk->getLine(offset())};
+      }
+
+      // #NOTE a function reached through a global may have been
+      // compiled by a chunk which was never verified.
+      if constexpr (!checked) {
+        if (!function->bytecode().verified()) {
+          if (auto verified =
+                  verify(*function, m_globals.size(), m_natives);
+              !verified) {
+            return verified.error();
+          }
+        }
+      }
+      return std::nullopt;
+    };
+
+    // pushes a frame for a call to callee, whose arguments are on
+    // the top of the stack, or describes why the call is invalid.
+    // a tail call replaces the frame of the caller, rather than
+    // returning to it.
+    auto call = [&](Value callee, size_t arguments,
+                    bool tail = false) -> std::optional<Error> {
+      if (auto failure = callable(callee, arguments)) {
+        return failure;
+      }
+
+      auto *function = callee.function();
+      if (!tail && m_frame_count == max_frames) {
+        return Error{Error::Kind::Runtime, "stack overflow",
+                     chunk->getLine(offset())};
+      }
+
+      if (tail) {
+        m_frame_count--;
+      } else {
+        frame->ip = ip;
+      }
+      if (m_frame_count == m_frames.size()) {
+        m_frames.emplace_back();
+      }
+      frame     = &m_frames[m_frame_count++];
+      *frame    = Frame{function, &function->bytecode(),
+                     entry<checked>(function->bytecode()),
+                     m_stack.size() - arguments - 1};
+      chunk     = frame->bytecode;
+      ip        = frame->ip;
+      return std::nullopt;
+    };
+
+    // continues the running fiber from its topmost frame.
+    auto resume = [&]() {
+      frame = &m_frames[m_frame_count - 1];
+      chunk = frame->bytecode;
+      ip    = frame->ip;
+    };
+    auto deadlock = [&]() {
+      return Error{Error::Kind::Runtime, "deadlock, every fiber is blocked",
+                   chunk->getLine(offset())};
+    };
+    // the running fiber blocks in the queue of the given object, to
+    // execute the current instruction again once it is woken, and
+    // the next fiber which is ready runs meanwhile.
+    auto block = [&](FiberQueue &queue,
+                     Object     *object) -> std::optional<Error> {
+      if (!m_scheduler.ready()) {
+        return deadlock();
+      }
+      m_scheduler.block(queue);
+      m_heap.collector().barrier(object);
+      frame->ip = ip - 1;
+      yield();
+      resume();
+      return std::nullopt;
+    };
+
+#if defined(VOYAGE_TOS_CACHE)
+    // #NOTE the top of stack cache holds up to two of the topmost
+    // values of the stack in locals of the dispatch loop, r0 being
+    // the topmost, and cached the number of values held. constants,
+    // locals, pops and specialized arithmetic have a handler variant
+    // for each number of cached values, selected by a single dispatch
+    // on both. any other instruction spills the cache to m_stack
+    // first, so the remaining handlers are unaware of it. the
+    // handlers are forced inline, otherwise the cached values are
+    // captured by reference and kept in memory after all.
+    Value  r0{i64{0}};
+    Value  r1{i64{0}};
+    size_t cached = 0;
+    auto   spill  = [&] [[gnu::always_inline]] () {
+      if (cached == 2) {
+        m_stack.push(r1);
+      }
+      if (cached >= 1) {
+        m_stack.push(r0);
+      }
+      cached = 0;
+    };
+    auto cache = [&]<size_t n> [[gnu::always_inline]] (Count<n>, Value value) {
+      if constexpr (n == 2) {
+        m_stack.push(r1);
+      }
+      cached = std::min(n + 1, size_t{2});
+      r1     = r0;
+      r0     = value;
+    };
+    auto lhs = [&]<size_t n> [[gnu::always_inline]] (Count<n>) -> Value & {
+      if constexpr (n == 2) {
+        return r1;
+      } else if constexpr (n == 1) {
+        return m_stack.peek(0);
+      } else {
+        return m_stack.peek(1);
+      }
+    };
+    auto rhs = [&]<size_t n> [[gnu::always_inline]] (Count<n>) -> Value & {
+      if constexpr (n >= 1) {
+        return r0;
+      } else {
+        return m_stack.peek(0);
+      }
+    };
+    // consumes both operands of a binary instruction, leaving the
+    // result as the only cached value.
+    auto replace = [&]<size_t n> [[gnu::always_inline]] (Count<n>,
+                                                         Value value) {
+      for (size_t i = n; i < 2; ++i) {
+        m_stack.pop();
+      }
+      r0     = value;
+      cached = 1;
+    };
+    auto constant_step = [&]<size_t n> [[gnu::always_inline]] (Count<n> count,
+                                                               size_t bytes) {
+      ip++;
+      cache(count, read_constant(bytes));
+      return true;
+    };
+    auto local_step = [&]<size_t n> [[gnu::always_inline]] (Count<n> count) {
+      size_t index = frame->base + (split ? chunk->operand(ip)
+                                          : chunk->readImmediate(ip + 1,
+                                                                 sizeof(u8)));
+      // the slot itself may still be cached.
+      if constexpr (n > 0) {
+        if (index >= m_stack.size()) {
+          return false;
+        }
+      }
+      ip += split ? 1 : 1 + sizeof(u8);
+      cache(count, m_stack[index]);
+      return true;
+    };
+    auto pop_step = [&]<size_t n> [[gnu::always_inline]] (Count<n>) {
+      ip++;
+      cached = n - 1;
+      if constexpr (n == 2) {
+        r0 = r1;
+      }
+      return true;
+    };
+    auto negate_step = [&]<size_t n> [[gnu::always_inline]] (Count<n>) {
+      if (!r0.isNumber()) {
+        return false;
+      }
+      ip++;
+      r0 = negate(r0);
+      return true;
+    };
+    auto integer_step = [&]<size_t n> [[gnu::always_inline]] (
+                            Count<n> count, auto overflows, auto promote) {
+      Value &a = lhs(count);
+      Value &b = rhs(count);
+      if (!a.isInteger() || !b.isInteger()) [[unlikely]] {
+        return false;
+      }
+      i64 result = 0;
+      ip++;
+      replace(count, overflows(a.integer(), b.integer(), &result)
+                         ? promote(a, b)
+                         : Value{result});
+      return true;
+    };
+    auto real_step = [&]<size_t n> [[gnu::always_inline]] (Count<n> count,
+                                                           auto     op) {
+      Value &a = lhs(count);
+      Value &b = rhs(count);
+      if (!a.isReal() || !b.isReal()) [[unlikely]] {
+        return false;
+      }
+      ip++;
+      replace(count, Value{op(a.real(), b.real())});
+      return true;
+    };
+    auto add_overflows = [](i64 a, i64 b, i64 *r) {
+      return __builtin_add_overflow(a, b, r);
+    };
+    auto sub_overflows = [](i64 a, i64 b, i64 *r) {
+      return __builtin_sub_overflow(a, b, r);
+    };
+    auto mul_overflows = [](i64 a, i64 b, i64 *r) {
+      return __builtin_mul_overflow(a, b, r);
     };
+    // executes the next instruction against the cache, or returns
+    // false, without consuming it, when it must see the whole stack.
+    auto cached_step = [&] [[gnu::always_inline]] () -> bool {
+      switch (variant((Instruction)(*ip), cached)) {
+      case variant(Instruction::CONSTANT_U8, 0):
+        return constant_step(state<0>, sizeof(u8));
+      case variant(Instruction::CONSTANT_U8, 1):
+        return constant_step(state<1>, sizeof(u8));
+      case variant(Instruction::CONSTANT_U8, 2):
+        return constant_step(state<2>, sizeof(u8));
+      case variant(Instruction::CONSTANT_U16, 0):
+        return constant_step(state<0>, sizeof(u16));
+      case variant(Instruction::CONSTANT_U16, 1):
+        return constant_step(state<1>, sizeof(u16));
+      case variant(Instruction::CONSTANT_U16, 2):
+        return constant_step(state<2>, sizeof(u16));
+      case variant(Instruction::CONSTANT_U32, 0):
+        return constant_step(state<0>, sizeof(u32));
+      case variant(Instruction::CONSTANT_U32, 1):
+        return constant_step(state<1>, sizeof(u32));
+      case variant(Instruction::CONSTANT_U32, 2):
+        return constant_step(state<2>, sizeof(u32));
+      case variant(Instruction::CONSTANT_U64, 0):
+        return constant_step(state<0>, sizeof(u64));
+      case variant(Instruction::CONSTANT_U64, 1):
+        return constant_step(state<1>, sizeof(u64));
+      case variant(Instruction::CONSTANT_U64, 2):
+        return constant_step(state<2>, sizeof(u64));
+      case variant(Instruction::GET_LOCAL, 0):
+        return local_step(state<0>);
+      case variant(Instruction::GET_LOCAL, 1):
+        return local_step(state<1>);
+      case variant(Instruction::GET_LOCAL, 2):
+        return local_step(state<2>);
+      case variant(Instruction::POP, 1):
+        return pop_step(state<1>);
+      case variant(Instruction::POP, 2):
+        return pop_step(state<2>);
+      case variant(Instruction::NEGATE, 1):
+        return negate_step(state<1>);
+      case variant(Instruction::NEGATE, 2):
+        return negate_step(state<2>);
+      case variant(Instruction::ADD_INT, 0):
+        return integer_step(state<0>, add_overflows, add);
+      case variant(Instruction::ADD_INT, 1):
+        return integer_step(state<1>, add_overflows, add);
+      case variant(Instruction::ADD_INT, 2):
+        return integer_step(state<2>, add_overflows, add);
+      case variant(Instruction::SUB_INT, 0):
+        return integer_step(state<0>, sub_overflows, sub);
+      case variant(Instruction::SUB_INT, 1):
+        return integer_step(state<1>, sub_overflows, sub);
+      case variant(Instruction::SUB_INT, 2):
+        return integer_step(state<2>, sub_overflows, sub);
+      case variant(Instruction::MUL_INT, 0):
+        return integer_step(state<0>, mul_overflows, mul);
+      case variant(Instruction::MUL_INT, 1):
+        return integer_step(state<1>, mul_overflows, mul);
+      case variant(Instruction::MUL_INT, 2):
+        return integer_step(state<2>, mul_overflows, mul);
+      case variant(Instruction::ADD_REAL, 0):
+        return real_step(state<0>, std::plus<f64>{});
+      case variant(Instruction::ADD_REAL, 1):
+        return real_step(state<1>, std::plus<f64>{});
+      case variant(Instruction::ADD_REAL, 2):
+        return real_step(state<2>, std::plus<f64>{});
+      case variant(Instruction::SUB_REAL, 0):
+        return real_step(state<0>, std::minus<f64>{});
+      case variant(Instruction::SUB_REAL, 1):
+        return real_step(state<1>, std::minus<f64>{});
+      case variant(Instruction::SUB_REAL, 2):
+        return real_step(state<2>, std::minus<f64>{});
+      case variant(Instruction::MUL_REAL, 0):
+        return real_step(state<0>, std::multiplies<f64>{});
+      case variant(Instruction::MUL_REAL, 1):
+        return real_step(state<1>, std::multiplies<f64>{});
+      case variant(Instruction::MUL_REAL, 2):
+        return real_step(state<2>, std::multiplies<f64>{});
+      case variant(Instruction::DIV_REAL, 0):
+        return real_step(state<0>, std::divides<f64>{});
+      case variant(Instruction::DIV_REAL, 1):
+        return real_step(state<1>, std::divides<f64>{});
+      case variant(Instruction::DIV_REAL, 2):
+        return real_step(state<2>, std::divides<f64>{});
+
+      default:
+        return false;
+      }
+    };
+#endif
+
+    // the time is only read once per period of instructions.
+    constexpr size_t period    = 1024;
+    size_t           remaining = budget.instructions;
+    auto             deadline  = std::chrono::steady_clock::time_point::max();
+    struct Tally {
+      size_t       *spent;
+      size_t const &remaining;
+      size_t        budget;
+      ~Tally() {
+        if (spent != nullptr) {
+          *spent += budget - remaining;
+        }
+      }
+    } tally{budgeted ? spent : nullptr, remaining, budget.instructions};
+    if constexpr (budgeted) {
+      if (budget.time != std::chrono::steady_clock::duration::max()) {
+        deadline = std::chrono::steady_clock::now() + budget.time;
+      }
+    }
 
     while (true) {
+      if constexpr (checked) {
+        if (ip == chunk->end()) {
+          return error("instruction pointer out of bounds");
+        }
+      }
+
+      if constexpr (budgeted) {
+        if (remaining == 0 ||
+            ((remaining % period) == 0 &&
+             std::chrono::steady_clock::now() >= deadline)) {
+#if defined(VOYAGE_TOS_CACHE)
+          spill();
+#endif
+          frame->ip = ip;
+          return result(std::nullopt);
+        }
+        remaining--;
+      }
+
       if constexpr (debug) {
-        print_instruction(std::cerr, bytecode,
-                          (size_t)(std::distance(bytecode.begin(), ip)));
+        print_instruction(std::cerr, *chunk, offset_of(ip));
       }
 
+#if defined(VOYAGE_PROFILE)
+      chunk->count(offset_of(ip));
+#endif
+
+#if defined(VOYAGE_TOS_CACHE)
+      if constexpr (!checked) {
+        if (cached_step()) {
+          continue;
+        }
+        spill();
+      }
+#endif
+
       switch ((Instruction)(read_byte())) {
       case Instruction::RETURN: {
-        if (m_stack.empty()) {
-          // #TODO return nil
-          return result({0.0});
+        // #TODO return nil
+        Value value = (m_stack.size() > frame->base) ? m_stack.pop()
+                                                     : Value{0.0};
+        m_stack.truncate(frame->base);
+        m_frame_count--;
+        if (m_frame_count == 0) {
+          // a fiber returned, its result is kept for those joining
+          // it, and its strand is freed.
+          if (m_scheduler.running() != m_scheduler.main()) {
+            Fiber *fiber = m_scheduler.running();
+            m_scheduler.finish(value);
+            m_heap.collector().barrier(fiber);
+            if (!m_scheduler.ready()) {
+              return result(deadlock());
+            }
+            yield();
+            fiber->release();
+            resume();
+            break;
+          }
+          settle();
+          return result(value);
         }
-        return result(m_stack.pop());
+
+        m_stack.push(value);
+        frame = &m_frames[m_frame_count - 1];
+        chunk = frame->bytecode;
+        ip    = frame->ip;
+        break;
+      }
+
+      case Instruction::CALL: {
+        if constexpr (checked) {
+          if (!valid_immediate(sizeof(u8), m_stack.size())) {
+            return error("stack underflow");
+          }
+        }
+        size_t arguments = read_immediate(sizeof(u8));
+        if (auto failure = call(m_stack.peek(arguments), arguments)) {
+          return result(std::move(*failure));
+        }
+        break;
+      }
+
+      // the callee and its arguments replace the window of the
+      // current frame, which is then reused for the callee, so
+      // a chain of tail calls runs in constant stack space.
+      case Instruction::TAIL_CALL: {
+        if constexpr (checked) {
+          if (!valid_immediate(sizeof(u8), m_stack.size())) {
+            return error("stack underflow");
+          }
+          if (frame->function == nullptr) {
+            return error("TAIL_CALL outside of a function");
+          }
+        }
+        size_t arguments = read_immediate(sizeof(u8));
+        size_t window    = arguments + 1;
+        size_t from      = m_stack.size() - window;
+        for (size_t i = 0; i < window; ++i) {
+          m_stack[frame->base + i] = m_stack[from + i];
+        }
+        m_stack.truncate(frame->base + window);
+
+        if (auto failure = call(m_stack.peek(arguments), arguments, true)) {
+          return result(std::move(*failure));
+        }
+        break;
+      }
+
+      // the arguments are passed to the native in place, then
+      // replaced by its result.
+      case Instruction::CALL_NATIVE: {
+        if constexpr (checked) {
+          if (!valid_immediate(sizeof(u16), m_natives.size())) {
+            return error("native out of bounds");
+          }
+        }
+        Native const &native = m_natives[read_immediate(sizeof(u16))];
+        if constexpr (checked) {
+          if (m_stack.size() - frame->base < native.arity) {
+            return error("stack underflow");
+          }
+        }
+        size_t base    = m_stack.size() - native.arity;
+        auto   outcome = native.function(
+            m_heap, std::span<Value const>{
+                        m_stack.begin() + (std::ptrdiff_t)(base), native.arity});
+        if (!outcome) {
+          return error(outcome.error());
+        }
+        m_stack.truncate(base);
+        m_stack.push(*outcome);
+        collect();
+        break;
       }
 
       case Instruction::CONSTANT_U8: {
+        if constexpr (checked) {
+          if (!valid_constant(sizeof(u8))) {
+            return error("constant out of bounds");
+          }
+        }
         Value value = read_constant(sizeof(u8));
         m_stack.push(value);
         break;
       }
 
       case Instruction::CONSTANT_U16: {
+        if constexpr (checked) {
+          if (!valid_constant(sizeof(u16))) {
+            return error("constant out of bounds");
+          }
+        }
         Value value = read_constant(sizeof(u16));
         m_stack.push(value);
         break;
       }
 
       case Instruction::CONSTANT_U32: {
+        if constexpr (checked) {
+          if (!valid_constant(sizeof(u32))) {
+            return error("constant out of bounds");
+          }
+        }
         Value value = read_constant(sizeof(u32));
         m_stack.push(value);
         break;
       }
 
       case Instruction::CONSTANT_U64: {
+        if constexpr (checked) {
+          if (!valid_constant(sizeof(u64))) {
+            return error("constant out of bounds");
+          }
+        }
         Value value = read_constant(sizeof(u64));
         m_stack.push(value);
         break;
       }
 
+      case Instruction::POP: {
+        if constexpr (checked) {
+          if (m_stack.empty()) {
+            return error("stack underflow");
+          }
+        }
+        m_stack.pop();
+        break;
+      }
+
+      case Instruction::GET_LOCAL: {
+        if constexpr (checked) {
+          if (!valid_immediate(sizeof(u8), m_stack.size() - frame->base)) {
+            return error("local slot out of bounds");
+          }
+        }
+        size_t slot = read_immediate(sizeof(u8));
+        m_stack.push(m_stack[frame->base + slot]);
+        break;
+      }
+
+      case Instruction::SET_LOCAL: {
+        if constexpr (checked) {
+          if (!valid_immediate(sizeof(u8), m_stack.size() - frame->base)) {
+            return error("local slot out of bounds");
+          }
+        }
+        size_t slot                 = read_immediate(sizeof(u8));
+        m_stack[frame->base + slot] = m_stack.peek();
+        break;
+      }
+
+      case Instruction::GET_GLOBAL: {
+        if constexpr (checked) {
+          if (!valid_immediate(sizeof(u16), m_globals.size())) {
+            return error("global slot out of bounds");
+          }
+        }
+        size_t slot = read_immediate(sizeof(u16));
+        m_stack.push(m_globals[slot]);
+        break;
+      }
+
+      case Instruction::SET_GLOBAL: {
+        if constexpr (checked) {
+          if (m_stack.empty()) {
+            return error("stack underflow");
+          }
+          if (!valid_immediate(sizeof(u16), m_globals.size())) {
+            return error("global slot out of bounds");
+          }
+        }
+        size_t slot     = read_immediate(sizeof(u16));
+        m_globals[slot] = m_stack.peek();
+        break;
+      }
+
+      case Instruction::DEFINE_GLOBAL: {
+        if constexpr (checked) {
+          if (m_stack.empty()) {
+            return error("stack underflow");
+          }
+          if (!valid_immediate(sizeof(u16), m_globals.size())) {
+            return error("global slot out of bounds");
+          }
+        }
+        size_t slot     = read_immediate(sizeof(u16));
+        m_globals[slot] = m_stack.pop();
+        break;
+      }
+
       case Instruction::NEGATE: {
+        if constexpr (checked) {
+          if (m_stack.empty()) {
+            return error("stack underflow");
+          }
+        }
         Value &value = m_stack.peek();
-        value.data   = -value.data;
+        if (!value.isNumber()) {
+          auto outcome = negation(m_heap, value);
+          if (!outcome) {
+            return error(outcome.error());
+          }
+          value = *outcome;
+          collect();
+          break;
+        }
+        value = negate(value);
         break;
       }
 
       case Instruction::ADD: {
+        if constexpr (checked) {
+          if (m_stack.size() < 2) {
+            return error("stack underflow");
+          }
+        }
         Value &b = m_stack.peek(0);
         Value &a = m_stack.peek(1);
-        a.data   = a.data + b.data;
+        if (!a.isNumber() || !b.isNumber()) {
+          auto outcome = arithmetic(m_heap, Instruction::ADD, a, b);
+          if (!outcome) {
+            return error(outcome.error());
+          }
+          a = *outcome;
+          m_stack.pop();
+          collect();
+          break;
+        }
+        quicken(*chunk, offset(), a, b, Instruction::ADD_INT,
+                Instruction::ADD_REAL);
+        a = add(a, b);
         m_stack.pop();
         break;
       }
 
       case Instruction::SUB: {
+        if constexpr (checked) {
+          if (m_stack.size() < 2) {
+            return error("stack underflow");
+          }
+        }
         Value &b = m_stack.peek(0);
         Value &a = m_stack.peek(1);
-        a.data   = a.data - b.data;
+        if (!a.isNumber() || !b.isNumber()) {
+          auto outcome = arithmetic(m_heap, Instruction::SUB, a, b);
+          if (!outcome) {
+            return error(outcome.error());
+          }
+          a = *outcome;
+          m_stack.pop();
+          collect();
+          break;
+        }
+        quicken(*chunk, offset(), a, b, Instruction::SUB_INT,
+                Instruction::SUB_REAL);
+        a = sub(a, b);
         m_stack.pop();
         break;
       }
 
       case Instruction::MUL: {
+        if constexpr (checked) {
+          if (m_stack.size() < 2) {
+            return error("stack underflow");
+          }
+        }
         Value &b = m_stack.peek(0);
         Value &a = m_stack.peek(1);
-        a.data   = a.data * b.data;
+        if (!a.isNumber() || !b.isNumber()) {
+          auto outcome = arithmetic(m_heap, Instruction::MUL, a, b);
+          if (!outcome) {
+            return error(outcome.error());
+          }
+          a = *outcome;
+          m_stack.pop();
+          collect();
+          break;
+        }
+        quicken(*chunk, offset(), a, b, Instruction::MUL_INT,
+                Instruction::MUL_REAL);
+        a = mul(a, b);
         m_stack.pop();
         break;
       }
 
       case Instruction::DIV: {
+        if constexpr (checked) {
+          if (m_stack.size() < 2) {
+            return error("stack underflow");
+          }
+        }
         Value &b = m_stack.peek(0);
         Value &a = m_stack.peek(1);
-        a.data   = a.data / b.data;
+        if (!a.isNumber() || !b.isNumber()) {
+          auto outcome = arithmetic(m_heap, Instruction::DIV, a, b);
+          if (!outcome) {
+            return error(outcome.error());
+          }
+          a = *outcome;
+          m_stack.pop();
+          collect();
+          break;
+        }
+        quicken(*chunk, offset(), a, b, Instruction::DIV,
+                Instruction::DIV_REAL);
+        a = div(a, b);
         m_stack.pop();
         break;
       }
 
+      case Instruction::ADD_INT: {
+        if constexpr (checked) {
+          if (m_stack.size() < 2) {
+            return error("stack underflow");
+          }
+        }
+        Value &b = m_stack.peek(0);
+        Value &a = m_stack.peek(1);
+        if (a.isInteger() && b.isInteger()) [[likely]] {
+          i64 result = 0;
+          if (!__builtin_add_overflow(a.integer(), b.integer(), &result))
+              [[likely]] {
+            a = Value{result};
+          } else {
+            a = add(a, b);
+          }
+        } else {
+          deoptimize(*chunk, offset(), a, b, Instruction::ADD);
+          // execute the site again, as the generic instruction.
+          --ip;
+          continue;
+        }
+        m_stack.pop();
+        break;
+      }
+
+      case Instruction::SUB_INT: {
+        if constexpr (checked) {
+          if (m_stack.size() < 2) {
+            return error("stack underflow");
+          }
+        }
+        Value &b = m_stack.peek(0);
+        Value &a = m_stack.peek(1);
+        if (a.isInteger() && b.isInteger()) [[likely]] {
+          i64 result = 0;
+          if (!__builtin_sub_overflow(a.integer(), b.integer(), &result))
+              [[likely]] {
+            a = Value{result};
+          } else {
+            a = sub(a, b);
+          }
+        } else {
+          deoptimize(*chunk, offset(), a, b, Instruction::SUB);
+          // execute the site again, as the generic instruction.
+          --ip;
+          continue;
+        }
+        m_stack.pop();
+        break;
+      }
+
+      case Instruction::MUL_INT: {
+        if constexpr (checked) {
+          if (m_stack.size() < 2) {
+            return error("stack underflow");
+          }
+        }
+        Value &b = m_stack.peek(0);
+        Value &a = m_stack.peek(1);
+        if (a.isInteger() && b.isInteger()) [[likely]] {
+          i64 result = 0;
+          if (!__builtin_mul_overflow(a.integer(), b.integer(), &result))
+              [[likely]] {
+            a = Value{result};
+          } else {
+            a = mul(a, b);
+          }
+        } else {
+          deoptimize(*chunk, offset(), a, b, Instruction::MUL);
+          // execute the site again, as the generic instruction.
+          --ip;
+          continue;
+        }
+        m_stack.pop();
+        break;
+      }
+
+      case Instruction::ADD_REAL: {
+        if constexpr (checked) {
+          if (m_stack.size() < 2) {
+            return error("stack underflow");
+          }
+        }
+        Value &b = m_stack.peek(0);
+        Value &a = m_stack.peek(1);
+        if (a.isReal() && b.isReal()) [[likely]] {
+          a = Value{a.real() + b.real()};
+        } else {
+          deoptimize(*chunk, offset(), a, b, Instruction::ADD);
+          // execute the site again, as the generic instruction.
+          --ip;
+          continue;
+        }
+        m_stack.pop();
+        break;
+      }
+
+      case Instruction::SUB_REAL: {
+        if constexpr (checked) {
+          if (m_stack.size() < 2) {
+            return error("stack underflow");
+          }
+        }
+        Value &b = m_stack.peek(0);
+        Value &a = m_stack.peek(1);
+        if (a.isReal() && b.isReal()) [[likely]] {
+          a = Value{a.real() - b.real()};
+        } else {
+          deoptimize(*chunk, offset(), a, b, Instruction::SUB);
+          // execute the site again, as the generic instruction.
+          --ip;
+          continue;
+        }
+        m_stack.pop();
+        break;
+      }
+
+      case Instruction::MUL_REAL: {
+        if constexpr (checked) {
+          if (m_stack.size() < 2) {
+            return error("stack underflow");
+          }
+        }
+        Value &b = m_stack.peek(0);
+        Value &a = m_stack.peek(1);
+        if (a.isReal() && b.isReal()) [[likely]] {
+          a = Value{a.real() * b.real()};
+        } else {
+          deoptimize(*chunk, offset(), a, b, Instruction::MUL);
+          // execute the site again, as the generic instruction.
+          --ip;
+          continue;
+        }
+        m_stack.pop();
+        break;
+      }
+
+      case Instruction::DIV_REAL: {
+        if constexpr (checked) {
+          if (m_stack.size() < 2) {
+            return error("stack underflow");
+          }
+        }
+        Value &b = m_stack.peek(0);
+        Value &a = m_stack.peek(1);
+        if (a.isReal() && b.isReal()) [[likely]] {
+          a = Value{a.real() / b.real()};
+        } else {
+          deoptimize(*chunk, offset(), a, b, Instruction::DIV);
+          // execute the site again, as the generic instruction.
+          --ip;
+          continue;
+        }
+        m_stack.pop();
+        break;
+      }
+
+      case Instruction::ARRAY: {
+        if constexpr (checked) {
+          if (!valid_immediate(sizeof(u16), m_stack.size() - frame->base + 1)) {
+            return error("stack underflow");
+          }
+        }
+        size_t count   = read_immediate(sizeof(u16));
+        size_t base    = m_stack.size() - count;
+        auto   outcome = arrayOf(
+            m_heap, std::span<Value const>{
+                        m_stack.begin() + (std::ptrdiff_t)(base), count});
+        if (!outcome) {
+          return error(outcome.error());
+        }
+        m_stack.truncate(base);
+        m_stack.push(*outcome);
+        collect();
+        break;
+      }
+
+      case Instruction::INDEX: {
+        if constexpr (checked) {
+          if (m_stack.size() < 2) {
+            return error("stack underflow");
+          }
+        }
+        auto outcome = element(m_stack.peek(1), m_stack.peek(0));
+        if (!outcome) {
+          return error(outcome.error());
+        }
+        m_stack.pop();
+        m_stack.peek() = *outcome;
+        break;
+      }
+
+      // the bounds which are present are above the array, start first.
+      case Instruction::SLICE: {
+        if constexpr (checked) {
+          if (!valid_immediate(sizeof(u8), slice_start + slice_end + 1)) {
+            return error("invalid slice bounds");
+          }
+        }
+        u8     bounds   = (u8)(read_immediate(sizeof(u8)));
+        size_t operands = 1 + ((bounds & slice_start) != 0) +
+                          ((bounds & slice_end) != 0);
+        if constexpr (checked) {
+          if (m_stack.size() - frame->base < operands) {
+            return error("stack underflow");
+          }
+        }
+        std::optional<Value> end;
+        std::optional<Value> start;
+        if (bounds & slice_end) {
+          end = m_stack.pop();
+        }
+        if (bounds & slice_start) {
+          start = m_stack.pop();
+        }
+        auto outcome = slice(m_heap, m_stack.peek(), start, end);
+        if (!outcome) {
+          return error(outcome.error());
+        }
+        m_stack.peek() = *outcome;
+        collect();
+        break;
+      }
+
+      // the call is checked as it would be if it were made here,
+      // so that a fiber never fails before it begins.
+      case Instruction::SPAWN: {
+        if constexpr (checked) {
+          if (!valid_immediate(sizeof(u8), m_stack.size())) {
+            return error("stack underflow");
+          }
+        }
+        size_t arguments = read_immediate(sizeof(u8));
+        if (auto failure = callable(m_stack.peek(arguments), arguments)) {
+          return result(std::move(*failure));
+        }
+        spawn<checked>(arguments);
+        collect();
+        break;
+      }
+
+      case Instruction::JOIN: {
+        if constexpr (checked) {
+          if (m_stack.empty()) {
+            return error("stack underflow");
+          }
+        }
+        Value handle = m_stack.peek();
+        if (!handle.isFiber()) {
+          return error("can only join fibers");
+        }
+        Fiber *fiber = handle.fiber();
+        if (fiber->status() == Fiber::Status::Done) {
+          m_stack.peek() = fiber->result();
+          break;
+        }
+        if (fiber->status() == Fiber::Status::Abandoned ||
+            !m_scheduler.owns(fiber)) {
+          return error("can only join fibers of the running program");
+        }
+        if (fiber == m_scheduler.running()) {
+          return error("a fiber can not join itself");
+        }
+        if (auto failure = block(fiber->joiners(), fiber)) {
+          return result(std::move(*failure));
+        }
+        break;
+      }
+
+      case Instruction::CHANNEL: {
+        if constexpr (checked) {
+          if (m_stack.empty()) {
+            return error("stack underflow");
+          }
+        }
+        Value capacity = m_stack.peek();
+        if (!capacity.isInteger() || capacity.integer() < 1) {
+          return error("channel capacity must be a positive integer");
+        }
+        if ((u64)(capacity.integer()) > Channel::max_capacity) {
+          return error("channel capacity out of range");
+        }
+        m_stack.peek() = Value{m_heap.channel((size_t)(capacity.integer()))};
+        collect();
+        break;
+      }
+
+      case Instruction::SEND: {
+        if constexpr (checked) {
+          if (m_stack.size() < 2) {
+            return error("stack underflow");
+          }
+        }
+        Value target = m_stack.peek(1);
+        if (!target.isChannel()) {
+          return error("can only send to channels");
+        }
+        Channel *channel = target.channel();
+        if (channel->full()) {
+          if (auto failure = block(channel->senders(), channel)) {
+            return result(std::move(*failure));
+          }
+          break;
+        }
+        Value value = m_stack.pop();
+        channel->push(value);
+        m_heap.collector().barrier(channel);
+        m_scheduler.wake(channel->receivers());
+        m_stack.peek() = value;
+        break;
+      }
+
+      case Instruction::RECEIVE: {
+        if constexpr (checked) {
+          if (m_stack.empty()) {
+            return error("stack underflow");
+          }
+        }
+        Value source = m_stack.peek();
+        if (!source.isChannel()) {
+          return error("can only receive from channels");
+        }
+        Channel *channel = source.channel();
+        if (channel->empty()) {
+          if (auto failure = block(channel->receivers(), channel)) {
+            return result(std::move(*failure));
+          }
+          break;
+        }
+        m_stack.peek() = channel->pop();
+        m_scheduler.wake(channel->senders());
+        break;
+      }
+
       default: {
-        return result(Error{Error::Kind::Runtime, "unknown instruction",
-                            bytecode.getLine(ip - 1)});
+        if constexpr (checked) {
+          return error("unknown instruction");
+        } else {
+          std::unreachable();
+        }
       }
       }
 
@@ -122,5 +1444,118 @@ public:
       }
     }
   }
+
+public:
+  VirtualMachine() {
+    m_stack.reserve(max_frames * 16);
+    m_frames.resize(max_frames);
+  }
+  VirtualMachine(VirtualMachine const &)            = delete;
+  VirtualMachine &operator=(VirtualMachine const &) = delete;
+
+  [[nodiscard]] Heap    &heap() noexcept { return m_heap; }
+  [[nodiscard]] Globals &globals() noexcept { return m_globals; }
+  [[nodiscard]] Natives &natives() noexcept { return m_natives; }
+
+  // enables the optimizer, which then optimizes every function
+  // compiled on its first call, and may be given to a parser to
+  // optimize the programs it parses.
+  void optimize() {
+    if (!m_optimizer) {
+      m_optimizer.emplace(m_natives);
+    }
+  }
+  [[nodiscard]] Optimizer *optimizer() noexcept {
+    return m_optimizer ? &*m_optimizer : nullptr;
+  }
+
+  // the state left by the runs so far, see snapshot.hpp.
+  std::expected<std::string, Error> snapshot() {
+    for (size_t slot = 0; slot < m_globals.size(); ++slot) {
+      Value const &value = m_globals.values()[slot];
+      if (value.isFiber() || value.isChannel()) {
+        return std::unexpected{Error{
+            Error::Kind::Runtime,
+            std::format("global '{:s}' holds a {:s}, which can not be "
+                        "snapshotted",
+                        m_globals.name(slot)->view(),
+                        value.isFiber() ? "fiber" : "channel"),
+            0}};
+      }
+    }
+    if (m_snapshot) {
+      if (auto restored = m_snapshot->restoreAll(m_heap); !restored) {
+        return std::unexpected{restored.error()};
+      }
+    }
+    return Snapshot::write(m_globals, m_natives);
+  }
+
+  // restores the state of the snapshot at the path, before anything
+  // has run, so that its globals keep their slots.
+  std::expected<void, Error> restore(std::string const &path) {
+    if (m_snapshot) {
+      return std::unexpected{Error{Error::Kind::Verify,
+                                   "a snapshot was already restored", 0}};
+    }
+    auto mapped = Snapshot::map(path, m_heap, m_globals, m_natives);
+    if (!mapped) {
+      return std::unexpected{mapped.error()};
+    }
+    m_snapshot = std::move(*mapped);
+    retain(m_snapshot->roots());
+    return {};
+  }
+
+  // keeps the constants of a chunk alive until it is released.
+  void retain(Bytecode &bytecode) { m_retained.push_back(&bytecode); }
+  void release(Bytecode &bytecode) { std::erase(m_retained, &bytecode); }
+
+  // keeps the names and values of globals alive, while they are not
+  // the globals of the virtual machine, until they are released.
+  void retain(Globals &globals) { m_retained_globals.push_back(&globals); }
+  void release(Globals &globals) { std::erase(m_retained_globals, &globals); }
+
+  // verified bytecode runs without per instruction checks,
+  // anything else takes the checked path.
+  std::expected<Value, Error> interpret(Bytecode &bytecode) noexcept {
+    enter(bytecode);
+    auto outcome = bytecode.verified() ? execute<false>() : execute<true>();
+    if (!outcome) {
+      reset();
+      return std::unexpected{std::move(outcome.error())};
+    }
+    return **outcome;
+  }
+
+  // begins running top level code as a task, which then runs in
+  // slices. the bytecode must outlive the task.
+  void start(Task &task, Bytecode &bytecode) {
+    swap(task);
+    reset();
+    enter(bytecode);
+    swap(task);
+    task.m_checked  = !bytecode.verified();
+    task.m_executed = 0;
+  }
+
+  // runs a task until it returns, fails, or exhausts the budget,
+  // in which case it may be run again to resume it.
+  Slice run(Task &task, Budget budget) noexcept {
+    if (task.done()) {
+      return std::unexpected{
+          Error{Error::Kind::Runtime, "task is not running", 0}};
+    }
+
+    swap(task);
+    auto outcome = task.m_checked
+                       ? execute<true, true>(budget, &task.m_executed)
+                       : execute<false, true>(budget, &task.m_executed);
+    if (!outcome) {
+      reset();
+    }
+    swap(task);
+    return outcome;
+  }
 };
 } // namespace voyage
@@ -0,0 +1,110 @@
+#pragma once
+#include <expected>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "common.hpp"
+#include "error.hpp"
+// #NOTE printing a value prints the object it refers to, which is
+// defined along with the heap.
+#include "heap.hpp"
+#include "natives.hpp"
+#include "value.hpp"
+
+// the interface of libvoyage, for hosts which embed the interpreter.
+// everything else in include is an implementation detail, which may
+// change between versions.
+namespace voyage {
+class Bytecode;
+class Engine;
+class Globals;
+class VirtualMachine;
+
+// a source compiled once by an Engine, which may be evaluated any
+// number of times without being parsed again. the inputs of the
+// program are globals, assigned by the host for each evaluation.
+// a program compiled by an isolated engine has globals of its own.
+//
+// #NOTE a program must not outlive the engine which compiled it.
+class Program {
+private:
+  friend class Engine;
+
+  Engine                   *m_engine;
+  std::unique_ptr<Bytecode> m_bytecode;
+  std::vector<u32>          m_inputs;
+  std::unique_ptr<Globals>  m_globals;
+
+  Program(Engine *engine, std::unique_ptr<Bytecode> bytecode,
+          std::vector<u32> inputs, std::unique_ptr<Globals> globals) noexcept;
+
+public:
+  Program(Program &&other) noexcept;
+  Program &operator=(Program &&other) noexcept;
+  ~Program();
+
+  [[nodiscard]] size_t inputs() const noexcept { return m_inputs.size(); }
+};
+
+// an interpreter instance, owning the heap and the globals which
+// its programs share. an engine is not thread safe, a host which
+// evaluates concurrently uses an engine per thread.
+//
+// an isolated engine shares no globals between its programs. each
+// program declares its globals in a table of its own, which is
+// reset before each evaluation, so nothing one evaluation assigns
+// is seen by another, and the globals of a program are released
+// along with it.
+class Engine {
+private:
+  std::unique_ptr<VirtualMachine> m_vm;
+  bool                            m_isolated;
+
+  void release(Bytecode &bytecode, Globals *globals) noexcept;
+  std::expected<Program, Error>
+  declareAndCompile(std::string_view                  source,
+                    std::span<std::string_view const> inputs);
+  friend class Program;
+
+public:
+  explicit Engine(bool isolated = false);
+  Engine(Engine const &)            = delete;
+  Engine &operator=(Engine const &) = delete;
+  ~Engine();
+
+  // compiles source, in which each of the named inputs may be
+  // referred to as a global variable.
+  std::expected<Program, Error>
+  compile(std::string_view                  source,
+          std::span<std::string_view const> inputs = {});
+
+  // runs a program with the given values assigned to its inputs,
+  // in the order they were named when it was compiled.
+  std::expected<Value, Error> evaluate(Program               &program,
+                                       std::span<Value const> inputs = {});
+
+  // defines a native function, which programs compiled afterwards
+  // may call by name. returns false when a native with that name
+  // and a different arity exists, or there are too many natives.
+  bool define(std::string_view name, u8 arity, NativeFn function);
+
+  // defines a native function from an ordinary C++ function, such
+  // as double(double, double).
+  template <auto F> bool define(std::string_view name) {
+    return define(name, (u8)(Adapter<F>::arity), &Adapter<F>::call);
+  }
+
+  // a string owned by the engine, to be passed as an input.
+  //
+  // #NOTE a string which is not reachable from a global, or from
+  // a program, is only valid until the next evaluation.
+  Value string(std::string_view text);
+
+  // the text of a string value, viewed in place rather than copied,
+  // with the same lifetime as the value itself.
+  static std::optional<std::string_view> text(Value const &value) noexcept;
+};
+} // namespace voyage
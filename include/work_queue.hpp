@@ -0,0 +1,47 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace voyage {
+// a queue shared between threads. pop blocks until an item is
+// available, or returns nothing once the queue has been closed
+// and drained.
+template <class T> class WorkQueue {
+private:
+  std::mutex              m_mutex;
+  std::condition_variable m_ready;
+  std::deque<T>           m_items;
+  bool                    m_closed = false;
+
+public:
+  void push(T item) {
+    {
+      std::lock_guard lock{m_mutex};
+      m_items.push_back(std::move(item));
+    }
+    m_ready.notify_one();
+  }
+
+  std::optional<T> pop() {
+    std::unique_lock lock{m_mutex};
+    m_ready.wait(lock, [this]() { return m_closed || !m_items.empty(); });
+    if (m_items.empty()) {
+      return std::nullopt;
+    }
+
+    T item = std::move(m_items.front());
+    m_items.pop_front();
+    return item;
+  }
+
+  void close() {
+    {
+      std::lock_guard lock{m_mutex};
+      m_closed = true;
+    }
+    m_ready.notify_all();
+  }
+};
+} // namespace voyage
@@ -0,0 +1,24 @@
+// mixed integer and real arithmetic, through locals, 2^14 times.
+fun mix(a, b) {
+  var i = a * 7 - b;
+  var r = a * 0.5 + b / 4;
+  i = i * i - a * b + 3;
+  r = r * r - r / 3 + 1.5;
+  i = i - i * 2 + b * 5;
+  r = -r + i * 0.25;
+  return r + i;
+}
+fun m1(x) { return mix(x, x + 1) + mix(x + 2, x - 1); }
+fun m2(x) { return m1(x) + m1(x + 3); }
+fun m3(x) { return m2(x) + m2(x + 3); }
+fun m4(x) { return m3(x) + m3(x + 3); }
+fun m5(x) { return m4(x) + m4(x + 3); }
+fun m6(x) { return m5(x) + m5(x + 3); }
+fun m7(x) { return m6(x) + m6(x + 3); }
+fun m8(x) { return m7(x) + m7(x + 3); }
+fun m9(x) { return m8(x) + m8(x + 3); }
+fun m10(x) { return m9(x) + m9(x + 3); }
+fun m11(x) { return m10(x) + m10(x + 3); }
+fun m12(x) { return m11(x) + m11(x + 3); }
+fun m13(x) { return m12(x) + m12(x + 3); }
+m13(2)
@@ -0,0 +1,21 @@
+// broadcasting arithmetic over small arrays, indexing and slicing,
+// 2^12 times.
+var ramp = [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16];
+fun scale(a, k) { return (a * k + ramp) / 2; }
+fun a1(x) {
+  var v = scale(ramp, x);
+  var w = v[2:10] - v[6:14];
+  return v[3] + scale(v, 0.5)[1] + w[7];
+}
+fun a2(x) { return a1(x) + a1(x + 1); }
+fun a3(x) { return a2(x) + a2(x + 1); }
+fun a4(x) { return a3(x) + a3(x + 1); }
+fun a5(x) { return a4(x) + a4(x + 1); }
+fun a6(x) { return a5(x) + a5(x + 1); }
+fun a7(x) { return a6(x) + a6(x + 1); }
+fun a8(x) { return a7(x) + a7(x + 1); }
+fun a9(x) { return a8(x) + a8(x + 1); }
+fun a10(x) { return a9(x) + a9(x + 1); }
+fun a11(x) { return a10(x) + a10(x + 1); }
+fun a12(x) { return a11(x) + a11(x + 1); }
+a12(1)
@@ -0,0 +1,20 @@
+// a binary tree of calls, 2^16 leaves deep, each leaf a little
+// integer arithmetic.
+fun leaf(x) { return x * 3 + 1; }
+fun c1(x) { return leaf(x) + leaf(x + 1); }
+fun c2(x) { return c1(x) + c1(x + 1); }
+fun c3(x) { return c2(x) + c2(x + 1); }
+fun c4(x) { return c3(x) + c3(x + 1); }
+fun c5(x) { return c4(x) + c4(x + 1); }
+fun c6(x) { return c5(x) + c5(x + 1); }
+fun c7(x) { return c6(x) + c6(x + 1); }
+fun c8(x) { return c7(x) + c7(x + 1); }
+fun c9(x) { return c8(x) + c8(x + 1); }
+fun c10(x) { return c9(x) + c9(x + 1); }
+fun c11(x) { return c10(x) + c10(x + 1); }
+fun c12(x) { return c11(x) + c11(x + 1); }
+fun c13(x) { return c12(x) + c12(x + 1); }
+fun c14(x) { return c13(x) + c13(x + 1); }
+fun c15(x) { return c14(x) + c14(x + 1); }
+fun c16(x) { return c15(x) + c15(x + 1); }
+c16(1)
@@ -0,0 +1,22 @@
+// fibers which pass values through a channel, and are joined,
+// 2^12 pairs.
+fun produce(c, x) { send(c, x); return send(c, x * 2); }
+fun consume(c) { return receive(c) + receive(c); }
+fun pair(x) {
+  var c = channel(1);
+  var p = spawn produce(c, x);
+  var q = spawn consume(c);
+  return join(q) + join(p);
+}
+fun f1(x) { return pair(x) + pair(x + 1); }
+fun f2(x) { return f1(x) + f1(x + 1); }
+fun f3(x) { return f2(x) + f2(x + 1); }
+fun f4(x) { return f3(x) + f3(x + 1); }
+fun f5(x) { return f4(x) + f4(x + 1); }
+fun f6(x) { return f5(x) + f5(x + 1); }
+fun f7(x) { return f6(x) + f6(x + 1); }
+fun f8(x) { return f7(x) + f7(x + 1); }
+fun f9(x) { return f8(x) + f8(x + 1); }
+fun f10(x) { return f9(x) + f9(x + 1); }
+fun f11(x) { return f10(x) + f10(x + 1); }
+pair(0) + f11(1)
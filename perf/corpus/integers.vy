@@ -0,0 +1,25 @@
+// integer arithmetic only, through locals, 2^14 times, so every
+// operation stays on the integer fast path.
+fun ints(a, b) {
+  var i = a * 7 - b;
+  var j = a + b * 3;
+  i = i * i - a * b + 3;
+  j = j * 5 - i + 11;
+  i = i - j * 2 + b * 5;
+  j = -j + i * 4 - a;
+  return i + j;
+}
+fun i1(x) { return ints(x, x + 1) + ints(x + 2, x - 1); }
+fun i2(x) { return i1(x) + i1(x + 3); }
+fun i3(x) { return i2(x) + i2(x + 3); }
+fun i4(x) { return i3(x) + i3(x + 3); }
+fun i5(x) { return i4(x) + i4(x + 3); }
+fun i6(x) { return i5(x) + i5(x + 3); }
+fun i7(x) { return i6(x) + i6(x + 3); }
+fun i8(x) { return i7(x) + i7(x + 3); }
+fun i9(x) { return i8(x) + i8(x + 3); }
+fun i10(x) { return i9(x) + i9(x + 3); }
+fun i11(x) { return i10(x) + i10(x + 3); }
+fun i12(x) { return i11(x) + i11(x + 3); }
+fun i13(x) { return i12(x) + i12(x + 3); }
+i13(2)
@@ -0,0 +1,16 @@
+// interning, where most concatenations make a string interned
+// before and some make a new one, 2^13 times.
+fun key(a, b) { return a + ":" + b; }
+fun k1(x) { return key(x, "left") + key(x, "right"); }
+fun k2(x) { return k1(x) + k1("shared"); }
+fun k3(x) { return k2(x + "a") + k2(x); }
+fun k4(x) { return k3(x) + k3("shared"); }
+fun k5(x) { return k4(x + "b") + k4(x); }
+fun k6(x) { return k5(x) + k5("shared"); }
+fun k7(x) { return k6(x + "c") + k6(x); }
+fun k8(x) { return k7(x) + k7("shared"); }
+fun k9(x) { return k8(x + "d") + k8(x); }
+fun k10(x) { return k9(x) + k9("shared"); }
+fun k11(x) { return k10(x + "e") + k10(x); }
+fun k12(x) { return k11(x) + k11("shared"); }
+k12("root")
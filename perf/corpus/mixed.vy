@@ -0,0 +1,25 @@
+// arithmetic whose every operation has an integer and a real
+// operand, through locals, 2^14 times, so each converts one.
+fun mixed(a, b) {
+  var r = a * 0.5 - b;
+  var s = b + a * 1.25;
+  r = r * a - s * b + 0.75;
+  s = s / b + r * 3 - 2.5;
+  r = a - r * 2 + s / a;
+  s = -s + b * 0.25 - a;
+  return r + s;
+}
+fun x1(x) { return mixed(x, x + 1) + mixed(x + 2, x - 1); }
+fun x2(x) { return x1(x) + x1(x + 3); }
+fun x3(x) { return x2(x) + x2(x + 3); }
+fun x4(x) { return x3(x) + x3(x + 3); }
+fun x5(x) { return x4(x) + x4(x + 3); }
+fun x6(x) { return x5(x) + x5(x + 3); }
+fun x7(x) { return x6(x) + x6(x + 3); }
+fun x8(x) { return x7(x) + x7(x + 3); }
+fun x9(x) { return x8(x) + x8(x + 3); }
+fun x10(x) { return x9(x) + x9(x + 3); }
+fun x11(x) { return x10(x) + x10(x + 3); }
+fun x12(x) { return x11(x) + x11(x + 3); }
+fun x13(x) { return x12(x) + x12(x + 3); }
+x13(2)
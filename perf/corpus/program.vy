@@ -0,0 +1,845 @@
+// a long program, mostly for the scanner and the parser: many
+// declarations and statements, which do little when run.
+fun g0(x, y) {
+  var t = x - 64 * y - 5;
+  var u = t * 5.5 - x / 64;
+  t = t * (u - 64) * 5;
+  return t + u;
+}
+fun g1(x, y) {
+  var t = x - 32 * y - 8;
+  var u = t * 8.5 - x / 32;
+  t = t + (u - 32) * 8;
+  return t + u;
+}
+fun g2(x, y) {
+  var t = x + 69 * y - 6;
+  var u = t * 6.5 - x / 69;
+  t = t * (u - 69) * 6;
+  return t + u;
+}
+fun g3(x, y) {
+  var t = x + 72 * y - 2;
+  var u = t * 2.5 - x / 72;
+  t = t - (u - 72) * 2;
+  return t + u;
+}
+fun g4(x, y) {
+  var t = x - 13 * y - 6;
+  var u = t * 6.5 - x / 13;
+  t = t + (u - 13) * 6;
+  return t + u;
+}
+fun g5(x, y) {
+  var t = x - 25 * y - 2;
+  var u = t * 2.5 - x / 25;
+  t = t * (u - 25) * 2;
+  return t + u;
+}
+fun g6(x, y) {
+  var t = x * 78 * y - 7;
+  var u = t * 7.5 - x / 78;
+  t = t + (u - 78) * 7;
+  return t + u;
+}
+fun g7(x, y) {
+  var t = x * 9 * y - 6;
+  var u = t * 6.5 - x / 9;
+  t = t * (u - 9) * 6;
+  return t + u;
+}
+fun g8(x, y) {
+  var t = x + 56 * y - 1;
+  var u = t * 1.5 - x / 56;
+  t = t - (u - 56) * 1;
+  return t + u;
+}
+fun g9(x, y) {
+  var t = x * 35 * y - 7;
+  var u = t * 7.5 - x / 35;
+  t = t + (u - 35) * 7;
+  return t + u;
+}
+fun g10(x, y) {
+  var t = x - 26 * y - 8;
+  var u = t * 8.5 - x / 26;
+  t = t * (u - 26) * 8;
+  return t + u;
+}
+fun g11(x, y) {
+  var t = x + 75 * y - 8;
+  var u = t * 8.5 - x / 75;
+  t = t - (u - 75) * 8;
+  return t + u;
+}
+fun g12(x, y) {
+  var t = x * 80 * y - 4;
+  var u = t * 4.5 - x / 80;
+  t = t * (u - 80) * 4;
+  return t + u;
+}
+fun g13(x, y) {
+  var t = x * 16 * y - 7;
+  var u = t * 7.5 - x / 16;
+  t = t * (u - 16) * 7;
+  return t + u;
+}
+fun g14(x, y) {
+  var t = x * 90 * y - 2;
+  var u = t * 2.5 - x / 90;
+  t = t * (u - 90) * 2;
+  return t + u;
+}
+fun g15(x, y) {
+  var t = x * 64 * y - 7;
+  var u = t * 7.5 - x / 64;
+  t = t * (u - 64) * 7;
+  return t + u;
+}
+fun g16(x, y) {
+  var t = x - 87 * y - 3;
+  var u = t * 3.5 - x / 87;
+  t = t * (u - 87) * 3;
+  return t + u;
+}
+fun g17(x, y) {
+  var t = x + 67 * y - 5;
+  var u = t * 5.5 - x / 67;
+  t = t - (u - 67) * 5;
+  return t + u;
+}
+fun g18(x, y) {
+  var t = x + 98 * y - 9;
+  var u = t * 9.5 - x / 98;
+  t = t + (u - 98) * 9;
+  return t + u;
+}
+fun g19(x, y) {
+  var t = x * 46 * y - 1;
+  var u = t * 1.5 - x / 46;
+  t = t * (u - 46) * 1;
+  return t + u;
+}
+fun g20(x, y) {
+  var t = x * 53 * y - 8;
+  var u = t * 8.5 - x / 53;
+  t = t * (u - 53) * 8;
+  return t + u;
+}
+fun g21(x, y) {
+  var t = x * 29 * y - 3;
+  var u = t * 3.5 - x / 29;
+  t = t * (u - 29) * 3;
+  return t + u;
+}
+fun g22(x, y) {
+  var t = x - 13 * y - 3;
+  var u = t * 3.5 - x / 13;
+  t = t - (u - 13) * 3;
+  return t + u;
+}
+fun g23(x, y) {
+  var t = x + 32 * y - 6;
+  var u = t * 6.5 - x / 32;
+  t = t * (u - 32) * 6;
+  return t + u;
+}
+fun g24(x, y) {
+  var t = x + 67 * y - 1;
+  var u = t * 1.5 - x / 67;
+  t = t * (u - 67) * 1;
+  return t + u;
+}
+fun g25(x, y) {
+  var t = x * 31 * y - 5;
+  var u = t * 5.5 - x / 31;
+  t = t - (u - 31) * 5;
+  return t + u;
+}
+fun g26(x, y) {
+  var t = x - 60 * y - 7;
+  var u = t * 7.5 - x / 60;
+  t = t - (u - 60) * 7;
+  return t + u;
+}
+fun g27(x, y) {
+  var t = x + 12 * y - 7;
+  var u = t * 7.5 - x / 12;
+  t = t - (u - 12) * 7;
+  return t + u;
+}
+fun g28(x, y) {
+  var t = x + 7 * y - 1;
+  var u = t * 1.5 - x / 7;
+  t = t - (u - 7) * 1;
+  return t + u;
+}
+fun g29(x, y) {
+  var t = x - 86 * y - 1;
+  var u = t * 1.5 - x / 86;
+  t = t - (u - 86) * 1;
+  return t + u;
+}
+fun g30(x, y) {
+  var t = x * 45 * y - 9;
+  var u = t * 9.5 - x / 45;
+  t = t * (u - 45) * 9;
+  return t + u;
+}
+fun g31(x, y) {
+  var t = x + 67 * y - 8;
+  var u = t * 8.5 - x / 67;
+  t = t - (u - 67) * 8;
+  return t + u;
+}
+fun g32(x, y) {
+  var t = x + 21 * y - 7;
+  var u = t * 7.5 - x / 21;
+  t = t + (u - 21) * 7;
+  return t + u;
+}
+fun g33(x, y) {
+  var t = x + 85 * y - 2;
+  var u = t * 2.5 - x / 85;
+  t = t + (u - 85) * 2;
+  return t + u;
+}
+fun g34(x, y) {
+  var t = x + 17 * y - 1;
+  var u = t * 1.5 - x / 17;
+  t = t + (u - 17) * 1;
+  return t + u;
+}
+fun g35(x, y) {
+  var t = x + 40 * y - 6;
+  var u = t * 6.5 - x / 40;
+  t = t + (u - 40) * 6;
+  return t + u;
+}
+fun g36(x, y) {
+  var t = x + 65 * y - 1;
+  var u = t * 1.5 - x / 65;
+  t = t * (u - 65) * 1;
+  return t + u;
+}
+fun g37(x, y) {
+  var t = x * 91 * y - 5;
+  var u = t * 5.5 - x / 91;
+  t = t * (u - 91) * 5;
+  return t + u;
+}
+fun g38(x, y) {
+  var t = x - 4 * y - 3;
+  var u = t * 3.5 - x / 4;
+  t = t - (u - 4) * 3;
+  return t + u;
+}
+fun g39(x, y) {
+  var t = x * 56 * y - 6;
+  var u = t * 6.5 - x / 56;
+  t = t + (u - 56) * 6;
+  return t + u;
+}
+fun g40(x, y) {
+  var t = x * 29 * y - 1;
+  var u = t * 1.5 - x / 29;
+  t = t * (u - 29) * 1;
+  return t + u;
+}
+fun g41(x, y) {
+  var t = x - 37 * y - 6;
+  var u = t * 6.5 - x / 37;
+  t = t - (u - 37) * 6;
+  return t + u;
+}
+fun g42(x, y) {
+  var t = x * 6 * y - 3;
+  var u = t * 3.5 - x / 6;
+  t = t - (u - 6) * 3;
+  return t + u;
+}
+fun g43(x, y) {
+  var t = x + 37 * y - 3;
+  var u = t * 3.5 - x / 37;
+  t = t - (u - 37) * 3;
+  return t + u;
+}
+fun g44(x, y) {
+  var t = x * 49 * y - 5;
+  var u = t * 5.5 - x / 49;
+  t = t * (u - 49) * 5;
+  return t + u;
+}
+fun g45(x, y) {
+  var t = x * 16 * y - 2;
+  var u = t * 2.5 - x / 16;
+  t = t + (u - 16) * 2;
+  return t + u;
+}
+fun g46(x, y) {
+  var t = x - 4 * y - 2;
+  var u = t * 2.5 - x / 4;
+  t = t * (u - 4) * 2;
+  return t + u;
+}
+fun g47(x, y) {
+  var t = x - 63 * y - 8;
+  var u = t * 8.5 - x / 63;
+  t = t - (u - 63) * 8;
+  return t + u;
+}
+fun g48(x, y) {
+  var t = x - 86 * y - 4;
+  var u = t * 4.5 - x / 86;
+  t = t + (u - 86) * 4;
+  return t + u;
+}
+fun g49(x, y) {
+  var t = x + 74 * y - 4;
+  var u = t * 4.5 - x / 74;
+  t = t - (u - 74) * 4;
+  return t + u;
+}
+fun g50(x, y) {
+  var t = x * 32 * y - 1;
+  var u = t * 1.5 - x / 32;
+  t = t - (u - 32) * 1;
+  return t + u;
+}
+fun g51(x, y) {
+  var t = x + 24 * y - 4;
+  var u = t * 4.5 - x / 24;
+  t = t * (u - 24) * 4;
+  return t + u;
+}
+fun g52(x, y) {
+  var t = x + 36 * y - 7;
+  var u = t * 7.5 - x / 36;
+  t = t * (u - 36) * 7;
+  return t + u;
+}
+fun g53(x, y) {
+  var t = x + 37 * y - 9;
+  var u = t * 9.5 - x / 37;
+  t = t + (u - 37) * 9;
+  return t + u;
+}
+fun g54(x, y) {
+  var t = x + 86 * y - 7;
+  var u = t * 7.5 - x / 86;
+  t = t - (u - 86) * 7;
+  return t + u;
+}
+fun g55(x, y) {
+  var t = x + 51 * y - 9;
+  var u = t * 9.5 - x / 51;
+  t = t * (u - 51) * 9;
+  return t + u;
+}
+fun g56(x, y) {
+  var t = x + 40 * y - 8;
+  var u = t * 8.5 - x / 40;
+  t = t + (u - 40) * 8;
+  return t + u;
+}
+fun g57(x, y) {
+  var t = x * 22 * y - 6;
+  var u = t * 6.5 - x / 22;
+  t = t + (u - 22) * 6;
+  return t + u;
+}
+fun g58(x, y) {
+  var t = x + 4 * y - 4;
+  var u = t * 4.5 - x / 4;
+  t = t - (u - 4) * 4;
+  return t + u;
+}
+fun g59(x, y) {
+  var t = x * 37 * y - 8;
+  var u = t * 8.5 - x / 37;
+  t = t * (u - 37) * 8;
+  return t + u;
+}
+fun g60(x, y) {
+  var t = x + 69 * y - 9;
+  var u = t * 9.5 - x / 69;
+  t = t + (u - 69) * 9;
+  return t + u;
+}
+fun g61(x, y) {
+  var t = x + 5 * y - 6;
+  var u = t * 6.5 - x / 5;
+  t = t + (u - 5) * 6;
+  return t + u;
+}
+fun g62(x, y) {
+  var t = x + 12 * y - 4;
+  var u = t * 4.5 - x / 12;
+  t = t + (u - 12) * 4;
+  return t + u;
+}
+fun g63(x, y) {
+  var t = x + 91 * y - 8;
+  var u = t * 8.5 - x / 91;
+  t = t - (u - 91) * 8;
+  return t + u;
+}
+fun g64(x, y) {
+  var t = x + 94 * y - 8;
+  var u = t * 8.5 - x / 94;
+  t = t + (u - 94) * 8;
+  return t + u;
+}
+fun g65(x, y) {
+  var t = x * 47 * y - 7;
+  var u = t * 7.5 - x / 47;
+  t = t + (u - 47) * 7;
+  return t + u;
+}
+fun g66(x, y) {
+  var t = x - 14 * y - 2;
+  var u = t * 2.5 - x / 14;
+  t = t - (u - 14) * 2;
+  return t + u;
+}
+fun g67(x, y) {
+  var t = x + 80 * y - 1;
+  var u = t * 1.5 - x / 80;
+  t = t - (u - 80) * 1;
+  return t + u;
+}
+fun g68(x, y) {
+  var t = x - 61 * y - 6;
+  var u = t * 6.5 - x / 61;
+  t = t + (u - 61) * 6;
+  return t + u;
+}
+fun g69(x, y) {
+  var t = x - 68 * y - 8;
+  var u = t * 8.5 - x / 68;
+  t = t + (u - 68) * 8;
+  return t + u;
+}
+fun g70(x, y) {
+  var t = x * 59 * y - 9;
+  var u = t * 9.5 - x / 59;
+  t = t + (u - 59) * 9;
+  return t + u;
+}
+fun g71(x, y) {
+  var t = x + 96 * y - 2;
+  var u = t * 2.5 - x / 96;
+  t = t * (u - 96) * 2;
+  return t + u;
+}
+fun g72(x, y) {
+  var t = x + 20 * y - 9;
+  var u = t * 9.5 - x / 20;
+  t = t - (u - 20) * 9;
+  return t + u;
+}
+fun g73(x, y) {
+  var t = x * 38 * y - 5;
+  var u = t * 5.5 - x / 38;
+  t = t * (u - 38) * 5;
+  return t + u;
+}
+fun g74(x, y) {
+  var t = x * 73 * y - 7;
+  var u = t * 7.5 - x / 73;
+  t = t * (u - 73) * 7;
+  return t + u;
+}
+fun g75(x, y) {
+  var t = x * 78 * y - 7;
+  var u = t * 7.5 - x / 78;
+  t = t + (u - 78) * 7;
+  return t + u;
+}
+fun g76(x, y) {
+  var t = x + 76 * y - 3;
+  var u = t * 3.5 - x / 76;
+  t = t * (u - 76) * 3;
+  return t + u;
+}
+fun g77(x, y) {
+  var t = x - 28 * y - 7;
+  var u = t * 7.5 - x / 28;
+  t = t - (u - 28) * 7;
+  return t + u;
+}
+fun g78(x, y) {
+  var t = x - 44 * y - 6;
+  var u = t * 6.5 - x / 44;
+  t = t - (u - 44) * 6;
+  return t + u;
+}
+fun g79(x, y) {
+  var t = x - 45 * y - 5;
+  var u = t * 5.5 - x / 45;
+  t = t + (u - 45) * 5;
+  return t + u;
+}
+fun g80(x, y) {
+  var t = x * 14 * y - 2;
+  var u = t * 2.5 - x / 14;
+  t = t * (u - 14) * 2;
+  return t + u;
+}
+fun g81(x, y) {
+  var t = x - 69 * y - 9;
+  var u = t * 9.5 - x / 69;
+  t = t * (u - 69) * 9;
+  return t + u;
+}
+fun g82(x, y) {
+  var t = x - 82 * y - 7;
+  var u = t * 7.5 - x / 82;
+  t = t - (u - 82) * 7;
+  return t + u;
+}
+fun g83(x, y) {
+  var t = x - 70 * y - 1;
+  var u = t * 1.5 - x / 70;
+  t = t + (u - 70) * 1;
+  return t + u;
+}
+fun g84(x, y) {
+  var t = x - 19 * y - 5;
+  var u = t * 5.5 - x / 19;
+  t = t * (u - 19) * 5;
+  return t + u;
+}
+fun g85(x, y) {
+  var t = x - 43 * y - 1;
+  var u = t * 1.5 - x / 43;
+  t = t + (u - 43) * 1;
+  return t + u;
+}
+fun g86(x, y) {
+  var t = x * 21 * y - 4;
+  var u = t * 4.5 - x / 21;
+  t = t - (u - 21) * 4;
+  return t + u;
+}
+fun g87(x, y) {
+  var t = x + 1 * y - 6;
+  var u = t * 6.5 - x / 1;
+  t = t + (u - 1) * 6;
+  return t + u;
+}
+fun g88(x, y) {
+  var t = x * 65 * y - 7;
+  var u = t * 7.5 - x / 65;
+  t = t * (u - 65) * 7;
+  return t + u;
+}
+fun g89(x, y) {
+  var t = x * 55 * y - 6;
+  var u = t * 6.5 - x / 55;
+  t = t * (u - 55) * 6;
+  return t + u;
+}
+fun g90(x, y) {
+  var t = x - 77 * y - 6;
+  var u = t * 6.5 - x / 77;
+  t = t - (u - 77) * 6;
+  return t + u;
+}
+fun g91(x, y) {
+  var t = x + 58 * y - 4;
+  var u = t * 4.5 - x / 58;
+  t = t * (u - 58) * 4;
+  return t + u;
+}
+fun g92(x, y) {
+  var t = x - 55 * y - 7;
+  var u = t * 7.5 - x / 55;
+  t = t * (u - 55) * 7;
+  return t + u;
+}
+fun g93(x, y) {
+  var t = x - 43 * y - 5;
+  var u = t * 5.5 - x / 43;
+  t = t * (u - 43) * 5;
+  return t + u;
+}
+fun g94(x, y) {
+  var t = x - 55 * y - 1;
+  var u = t * 1.5 - x / 55;
+  t = t - (u - 55) * 1;
+  return t + u;
+}
+fun g95(x, y) {
+  var t = x + 87 * y - 4;
+  var u = t * 4.5 - x / 87;
+  t = t + (u - 87) * 4;
+  return t + u;
+}
+fun g96(x, y) {
+  var t = x * 69 * y - 6;
+  var u = t * 6.5 - x / 69;
+  t = t * (u - 69) * 6;
+  return t + u;
+}
+fun g97(x, y) {
+  var t = x + 96 * y - 8;
+  var u = t * 8.5 - x / 96;
+  t = t - (u - 96) * 8;
+  return t + u;
+}
+fun g98(x, y) {
+  var t = x - 83 * y - 9;
+  var u = t * 9.5 - x / 83;
+  t = t + (u - 83) * 9;
+  return t + u;
+}
+fun g99(x, y) {
+  var t = x - 35 * y - 7;
+  var u = t * 7.5 - x / 35;
+  t = t - (u - 35) * 7;
+  return t + u;
+}
+fun g100(x, y) {
+  var t = x - 26 * y - 1;
+  var u = t * 1.5 - x / 26;
+  t = t * (u - 26) * 1;
+  return t + u;
+}
+fun g101(x, y) {
+  var t = x * 80 * y - 2;
+  var u = t * 2.5 - x / 80;
+  t = t - (u - 80) * 2;
+  return t + u;
+}
+fun g102(x, y) {
+  var t = x - 10 * y - 6;
+  var u = t * 6.5 - x / 10;
+  t = t + (u - 10) * 6;
+  return t + u;
+}
+fun g103(x, y) {
+  var t = x + 47 * y - 2;
+  var u = t * 2.5 - x / 47;
+  t = t - (u - 47) * 2;
+  return t + u;
+}
+fun g104(x, y) {
+  var t = x - 9 * y - 5;
+  var u = t * 5.5 - x / 9;
+  t = t * (u - 9) * 5;
+  return t + u;
+}
+fun g105(x, y) {
+  var t = x - 15 * y - 3;
+  var u = t * 3.5 - x / 15;
+  t = t * (u - 15) * 3;
+  return t + u;
+}
+fun g106(x, y) {
+  var t = x * 54 * y - 3;
+  var u = t * 3.5 - x / 54;
+  t = t * (u - 54) * 3;
+  return t + u;
+}
+fun g107(x, y) {
+  var t = x - 18 * y - 4;
+  var u = t * 4.5 - x / 18;
+  t = t + (u - 18) * 4;
+  return t + u;
+}
+fun g108(x, y) {
+  var t = x - 91 * y - 1;
+  var u = t * 1.5 - x / 91;
+  t = t - (u - 91) * 1;
+  return t + u;
+}
+fun g109(x, y) {
+  var t = x * 97 * y - 7;
+  var u = t * 7.5 - x / 97;
+  t = t - (u - 97) * 7;
+  return t + u;
+}
+fun g110(x, y) {
+  var t = x + 69 * y - 4;
+  var u = t * 4.5 - x / 69;
+  t = t + (u - 69) * 4;
+  return t + u;
+}
+fun g111(x, y) {
+  var t = x - 92 * y - 4;
+  var u = t * 4.5 - x / 92;
+  t = t - (u - 92) * 4;
+  return t + u;
+}
+fun g112(x, y) {
+  var t = x - 91 * y - 6;
+  var u = t * 6.5 - x / 91;
+  t = t * (u - 91) * 6;
+  return t + u;
+}
+fun g113(x, y) {
+  var t = x * 84 * y - 4;
+  var u = t * 4.5 - x / 84;
+  t = t - (u - 84) * 4;
+  return t + u;
+}
+fun g114(x, y) {
+  var t = x - 80 * y - 8;
+  var u = t * 8.5 - x / 80;
+  t = t + (u - 80) * 8;
+  return t + u;
+}
+fun g115(x, y) {
+  var t = x * 80 * y - 8;
+  var u = t * 8.5 - x / 80;
+  t = t * (u - 80) * 8;
+  return t + u;
+}
+fun g116(x, y) {
+  var t = x * 36 * y - 7;
+  var u = t * 7.5 - x / 36;
+  t = t * (u - 36) * 7;
+  return t + u;
+}
+fun g117(x, y) {
+  var t = x * 45 * y - 4;
+  var u = t * 4.5 - x / 45;
+  t = t + (u - 45) * 4;
+  return t + u;
+}
+fun g118(x, y) {
+  var t = x * 66 * y - 8;
+  var u = t * 8.5 - x / 66;
+  t = t * (u - 66) * 8;
+  return t + u;
+}
+fun g119(x, y) {
+  var t = x + 36 * y - 9;
+  var u = t * 9.5 - x / 36;
+  t = t + (u - 36) * 9;
+  return t + u;
+}
+var v0 = g0(0, 1) + 566;
+var v1 = g1(1, 2) - 850;
+var v2 = g2(2, 3) * 910;
+var v3 = g3(3, 4) + 287;
+var v4 = g4(4, 5) + 923;
+var v5 = g5(5, 6) * 407;
+var v6 = g6(6, 7) * 405;
+var v7 = g7(7, 1) + 296;
+var v8 = g8(8, 2) + 322;
+var v9 = g9(9, 3) + 353;
+var v10 = g10(10, 4) - 167;
+var v11 = g11(11, 5) + 791;
+var v12 = g12(12, 6) + 746;
+var v13 = g13(13, 7) + 256;
+var v14 = g14(14, 1) + 752;
+var v15 = g15(15, 2) * 881;
+var v16 = g16(16, 3) + 552;
+var v17 = g17(17, 4) - 336;
+var v18 = g18(18, 5) * 818;
+var v19 = g19(19, 6) - 810;
+var v20 = g20(20, 7) + 843;
+var v21 = g21(21, 1) + 557;
+var v22 = g22(22, 2) - 848;
+var v23 = g23(23, 3) * 852;
+var v24 = g24(24, 4) * 375;
+var v25 = g25(25, 5) * 765;
+var v26 = g26(26, 6) * 735;
+var v27 = g27(27, 7) * 57;
+var v28 = g28(28, 1) * 638;
+var v29 = g29(29, 2) * 498;
+var v30 = g30(30, 3) - 775;
+var v31 = g31(31, 4) * 669;
+var v32 = g32(32, 5) + 530;
+var v33 = g33(33, 6) + 305;
+var v34 = g34(34, 7) * 434;
+var v35 = g35(35, 1) - 737;
+var v36 = g36(36, 2) - 183;
+var v37 = g37(37, 3) - 984;
+var v38 = g38(38, 4) + 461;
+var v39 = g39(39, 5) - 815;
+var v40 = g40(40, 6) + 748;
+var v41 = g41(41, 7) - 676;
+var v42 = g42(42, 1) - 347;
+var v43 = g43(43, 2) * 542;
+var v44 = g44(44, 3) + 907;
+var v45 = g45(45, 4) - 840;
+var v46 = g46(46, 5) * 116;
+var v47 = g47(47, 6) * 196;
+var v48 = g48(48, 7) + 653;
+var v49 = g49(49, 1) - 956;
+var v50 = g50(50, 2) + 624;
+var v51 = g51(51, 3) - 51;
+var v52 = g52(52, 4) * 950;
+var v53 = g53(53, 5) - 140;
+var v54 = g54(54, 6) * 550;
+var v55 = g55(55, 7) + 44;
+var v56 = g56(56, 1) * 731;
+var v57 = g57(57, 2) - 830;
+var v58 = g58(58, 3) - 500;
+var v59 = g59(59, 4) - 455;
+var v60 = g60(60, 5) * 470;
+var v61 = g61(61, 6) * 404;
+var v62 = g62(62, 7) - 343;
+var v63 = g63(63, 1) + 481;
+var v64 = g64(64, 2) * 157;
+var v65 = g65(65, 3) - 61;
+var v66 = g66(66, 4) + 241;
+var v67 = g67(67, 5) + 289;
+var v68 = g68(68, 6) + 997;
+var v69 = g69(69, 7) * 498;
+var v70 = g70(70, 1) + 503;
+var v71 = g71(71, 2) * 830;
+var v72 = g72(72, 3) - 530;
+var v73 = g73(73, 4) + 982;
+var v74 = g74(74, 5) * 602;
+var v75 = g75(75, 6) - 415;
+var v76 = g76(76, 7) + 749;
+var v77 = g77(77, 1) + 403;
+var v78 = g78(78, 2) * 848;
+var v79 = g79(79, 3) * 961;
+var v80 = g80(80, 4) * 181;
+var v81 = g81(81, 5) + 177;
+var v82 = g82(82, 6) * 400;
+var v83 = g83(83, 7) - 673;
+var v84 = g84(84, 1) * 747;
+var v85 = g85(85, 2) - 312;
+var v86 = g86(86, 3) - 618;
+var v87 = g87(87, 4) + 277;
+var v88 = g88(88, 5) * 359;
+var v89 = g89(89, 6) - 758;
+var v90 = g90(90, 7) - 59;
+var v91 = g91(91, 1) - 472;
+var v92 = g92(92, 2) - 578;
+var v93 = g93(93, 3) - 817;
+var v94 = g94(94, 4) + 946;
+var v95 = g95(95, 5) - 497;
+var v96 = g96(96, 6) * 184;
+var v97 = g97(97, 7) - 848;
+var v98 = g98(98, 1) + 590;
+var v99 = g99(99, 2) - 143;
+var v100 = g100(100, 3) - 817;
+var v101 = g101(101, 4) * 551;
+var v102 = g102(102, 5) * 238;
+var v103 = g103(103, 6) - 24;
+var v104 = g104(104, 7) - 339;
+var v105 = g105(105, 1) * 188;
+var v106 = g106(106, 2) + 408;
+var v107 = g107(107, 3) + 588;
+var v108 = g108(108, 4) + 434;
+var v109 = g109(109, 5) + 588;
+var v110 = g110(110, 6) + 592;
+var v111 = g111(111, 7) * 87;
+var v112 = g112(112, 1) - 470;
+var v113 = g113(113, 2) * 298;
+var v114 = g114(114, 3) + 848;
+var v115 = g115(115, 4) * 427;
+var v116 = g116(116, 5) + 952;
+var v117 = g117(117, 6) * 250;
+var v118 = g118(118, 7) - 516;
+var v119 = g119(119, 1) * 632;
+var label = "program" + " " + "done";
+var total = [v0, v1, v2, v3] * 2 + [1, 2, 3, 4];
+total[0] + v119
@@ -0,0 +1,18 @@
+// string concatenation, which allocates and keeps the collector
+// busy, 2^13 times.
+var sep = ", ";
+fun glue(a, b) { return a + sep + b; }
+fun s1(x) { return glue(x, "one") + glue("two", x); }
+fun s2(x) { return s1(x) + s1("three"); }
+fun s3(x) { return s2(x) + s2("four"); }
+fun s4(x) { return s3("five") + s3(x); }
+fun s5(x) { return s4(x) + s4("six"); }
+fun s6(x) { return s5("seven") + s5(x); }
+fun s7(x) { return s6(x) + s6("eight"); }
+fun s8(x) { return s7("nine") + s7(x); }
+fun t1(x) { return s8(x) + s8("ten"); }
+fun t2(x) { return t1(x) + t1("eleven"); }
+fun t3(x) { return t2(x) + t2("twelve"); }
+fun t4(x) { return t3(x) + t3("thirteen"); }
+fun t5(x) { return t4(x) + t4("fourteen"); }
+t5("zero")
@@ -0,0 +1,34 @@
+// reads and writes of globals and of locals in nested blocks,
+// resolved to slots, 2^13 times.
+var total = 0;
+var count = 0;
+var scale = 3;
+fun touch(a, b) {
+  var x = a + scale;
+  var y = b * scale;
+  {
+    var z = x + y;
+    x = z - a;
+    {
+      var w = x * 2 + z;
+      y = w - y;
+      total = total + w;
+    }
+  }
+  count = count + 1;
+  total = total - x + y;
+  return total;
+}
+fun v1(x) { return touch(x, x + 1) + touch(x + 2, x - 1); }
+fun v2(x) { return v1(x) + v1(x + 3); }
+fun v3(x) { return v2(x) + v2(x + 3); }
+fun v4(x) { return v3(x) + v3(x + 3); }
+fun v5(x) { return v4(x) + v4(x + 3); }
+fun v6(x) { return v5(x) + v5(x + 3); }
+fun v7(x) { return v6(x) + v6(x + 3); }
+fun v8(x) { return v7(x) + v7(x + 3); }
+fun v9(x) { return v8(x) + v8(x + 3); }
+fun v10(x) { return v9(x) + v9(x + 3); }
+fun v11(x) { return v10(x) + v10(x + 3); }
+fun v12(x) { return v11(x) + v11(x + 3); }
+v12(2) + count
@@ -0,0 +1,150 @@
+// measures the intern table. the table is filled to each of a series
+// of sizes, up to the given number of entries, and at each size the
+// latency of a lookup which finds its string, a hit, and of one which
+// creates it, a miss, is measured. the hit and miss rates of each
+// script of the corpus are then counted, compiling and running it.
+//
+//   voyage_intern_bench [corpus] [--entries n]
+//
+// #NOTE nothing is collected while the table is filled, the heap is
+// never stepped, so every string stays interned.
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "heap.hpp"
+#include "parser.hpp"
+#include "verifier.hpp"
+#include "virtual_machine.hpp"
+
+// the lookups timed at each size, both hits and misses.
+constexpr size_t lookups = 1 << 18;
+
+// the text of the ith string, distinct for each i.
+static std::string key(size_t i) { return std::format("key:{:d}", i); }
+
+template <class F> static double nanosecondsPer(size_t count, F &&work) {
+  auto start = std::chrono::steady_clock::now();
+  work();
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (double)(count);
+}
+
+static void measureTable(size_t entries) {
+  std::cout << std::format("{:>10s} {:>10s} {:>6s} {:>10s} {:>10s}\n",
+                           "entries", "capacity", "load", "hit ns",
+                           "miss ns");
+
+  voyage::Heap heap;
+  std::mt19937 random{1};
+  size_t       size = 0;
+  for (size_t target = 1 << 10; target <= entries; target *= 4) {
+    // grows the table to the target, less the misses measured below.
+    size_t filled = target - std::min(target / 2, lookups);
+    for (; size < filled; ++size) {
+      (void)heap.intern(key(size));
+    }
+
+    // the texts are made before the clock starts, in an order which
+    // visits the table at random.
+    std::vector<std::string> hits(lookups);
+    for (auto &text : hits) {
+      text = key(random() % size);
+    }
+    std::vector<std::string> misses(target - filled);
+    for (size_t i = 0; i < misses.size(); ++i) {
+      misses[i] = key(size + i);
+    }
+
+    double hit = nanosecondsPer(hits.size(), [&] {
+      for (auto const &text : hits) {
+        (void)heap.intern(text);
+      }
+    });
+    double miss = nanosecondsPer(misses.size(), [&] {
+      for (auto const &text : misses) {
+        (void)heap.intern(text);
+      }
+    });
+    size += misses.size();
+
+    auto const &strings = heap.strings();
+    std::cout << std::format(
+        "{:10d} {:10d} {:6.2f} {:10.1f} {:10.1f}\n", strings.size(),
+        strings.capacity(),
+        (double)(strings.size()) / (double)(strings.capacity()), hit, miss);
+  }
+}
+
+static void countCorpus(std::filesystem::path const &corpus) {
+  std::vector<std::filesystem::path> paths;
+  for (auto const &entry : std::filesystem::directory_iterator{corpus}) {
+    if (entry.path().extension() == ".vy") {
+      paths.push_back(entry.path());
+    }
+  }
+  std::ranges::sort(paths);
+
+  std::cout << std::format("\n{:>12s} {:>10s} {:>10s} {:>8s}\n", "script",
+                           "hits", "misses", "hit rate");
+  for (auto const &path : paths) {
+    std::ifstream     file{path, std::ios::binary};
+    std::stringstream source;
+    source << file.rdbuf();
+
+    voyage::VirtualMachine vm;
+    voyage::Parser         parser{vm.heap(), vm.globals(), vm.natives()};
+    auto                   bytecode = parser.parse(source.str());
+    if (!bytecode ||
+        !voyage::verify(*bytecode, vm.globals().size(), vm.natives()) ||
+        !vm.interpret(*bytecode)) {
+      std::cerr << "Unable to run [ " << path.string() << " ]\n";
+      continue;
+    }
+
+    auto const &interning = vm.heap().interning();
+    auto        total     = interning.hits + interning.misses;
+    std::cout << std::format(
+        "{:>12s} {:10d} {:10d} {:7.1f}%\n", path.stem().string(),
+        interning.hits, interning.misses,
+        total == 0 ? 0.0
+                   : 100.0 * (double)(interning.hits) / (double)(total));
+  }
+}
+
+int main(int argc, char **argv) {
+  std::vector<std::string_view> args{argv + 1, argv + argc};
+
+  size_t entries = 1 << 22;
+  if (auto it = std::ranges::find(args, "--entries"); it != args.end()) {
+    auto count = it + 1 != args.end() ? *(it + 1) : std::string_view{};
+    auto [ptr, ec] =
+        std::from_chars(count.data(), count.data() + count.size(), entries);
+    if (ec != std::errc{} || ptr != count.data() + count.size() ||
+        entries < (1 << 10)) {
+      std::cerr << "Invalid entry count [ " << count << " ]\n";
+      return EXIT_FAILURE;
+    }
+    args.erase(it, it + 2);
+  }
+
+  if (args.size() > 1) {
+    std::cerr << "Usage: voyage_intern_bench [corpus] [--entries n]\n";
+    return EXIT_FAILURE;
+  }
+
+  measureTable(entries);
+  if (!args.empty()) {
+    countCorpus(std::filesystem::path{args[0]});
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,684 @@
+// the performance regression gate. it runs a fixed corpus of scripts
+// through the scanner, the parser and the virtual machine, measures
+// each, and compares the measurements with a baseline recorded
+// earlier, failing when any metric regressed beyond its tolerance.
+//
+//   voyage_perf <corpus> <baseline> [--write [--portable]] [--repeat n]
+//
+// corpus is a directory of scripts, and baseline a json file. with
+// --write the measurements are recorded as the new baseline, keeping
+// the tolerance of each metric already in it, rather than compared.
+//
+// the gate fails only on metrics which do not depend on the machine,
+// the counts of instructions, bytecode or retired, the memory and the
+// interning. the times, as throughputs, only fail the gate against a
+// baseline written on the same host, elsewhere they are reported for
+// information. a baseline written with --portable records no host,
+// as one shared between machines.
+//
+// #NOTE wherever the processor exposes it, the count of instructions
+// it retires is measured beside the time, as it hardly depends on the
+// machine or its load. the count of bytecode instructions executed,
+// and the memory accounted, do not depend on the machine at all.
+// the times are the best of each repetition.
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "memory.hpp"
+#include "parser.hpp"
+#include "scanner.hpp"
+#include "verifier.hpp"
+#include "virtual_machine.hpp"
+
+// the exit status by which ctest recognizes a skipped test.
+constexpr int exit_skipped = 77;
+
+// the corpus is scanned, and parsed, this many times per sample, so
+// that a sample takes long enough to time.
+constexpr size_t scan_rounds  = 200;
+constexpr size_t parse_rounds = 20;
+
+// counts the instructions the processor retires in user space, when
+// the kernel exposes the counter, which many virtual machines do not.
+class Counter {
+private:
+  int m_fd = -1;
+
+public:
+  Counter() noexcept {
+#if defined(__linux__)
+    perf_event_attr attr{};
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    m_fd = (int)(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+  Counter(Counter const &)            = delete;
+  Counter &operator=(Counter const &) = delete;
+  ~Counter() {
+#if defined(__linux__)
+    if (m_fd >= 0) {
+      close(m_fd);
+    }
+#endif
+  }
+
+  [[nodiscard]] bool available() const noexcept { return m_fd >= 0; }
+
+  void start() noexcept {
+#if defined(__linux__)
+    if (m_fd >= 0) {
+      ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  voyage::u64 stop() noexcept {
+    voyage::u64 count = 0;
+#if defined(__linux__)
+    if (m_fd >= 0) {
+      ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(m_fd, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+      }
+    }
+#endif
+    return count;
+  }
+};
+
+// what one piece of work cost.
+struct Sample {
+  double      seconds      = 0;
+  voyage::u64 instructions = 0;
+
+  Sample &operator+=(Sample const &other) noexcept {
+    seconds      += other.seconds;
+    instructions += other.instructions;
+    return *this;
+  }
+
+  // the cheaper of both, measure by measure.
+  static Sample best(Sample const &a, Sample const &b) noexcept {
+    return {std::min(a.seconds, b.seconds),
+            std::min(a.instructions, b.instructions)};
+  }
+};
+
+template <class F> static Sample measure(Counter &counter, F &&work) {
+  auto start = std::chrono::steady_clock::now();
+  counter.start();
+  work();
+  auto instructions = counter.stop();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return {elapsed.count(), instructions};
+}
+
+struct Script {
+  std::string name;
+  std::string source;
+  size_t      tokens = 0;
+  // the bytecode instructions executed by a run of the script.
+  size_t      executed = 0;
+};
+
+enum class Better { Higher, Lower };
+
+struct Metric {
+  double value     = 0;
+  Better better    = Better::Higher;
+  double tolerance = 0;
+};
+
+using Metrics = std::map<std::string, Metric>;
+
+// the metrics, and the host they were measured on.
+struct Baseline {
+  std::string host;
+  Metrics     metrics;
+};
+
+// true when the metric measures the same on any machine. the count
+// of instructions the processor retires varies a little with the
+// processor, but far less than time.
+static bool isPortable(std::string_view name) {
+  return name.ends_with(".instructions") || name.starts_with("memory.") ||
+         name.starts_with("intern.") || name.contains("cpu_instructions");
+}
+
+static std::string hostName() {
+#if defined(__linux__)
+  char name[256] = {};
+  if (::gethostname(name, sizeof(name) - 1) == 0) {
+    return name;
+  }
+#endif
+  return {};
+}
+
+// the tolerance of a metric which is not yet in the baseline. time
+// varies between runs, and more so between machines, while the count
+// of bytecode instructions only changes with the compiler.
+static double defaultTolerance(std::string_view name) {
+  if (name.ends_with("_per_second")) {
+    return 0.30;
+  }
+  if (name.starts_with("memory.")) {
+    return 0.10;
+  }
+  if (name.ends_with(".instructions")) {
+    return 0.0;
+  }
+  return 0.05;
+}
+
+static std::optional<std::string> readFile(std::filesystem::path const &path) {
+  std::ifstream file{path, std::ios::binary};
+  if (!file.is_open()) {
+    return std::nullopt;
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  return buffer.str();
+}
+
+static size_t scan(std::string const &source) {
+  voyage::Scanner scanner;
+  scanner.set(source);
+  size_t tokens = 0;
+  while (scanner.scan().kind != voyage::Token::END) {
+    tokens++;
+  }
+  return tokens;
+}
+
+// compiles a script in the given virtual machine, ready to run.
+static std::optional<voyage::Bytecode> compile(voyage::VirtualMachine &vm,
+                                               std::string const &source) {
+  voyage::Parser parser{vm.heap(), vm.globals(), vm.natives()};
+  auto           bytecode = parser.parse(source);
+  if (!bytecode ||
+      !voyage::verify(*bytecode, vm.globals().size(), vm.natives())) {
+    return std::nullopt;
+  }
+  return bytecode;
+}
+
+// runs the script as a task, to count the instructions it executes.
+static std::optional<size_t> count(Script const &script) {
+  voyage::VirtualMachine vm;
+  auto                   bytecode = compile(vm, script.source);
+  if (!bytecode) {
+    return std::nullopt;
+  }
+  voyage::VirtualMachine::Task task{vm};
+  vm.start(task, *bytecode);
+  auto outcome = vm.run(task, {});
+  if (!outcome || !*outcome) {
+    return std::nullopt;
+  }
+  return task.executed();
+}
+
+// the scripts of the corpus, in the order of their names.
+static std::optional<std::vector<Script>>
+load(std::filesystem::path const &corpus) {
+  std::vector<std::filesystem::path> paths;
+  std::error_code                    error;
+  for (auto const &entry :
+       std::filesystem::directory_iterator{corpus, error}) {
+    if (entry.path().extension() == ".vy") {
+      paths.push_back(entry.path());
+    }
+  }
+  if (error || paths.empty()) {
+    std::cerr << "Unable to read corpus [ " << corpus.string() << " ]\n";
+    return std::nullopt;
+  }
+  std::ranges::sort(paths);
+
+  std::vector<Script> scripts;
+  for (auto const &path : paths) {
+    auto source = readFile(path);
+    if (!source) {
+      std::cerr << "Unable to read [ " << path.string() << " ]\n";
+      return std::nullopt;
+    }
+    Script script{path.stem().string(), std::move(*source)};
+    script.tokens = scan(script.source);
+    auto executed = count(script);
+    if (!executed) {
+      std::cerr << "Unable to run [ " << path.string() << " ]\n";
+      return std::nullopt;
+    }
+    script.executed = *executed;
+    scripts.push_back(std::move(script));
+  }
+  return scripts;
+}
+
+// measures the corpus, the best of the given number of repetitions.
+static std::optional<Metrics> measureCorpus(std::vector<Script> const &scripts,
+                                            size_t repeat) {
+  Counter counter;
+  Metrics metrics;
+  auto    record = [&](std::string name, double value, Better better) {
+    metrics[name] = {value, better, defaultTolerance(name)};
+  };
+
+  // memory is measured first, running a script at a time, before
+  // several virtual machines are alive at once, as the peak of the
+  // process only grows. the strings each script interns, compiling
+  // and running, are counted as it runs.
+  voyage::Heap::Interning interning;
+  for (auto const &script : scripts) {
+    voyage::VirtualMachine vm;
+    auto                   bytecode = compile(vm, script.source);
+    if (!bytecode || !vm.interpret(*bytecode)) {
+      std::cerr << "Unable to run [ " << script.name << " ]\n";
+      return std::nullopt;
+    }
+    interning.hits   += vm.heap().interning().hits;
+    interning.misses += vm.heap().interning().misses;
+  }
+  voyage::u64 peak = 0;
+  for (auto const &counters : voyage::memoryStats()) {
+    peak += counters.peak;
+  }
+  record("memory.peak_bytes", (double)(peak), Better::Lower);
+  record("intern.hit_rate",
+         (double)(interning.hits) /
+             (double)(std::max<voyage::u64>(
+                 interning.hits + interning.misses, 1)),
+         Better::Higher);
+
+  size_t tokens = 0;
+  for (auto const &script : scripts) {
+    tokens += script.tokens;
+  }
+
+  std::optional<Sample> scanning;
+  for (size_t i = 0; i < repeat; ++i) {
+    size_t seen   = 0;
+    auto   sample = measure(counter, [&] {
+      for (size_t round = 0; round < scan_rounds; ++round) {
+        for (auto const &script : scripts) {
+          seen += scan(script.source);
+        }
+      }
+    });
+    if (seen != tokens * scan_rounds) {
+      std::cerr << "The corpus scanned differently\n";
+      return std::nullopt;
+    }
+    scanning = scanning ? Sample::best(*scanning, sample) : sample;
+  }
+
+  std::optional<Sample> parsing;
+  for (size_t i = 0; i < repeat; ++i) {
+    Sample sample;
+    for (size_t round = 0; round < parse_rounds; ++round) {
+      // each script is parsed by a fresh virtual machine, which is
+      // made before the clock starts.
+      std::vector<voyage::VirtualMachine> vms(scripts.size());
+      sample += measure(counter, [&] {
+        for (size_t j = 0; j < scripts.size(); ++j) {
+          voyage::Parser parser{vms[j].heap(), vms[j].globals(),
+                                vms[j].natives()};
+          (void)parser.parse(scripts[j].source);
+        }
+      });
+    }
+    parsing = parsing ? Sample::best(*parsing, sample) : sample;
+  }
+
+  double scanned = (double)(tokens * scan_rounds);
+  double parsed  = (double)(tokens * parse_rounds);
+  record("scan.tokens_per_second", scanned / scanning->seconds,
+         Better::Higher);
+  record("parse.tokens_per_second", parsed / parsing->seconds,
+         Better::Higher);
+  if (counter.available()) {
+    record("scan.cpu_instructions_per_token",
+           (double)(scanning->instructions) / scanned, Better::Lower);
+    record("parse.cpu_instructions_per_token",
+           (double)(parsing->instructions) / parsed, Better::Lower);
+  }
+
+  for (auto const &script : scripts) {
+    std::optional<Sample> running;
+    for (size_t i = 0; i < repeat; ++i) {
+      voyage::VirtualMachine vm;
+      auto                   bytecode = compile(vm, script.source);
+      bool                   failed   = !bytecode;
+      auto sample = measure(counter, [&] {
+        failed = failed || !vm.interpret(*bytecode);
+      });
+      if (failed) {
+        std::cerr << "Unable to run [ " << script.name << " ]\n";
+        return std::nullopt;
+      }
+      running = running ? Sample::best(*running, sample) : sample;
+    }
+
+    auto   prefix   = std::format("run.{}.", script.name);
+    double executed = (double)(script.executed);
+    record(prefix + "instructions", executed, Better::Lower);
+    record(prefix + "instructions_per_second", executed / running->seconds,
+           Better::Higher);
+    if (counter.available()) {
+      record(prefix + "cpu_instructions_per_instruction",
+             (double)(running->instructions) / executed, Better::Lower);
+    }
+  }
+  return metrics;
+}
+
+// reads as much json as a baseline holds, objects, strings and
+// numbers, where a string holds no escapes.
+class Json {
+private:
+  std::string_view m_text;
+
+  void skip() {
+    while (!m_text.empty() && std::isspace((unsigned char)(m_text[0]))) {
+      m_text.remove_prefix(1);
+    }
+  }
+
+public:
+  explicit Json(std::string_view text) noexcept : m_text(text) {}
+
+  bool consume(char c) {
+    skip();
+    if (m_text.empty() || m_text[0] != c) {
+      return false;
+    }
+    m_text.remove_prefix(1);
+    return true;
+  }
+
+  bool done() {
+    skip();
+    return m_text.empty();
+  }
+
+  std::optional<std::string> string() {
+    if (!consume('"')) {
+      return std::nullopt;
+    }
+    auto end = m_text.find('"');
+    if (end == std::string_view::npos) {
+      return std::nullopt;
+    }
+    std::string text{m_text.substr(0, end)};
+    m_text.remove_prefix(end + 1);
+    return text;
+  }
+
+  std::optional<double> number() {
+    skip();
+    double value = 0;
+    auto [ptr, ec] =
+        std::from_chars(m_text.data(), m_text.data() + m_text.size(), value);
+    if (ec != std::errc{}) {
+      return std::nullopt;
+    }
+    m_text.remove_prefix((size_t)(ptr - m_text.data()));
+    return value;
+  }
+
+  // reads an object, calling member with the key of each member, to
+  // read its value.
+  template <class F> bool object(F &&member) {
+    if (!consume('{')) {
+      return false;
+    }
+    if (consume('}')) {
+      return true;
+    }
+    do {
+      auto key = string();
+      if (!key || !consume(':') || !member(*key)) {
+        return false;
+      }
+    } while (consume(','));
+    return consume('}');
+  }
+};
+
+static std::optional<Baseline> readBaseline(std::string_view text) {
+  Json     json{text};
+  Baseline baseline;
+  Metrics &metrics = baseline.metrics;
+  auto    metric = [&](std::string const &name) {
+    Metric value;
+    bool   ok = json.object([&](std::string const &key) {
+      if (key == "better") {
+        auto better = json.string();
+        if (!better || (*better != "higher" && *better != "lower")) {
+          return false;
+        }
+        value.better = *better == "higher" ? Better::Higher : Better::Lower;
+        return true;
+      }
+      auto number = json.number();
+      if (!number) {
+        return false;
+      }
+      if (key == "value") {
+        value.value = *number;
+      } else if (key == "tolerance") {
+        value.tolerance = *number;
+      }
+      return true;
+    });
+    metrics[name] = value;
+    return ok;
+  };
+  bool ok = json.object([&](std::string const &key) {
+    if (key == "host") {
+      auto host     = json.string();
+      baseline.host = host.value_or("");
+      return host.has_value();
+    }
+    return key == "metrics" && json.object(metric);
+  });
+  if (!ok || !json.done()) {
+    return std::nullopt;
+  }
+  return baseline;
+}
+
+static bool isCount(double value) {
+  return value == std::floor(value) && std::abs(value) < 0x1p53;
+}
+
+// a count exactly, as its tolerance may be none, anything else to
+// the precision of a double.
+static std::string number(double value) {
+  return isCount(value) ? std::format("{}", (long long)(value))
+                        : std::format("{}", value);
+}
+
+// a count exactly, anything else to six digits.
+static std::string shown(double value) {
+  return isCount(value) ? std::format("{}", (long long)(value))
+                        : std::format("{:.6g}", value);
+}
+
+static std::string writeBaseline(std::string const &host,
+                                 Metrics const     &metrics) {
+  std::string out =
+      std::format("{{\n  \"host\": \"{}\",\n  \"metrics\": {{\n", host);
+  size_t      i   = 0;
+  for (auto const &[name, metric] : metrics) {
+    out += std::format(
+        "    \"{}\": {{\"value\": {}, \"better\": \"{}\", "
+        "\"tolerance\": {}}}{}\n",
+        name, number(metric.value),
+        metric.better == Better::Higher ? "higher" : "lower",
+        metric.tolerance, ++i < metrics.size() ? "," : "");
+  }
+  out += "  }\n}\n";
+  return out;
+}
+
+// prints the difference of each metric from the baseline, returning
+// true when none regressed beyond its tolerance. a metric which
+// depends on the machine is only informational, unless local.
+static bool compare(std::ostream &out, Metrics const &baseline,
+                    Metrics const &measured, bool local) {
+  out << std::format("{:<48s} {:>14s} {:>14s} {:>9s} {:>9s}  {}\n", "metric",
+                     "baseline", "measured", "change", "tolerance",
+                     "status");
+  bool passed = true;
+  auto row    = [&](std::string const &name, std::string baseline_value,
+                 std::string measured_value, std::string change,
+                 std::string tolerance, std::string_view status) {
+    out << std::format("{:<48s} {:>14s} {:>14s} {:>9s} {:>9s}  {}\n", name,
+                       baseline_value, measured_value, change, tolerance,
+                       status);
+  };
+
+  for (auto const &[name, expected] : baseline) {
+    auto found = measured.find(name);
+    if (found == measured.end()) {
+      // counters of the processor may not be available here.
+      row(name, shown(expected.value), "-", "-", "-", "skipped");
+      continue;
+    }
+    double actual = found->second.value;
+    double change = expected.value == 0 ? 0 : actual / expected.value - 1;
+    // positive when the metric got worse.
+    double worse  = expected.better == Better::Higher ? -change : change;
+
+    std::string_view status = "ok";
+    if (!local && !isPortable(name)) {
+      status = "info";
+    } else if (worse > expected.tolerance) {
+      status = "REGRESSED";
+      passed = false;
+    } else if (-worse > expected.tolerance) {
+      status = "improved";
+    }
+    row(name, shown(expected.value), shown(actual),
+        std::format("{}{:.1f}%", change > 0 ? "+" : "", change * 100),
+        std::format("{:.1f}%", expected.tolerance * 100), status);
+  }
+  for (auto const &[name, metric] : measured) {
+    if (!baseline.contains(name)) {
+      row(name, "-", shown(metric.value), "-", "-", "new");
+    }
+  }
+  return passed;
+}
+
+int main(int argc, char **argv) {
+  std::vector<std::string_view> args{argv + 1, argv + argc};
+  bool write    = std::erase(args, "--write") != 0;
+  bool portable = std::erase(args, "--portable") != 0;
+
+  size_t repeat = 7;
+  if (auto it = std::ranges::find(args, "--repeat"); it != args.end()) {
+    auto count = it + 1 != args.end() ? *(it + 1) : std::string_view{};
+    auto [ptr, ec] =
+        std::from_chars(count.data(), count.data() + count.size(), repeat);
+    if (ec != std::errc{} || ptr != count.data() + count.size() ||
+        repeat == 0) {
+      std::cerr << "Invalid repeat count [ " << count << " ]\n";
+      return EXIT_FAILURE;
+    }
+    args.erase(it, it + 2);
+  }
+
+  if (args.size() != 2 || (portable && !write)) {
+    std::cerr << "Usage: voyage_perf <corpus> <baseline> [--write "
+                 "[--portable]] [--repeat n]\n";
+    return EXIT_FAILURE;
+  }
+
+  // #NOTE a debug build traces every instruction, its measurements
+  // say nothing of a release build, which the baseline is of.
+  if constexpr (voyage::debug) {
+    std::cout << "skipped, the gate only measures release builds\n";
+    return exit_skipped;
+  }
+
+  std::filesystem::path baseline_path{args[1]};
+  std::optional<Baseline> baseline;
+  if (auto text = readFile(baseline_path)) {
+    baseline = readBaseline(*text);
+    if (!baseline) {
+      std::cerr << "Invalid baseline [ " << baseline_path.string() << " ]\n";
+      return EXIT_FAILURE;
+    }
+  } else if (!write) {
+    std::cerr << "Unable to read baseline [ " << baseline_path.string()
+              << " ]\n";
+    return EXIT_FAILURE;
+  }
+
+  auto scripts = load(std::filesystem::path{args[0]});
+  if (!scripts) {
+    return EXIT_FAILURE;
+  }
+  auto measured = measureCorpus(*scripts, repeat);
+  if (!measured) {
+    return EXIT_FAILURE;
+  }
+
+  if (write) {
+    if (baseline) {
+      for (auto &[name, metric] : *measured) {
+        if (auto found = baseline->metrics.find(name);
+            found != baseline->metrics.end()) {
+          metric.tolerance = found->second.tolerance;
+        }
+      }
+    }
+    std::ofstream out{baseline_path};
+    out << writeBaseline(portable ? std::string{} : hostName(), *measured);
+    if (!out.good()) {
+      std::cerr << "Unable to write baseline [ " << baseline_path.string()
+                << " ]\n";
+      return EXIT_FAILURE;
+    }
+    compare(std::cout, *measured, *measured, !portable);
+    return EXIT_SUCCESS;
+  }
+
+  // #NOTE a baseline without a host is never local.
+  bool local = !baseline->host.empty() && baseline->host == hostName();
+  if (!local) {
+    std::cout << "the baseline is of another host, times are information "
+                 "only\n";
+  }
+  return compare(std::cout, baseline->metrics, *measured, local)
+             ? EXIT_SUCCESS
+             : EXIT_FAILURE;
+}
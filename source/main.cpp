@@ -1,12 +1,32 @@
+#include <algorithm>
 #include <array>
+#include <charconv>
+#include <cstdio>
+#include <deque>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <thread>
+#include <vector>
 
+#include "aot.hpp"
+#include "compile_cache.hpp"
+#include "memory.hpp"
+#include "output.hpp"
 #include "parser.hpp"
+#include "profile.hpp"
+#include "server.hpp"
+#include "verifier.hpp"
 #include "virtual_machine.hpp"
+#include "work_queue.hpp"
 
 static void repl(voyage::VirtualMachine &vm) {
-  voyage::Parser parser;
+  voyage::Parser parser{vm.heap(), vm.globals(), vm.natives()};
+  parser.optimizeWith(vm.optimizer());
   std::string    line;
   while (true) {
     std::cout << "> ";
@@ -23,11 +43,24 @@ static void repl(voyage::VirtualMachine &vm) {
       line.clear();
       continue;
     }
-    auto &bytecode         = parse_result.value();
-    auto  interpret_result = vm.interpret(bytecode);
+    auto &bytecode      = parse_result.value();
+    auto  verify_result =
+        voyage::verify(bytecode, vm.globals().size(), vm.natives());
+    if (!verify_result) {
+      std::cerr << verify_result.error() << "\n";
+      line.clear();
+      continue;
+    }
+
+    auto interpret_result = vm.interpret(bytecode);
     if (!interpret_result) {
       auto &error = interpret_result.error();
       std::cerr << "Interpreter Error: " << error << "\n";
+      line.clear();
+      continue;
+    }
+    if constexpr (voyage::debug_print) {
+      std::cout << bytecode.feedback();
     }
     auto &value = interpret_result.value();
     std::cout << "-> " << value << "\n";
@@ -42,42 +75,479 @@ static std::string readFile(std::string_view path) {
     std::exit(EXIT_FAILURE);
   }
 
-  file.seekg(std::ios_base::end);
-  size_t length = file.tellg();
-  file.seekg(std::ios_base::beg);
-  std::string buffer;
-  buffer.reserve(length + 1);
+  file.seekg(0, std::ios_base::end);
+  auto length = (size_t)(file.tellg());
+  file.seekg(0, std::ios_base::beg);
+  std::string buffer(length, '\0');
 
-  file.read(buffer.data(), length);
+  file.read(buffer.data(), (std::streamsize)(length));
   return buffer;
 }
 
-static void script(voyage::VirtualMachine &vm, std::string_view file) {
-  voyage::Parser parser;
-  auto           source       = readFile(file);
-  auto           parse_result = parser.parse(source);
-  if (!parse_result) {
+// the profile a script is compiled by, and the file its own
+// profile is written to, when they are given.
+struct ProfileOptions {
+  std::string_view use;
+  std::string_view write;
+};
+
+// the snapshot the state is restored from before the mode runs, and
+// the file the state is written to once it finishes, when given.
+struct SnapshotOptions {
+  std::string_view restore;
+  std::string_view write;
+};
+
+// whether chunks are optimized as they are compiled, and whether
+// the optimizer reports what it did when the mode finishes.
+struct OptimizeOptions {
+  bool enabled    = false;
+  bool statistics = false;
+};
+
+static void script(voyage::VirtualMachine &vm, std::string_view file,
+                   ProfileOptions const &profiling) {
+  auto source = readFile(file);
+
+  std::optional<voyage::Profile> guide;
+  if (!profiling.use.empty()) {
+    guide = voyage::Profile::read(readFile(profiling.use));
+    if (!guide) {
+      std::cerr << "Invalid profile [ " << profiling.use << " ]\n";
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  // #NOTE artifacts are keyed by their source alone, so a script
+  // compiled by a profile, or optimized, bypasses the cache.
+  auto cache = guide || vm.optimizer() != nullptr
+                   ? std::nullopt
+                   : voyage::CompileCache::fromEnvironment();
+
+  std::optional<voyage::Bytecode> loaded;
+  if (cache) {
+    loaded = cache->load(source, vm.heap(), vm.globals(), vm.natives());
+  }
+  bool cached = loaded.has_value();
+  if (!cached) {
+    voyage::Parser parser{vm.heap(), vm.globals(), vm.natives()};
+    parser.guide(guide ? &*guide : nullptr);
+    parser.optimizeWith(vm.optimizer());
+    auto parse_result = parser.parse(source);
+    if (!parse_result) {
+      std::exit(EXIT_FAILURE);
+    }
+    loaded = std::move(parse_result.value());
+  }
+  auto &bytecode = *loaded;
+
+  auto verify_result =
+      voyage::verify(bytecode, vm.globals().size(), vm.natives());
+  if (!verify_result) {
+    std::cerr << verify_result.error() << "\n";
     std::exit(EXIT_FAILURE);
   }
-  auto &bytecode = parse_result.value();
+
+  if (cache) {
+    // #NOTE the chunk is stored before it runs, running it
+    // rewrites instructions and compiles deferred functions.
+    if (!cached) {
+      cache->store(source, bytecode, vm.globals(), vm.natives());
+    }
+    if (std::getenv("VOYAGE_CACHE_STATS") != nullptr) {
+      std::cerr << cache->statistics();
+    }
+  }
 
   auto interpret_result = vm.interpret(bytecode);
   if (!interpret_result) {
     std::cerr << interpret_result.error() << "\n";
     std::exit(EXIT_FAILURE);
   }
+  if constexpr (voyage::debug_print) {
+    std::cout << bytecode.feedback();
+  }
+
+  if (!profiling.write.empty()) {
+    voyage::Profile profile;
+    profile.record(bytecode);
+    std::ofstream out{std::string{profiling.write}};
+    out << profile.write();
+    if (!out.good()) {
+      std::cerr << "Unable to write profile [ " << profiling.write << " ]\n";
+      std::exit(EXIT_FAILURE);
+    }
+  }
 }
 
-int main(int argc, char *argv[]) {
+// translates the script into C, which builds into a native program.
+static int compileAhead(voyage::VirtualMachine &vm, std::string_view file,
+                        std::string_view out) {
+  auto source = readFile(file);
+
+  voyage::Parser parser{vm.heap(), vm.globals(), vm.natives()};
+  parser.optimizeWith(vm.optimizer());
+  auto parse_result = parser.parse(source);
+  if (!parse_result) {
+    return EXIT_FAILURE;
+  }
+
+  auto translated = voyage::translateToC(*parse_result, vm.heap(),
+                                         vm.globals(), vm.natives(),
+                                         vm.optimizer());
+  if (!translated) {
+    std::cerr << translated.error() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  std::ofstream output{std::string{out}};
+  output << *translated;
+  if (!output.good()) {
+    std::cerr << "Unable to write file [ " << out << " ]\n";
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+// runs a native program, writing its result as batch mode would.
+static int runAhead(voyage::VirtualMachine &vm, std::string_view path) {
+  auto program = voyage::NativeProgram::load(std::string{path}, vm);
+  if (!program) {
+    std::cerr << program.error() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  auto run_result = program->run();
+  if (!run_result) {
+    std::cerr << run_result.error() << "\n";
+    return EXIT_FAILURE;
+  }
+  std::string out;
+  voyage::appendValue(out, run_result.value(), voyage::RealFormat::Shortest);
+  std::cout << out << "\n";
+  return EXIT_SUCCESS;
+}
+
+// a block of complete lines read by batch mode, each of which is
+// terminated by '\0' in place of its newline, and the lines are
+// parsed in place.
+struct BatchJob {
+  std::string               text;
+  std::promise<std::string> output;
+};
+
+// appends the text of an error to the output of a block.
+template <class E> static void appendError(std::string &out, E const &error) {
+  std::ostringstream text;
+  text << "error: " << error << "\n";
+  out.append(std::move(text).str());
+}
+
+static void evaluateLine(voyage::VirtualMachine &vm, voyage::Parser &parser,
+                         std::string_view line, voyage::RealFormat format,
+                         std::string &out) {
+  if (line.find_first_not_of(" \t\r") == std::string_view::npos) {
+    out.push_back('\n');
+    return;
+  }
+
+  auto parse_result = parser.parse(line);
+  if (!parse_result) {
+    if (auto const &failure = parser.firstError()) {
+      appendError(out, *failure);
+    } else {
+      out.append("error\n");
+    }
+    return;
+  }
+  auto &bytecode = parse_result.value();
+
+  auto verify_result =
+      voyage::verify(bytecode, vm.globals().size(), vm.natives());
+  if (!verify_result) {
+    appendError(out, verify_result.error());
+    return;
+  }
+
+  auto interpret_result = vm.interpret(bytecode);
+  if (!interpret_result) {
+    appendError(out, interpret_result.error());
+    return;
+  }
+  voyage::appendValue(out, interpret_result.value(), format);
+  out.push_back('\n');
+}
+
+static std::string evaluateBlock(voyage::VirtualMachine &vm,
+                                 voyage::Parser         &parser,
+                                 std::string const      &text,
+                                 voyage::RealFormat      format) {
+  std::string out;
+  size_t      begin = 0;
+  while (begin < text.size()) {
+    size_t end = text.find('\0', begin);
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+    // #NOTE every line begins with no globals, so that no line
+    // sees what another declared, whichever worker evaluates it.
+    vm.globals().truncate(0);
+    evaluateLine(vm, parser, std::string_view{text}.substr(begin, end - begin),
+                 format, out);
+    begin = end + 1;
+  }
+  return out;
+}
+
+// evaluates each line of stdin as an independent program, across a
+// pool of workers, each with its own virtual machine. the results
+// are written in input order, one line per input line.
+//
+// #NOTE lines are self contained. the globals of a worker are reset
+// before each line, rather than each block, so a global declared by
+// one line is never visible to another, and the result of a line
+// does not depend on the worker or block it is evaluated in.
+static void batch(unsigned threads, voyage::RealFormat format,
+                  OptimizeOptions const &optimizing) {
+  static constexpr size_t block_size = 256 * 1024;
+
+  voyage::WorkQueue<BatchJob>   queue;
+  std::vector<std::jthread>     workers;
+  std::mutex                    statistics_mutex;
+  voyage::Optimizer::Statistics statistics;
+  for (unsigned i = 0; i < threads; ++i) {
+    workers.emplace_back([&, format]() {
+      voyage::VirtualMachine vm;
+      if (optimizing.enabled) {
+        vm.optimize();
+      }
+      // #NOTE errors are written to the output of their line only.
+      voyage::Parser parser{vm.heap(), vm.globals(), vm.natives()};
+      parser.optimizeWith(vm.optimizer());
+      parser.quieten(true);
+      while (auto job = queue.pop()) {
+        job->output.set_value(evaluateBlock(vm, parser, job->text, format));
+      }
+
+      if (auto const *optimizer = vm.optimizer()) {
+        std::lock_guard lock{statistics_mutex};
+        statistics += optimizer->statistics();
+      }
+    });
+  }
+
+  voyage::Output output{STDOUT_FILENO, format};
+
+  // the outputs of submitted blocks, in input order. at most a few
+  // blocks per worker are in flight, which bounds memory use.
+  std::deque<std::future<std::string>> pending;
+  auto write_front = [&]() {
+    output.write(pending.front().get());
+    pending.pop_front();
+  };
+  auto submit = [&](std::string text) {
+    std::replace(text.begin(), text.end(), '\n', '\0');
+    BatchJob job{std::move(text), {}};
+    pending.push_back(job.output.get_future());
+    queue.push(std::move(job));
+
+    while (pending.size() > (size_t)(threads) * 4) {
+      write_front();
+    }
+    while (!pending.empty() &&
+           pending.front().wait_for(std::chrono::seconds{0}) ==
+               std::future_status::ready) {
+      write_front();
+    }
+  };
+
+  std::vector<char> input(block_size);
+  std::string       partial;
+  while (true) {
+    size_t count = std::fread(input.data(), 1, input.size(), stdin);
+    if (count == 0) {
+      break;
+    }
+
+    std::string_view read{input.data(), count};
+    size_t           last = read.rfind('\n');
+    if (last == std::string_view::npos) {
+      partial.append(read);
+      continue;
+    }
+
+    std::string text = std::move(partial);
+    text.append(read.substr(0, last + 1));
+    partial.assign(read.substr(last + 1));
+    submit(std::move(text));
+  }
+  if (!partial.empty()) {
+    submit(std::move(partial));
+  }
+
+  queue.close();
+  while (!pending.empty()) {
+    write_front();
+  }
+
+  if (optimizing.statistics) {
+    workers.clear();
+    std::cerr << statistics;
+  }
+}
+
+// writes the state of the virtual machine to a snapshot file.
+static bool writeSnapshot(voyage::VirtualMachine &vm, std::string_view path) {
+  auto snapshot = vm.snapshot();
+  if (!snapshot) {
+    std::cerr << snapshot.error() << "\n";
+    return false;
+  }
+  std::ofstream out{std::string{path}, std::ios::binary};
+  out << *snapshot;
+  if (!out.good()) {
+    std::cerr << "Unable to write snapshot [ " << path << " ]\n";
+    return false;
+  }
+  return true;
+}
+
+// parses a count of threads, or returns nothing when it is invalid.
+static std::optional<unsigned> threadCount(std::string_view count) {
+  unsigned threads = 0;
+  auto [ptr, ec] =
+      std::from_chars(count.data(), count.data() + count.size(), threads);
+  if (ec != std::errc{} || ptr != count.data() + count.size() ||
+      threads == 0) {
+    std::cerr << "Invalid thread count [ " << count << " ]\n";
+    return std::nullopt;
+  }
+  return threads;
+}
+
+// runs the mode selected by the arguments, returning the exit status.
+static int run(std::span<std::string_view const> args,
+               ProfileOptions const             &profiling,
+               OptimizeOptions const            &optimizing,
+               SnapshotOptions const            &snapshots) {
+  unsigned threads = std::max(std::thread::hardware_concurrency(), 1U);
+
+  if (!args.empty() && args[0] == "--batch") {
+    auto format = voyage::RealFormat::Shortest;
+    for (std::string_view arg : args.subspan(1)) {
+      if (arg == "--fixed") {
+        format = voyage::RealFormat::Fixed;
+        continue;
+      }
+      auto count = threadCount(arg);
+      if (!count) {
+        return EXIT_FAILURE;
+      }
+      threads = *count;
+    }
+    batch(threads, format, optimizing);
+    return EXIT_SUCCESS;
+  }
+
+  if (args.size() >= 2 && args[0] == "--serve") {
+    if (args.size() == 3) {
+      auto count = threadCount(args[2]);
+      if (!count) {
+        return EXIT_FAILURE;
+      }
+      threads = *count;
+    }
+    return voyage::serve(args[1], threads);
+  }
+
   voyage::VirtualMachine vm;
+  if (optimizing.enabled) {
+    vm.optimize();
+  }
+  if (!snapshots.restore.empty()) {
+    if (auto restored = vm.restore(std::string{snapshots.restore});
+        !restored) {
+      std::cerr << restored.error() << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (args.size() == 3 && args[0] == "--aot") {
+    return compileAhead(vm, args[2], args[1]);
+  }
+  if (args.size() == 2 && args[0] == "--aot-run") {
+    return runAhead(vm, args[1]);
+  }
 
-  if (argc == 1) {
-    repl(vm);
-  } else if (argc == 2) {
-    script(vm, argv[1]);
+  if (args.size() <= 1) {
+    if (args.empty()) {
+      repl(vm);
+    } else {
+      script(vm, args[0], profiling);
+    }
+    if (!snapshots.write.empty() && !writeSnapshot(vm, snapshots.write)) {
+      return EXIT_FAILURE;
+    }
   } else {
-    std::cerr << "Usage: voyage [path]\n";
+    std::cerr << "Usage: voyage [--mem-stats] [--optimize[-stats]] "
+                 "[--profile <out>] [--profile-use <in>]\n"
+                 "              [--snapshot <out>] [--restore <in>] [path]\n"
+                 "       voyage [--mem-stats] [--optimize[-stats]] --batch "
+                 "[threads] [--fixed]\n"
+                 "       voyage [--mem-stats] --serve <socket> [workers]\n"
+                 "       voyage [--optimize] --aot <out.c> <path>\n"
+                 "       voyage --aot-run <program.so>\n";
   }
 
+  if (optimizing.statistics) {
+    std::cerr << vm.optimizer()->statistics();
+  }
   return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<std::string_view> args{argv + 1, argv + argc};
+
+  // options which apply to every mode are removed before the
+  // mode is chosen.
+  bool mem_stats = std::erase(args, "--mem-stats") != 0;
+
+  OptimizeOptions optimizing;
+  optimizing.statistics = std::erase(args, "--optimize-stats") != 0;
+  optimizing.enabled =
+      std::erase(args, "--optimize") != 0 || optimizing.statistics;
+
+  ProfileOptions profiling;
+  auto           option = [&](std::string_view name, std::string_view &value) {
+    auto found = std::find(args.begin(), args.end(), name);
+    if (found == args.end()) {
+      return true;
+    }
+    if (std::next(found) == args.end()) {
+      std::cerr << "Expected a path after [ " << name << " ]\n";
+      return false;
+    }
+    value = *std::next(found);
+    args.erase(found, std::next(found, 2));
+    return true;
+  };
+  SnapshotOptions snapshots;
+  if (!option("--profile", profiling.write) ||
+      !option("--profile-use", profiling.use) ||
+      !option("--snapshot", snapshots.write) ||
+      !option("--restore", snapshots.restore)) {
+    return EXIT_FAILURE;
+  }
+#if !defined(VOYAGE_PROFILE)
+  if (!profiling.write.empty()) {
+    std::cerr << "--profile requires a build with VOYAGE_PROFILE\n";
+    return EXIT_FAILURE;
+  }
+#endif
+
+  int status = run(args, profiling, optimizing, snapshots);
+  if (mem_stats) {
+    std::cerr << voyage::memoryStats();
+  }
+  return status;
+}
@@ -0,0 +1,632 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <list>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "hash_map.hpp"
+#include "server.hpp"
+#include "voyage.hpp"
+#include "work_queue.hpp"
+
+namespace voyage {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// frames larger than this are rejected, and the connection closed.
+constexpr size_t max_frame = 16 * 1024 * 1024;
+// the number of compiled programs each worker keeps.
+constexpr size_t cache_capacity = 1024;
+
+using Input = std::variant<i64, f64, std::string>;
+
+struct Request {
+  u64                      connection;
+  u64                      sequence;
+  u64                      hash;
+  std::string              source;
+  std::vector<std::string> names;
+  std::vector<Input>       inputs;
+  Clock::time_point        received;
+};
+
+struct Response {
+  u64         connection;
+  u64         sequence;
+  std::string frame;
+};
+
+// reads the fields of a frame, each read fails once the frame
+// is exhausted.
+class Reader {
+private:
+  std::string_view m_data;
+  bool             m_failed = false;
+
+public:
+  explicit Reader(std::string_view data) noexcept : m_data(data) {}
+
+  [[nodiscard]] bool failed() const noexcept { return m_failed; }
+  [[nodiscard]] bool done() const noexcept { return m_data.empty(); }
+
+  u64 integer(size_t bytes) noexcept {
+    if (m_failed || m_data.size() < bytes) {
+      m_failed = true;
+      return 0;
+    }
+    u64 value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+      value = (value << 8) | (u8)(m_data[i]);
+    }
+    m_data.remove_prefix(bytes);
+    return value;
+  }
+
+  std::string_view text(size_t length) noexcept {
+    if (m_failed || m_data.size() < length) {
+      m_failed = true;
+      return {};
+    }
+    auto text = m_data.substr(0, length);
+    m_data.remove_prefix(length);
+    return text;
+  }
+};
+
+void writeInteger(std::string &out, u64 value, size_t bytes) {
+  for (size_t i = bytes; i > 0; --i) {
+    out.push_back((char)((value >> ((i - 1) * 8)) & 0xFF));
+  }
+}
+
+std::string responseFrame(bool ok, std::string_view text) {
+  std::string frame;
+  frame.reserve(sizeof(u32) + 1 + text.size());
+  writeInteger(frame, 1 + text.size(), sizeof(u32));
+  frame.push_back(ok ? 0 : 1);
+  frame.append(text);
+  return frame;
+}
+
+// parses the payload of a request frame, or returns nothing when it
+// is malformed.
+std::optional<Request> parseRequest(std::string_view payload) {
+  Reader  reader{payload};
+  Request request{};
+  request.source = reader.text(reader.integer(sizeof(u32)));
+
+  size_t count = reader.integer(sizeof(u16));
+  for (size_t i = 0; i < count && !reader.failed(); ++i) {
+    request.names.emplace_back(reader.text(reader.integer(sizeof(u16))));
+    switch (reader.integer(sizeof(u8))) {
+    case 0:
+      request.inputs.emplace_back((i64)(reader.integer(sizeof(i64))));
+      break;
+    case 1:
+      request.inputs.emplace_back(
+          std::bit_cast<f64>(reader.integer(sizeof(f64))));
+      break;
+    case 2:
+      request.inputs.emplace_back(
+          std::string{reader.text(reader.integer(sizeof(u32)))});
+      break;
+    default:
+      return std::nullopt;
+    }
+  }
+
+  if (reader.failed() || !reader.done()) {
+    return std::nullopt;
+  }
+
+  request.hash = hashBytes(request.source);
+  for (auto const &name : request.names) {
+    request.hash = (request.hash * 31) ^ hashBytes(name);
+  }
+  return request;
+}
+
+// responses completed by the workers, which wake the event loop
+// through an eventfd.
+class Completions {
+private:
+  std::mutex            m_mutex;
+  std::vector<Response> m_responses;
+  int                   m_event;
+
+public:
+  explicit Completions(int event) noexcept : m_event(event) {}
+
+  void push(Response response) {
+    {
+      std::lock_guard lock{m_mutex};
+      m_responses.push_back(std::move(response));
+    }
+    u64 one = 1;
+    [[maybe_unused]] auto written = ::write(m_event, &one, sizeof(one));
+  }
+
+  std::vector<Response> take() {
+    u64                   count = 0;
+    [[maybe_unused]] auto read  = ::read(m_event, &count, sizeof(count));
+    std::lock_guard       lock{m_mutex};
+    return std::exchange(m_responses, {});
+  }
+};
+
+// a histogram of latencies in nanoseconds, in constant memory. below
+// eight a bucket holds one value, above it each power of two is split
+// into eight buckets, so a percentile read from it is within an eighth
+// of the exact one.
+class Latencies {
+private:
+  static constexpr size_t sub_buckets = 8;
+  static constexpr size_t buckets     = sub_buckets * 62;
+
+  std::array<u64, buckets> m_counts{};
+  u64                      m_count = 0;
+  u64                      m_max   = 0;
+
+  static size_t bucketOf(u64 nanoseconds) noexcept {
+    if (nanoseconds < sub_buckets) {
+      return (size_t)(nanoseconds);
+    }
+    auto exponent = (size_t)(std::bit_width(nanoseconds)) - 4;
+    return sub_buckets * (exponent + 1) +
+           (size_t)(nanoseconds >> exponent) - sub_buckets;
+  }
+
+  // the largest value which falls in the bucket.
+  static u64 upperOf(size_t bucket) noexcept {
+    if (bucket < sub_buckets) {
+      return bucket;
+    }
+    size_t exponent = (bucket / sub_buckets) - 1;
+    u64    lower    = (u64)(sub_buckets + (bucket % sub_buckets)) << exponent;
+    return lower + ((u64{1} << exponent) - 1);
+  }
+
+public:
+  [[nodiscard]] u64 count() const noexcept { return m_count; }
+
+  void record(u64 nanoseconds) noexcept {
+    m_counts[bucketOf(nanoseconds)]++;
+    m_count++;
+    m_max = std::max(m_max, nanoseconds);
+  }
+
+  Latencies &operator+=(Latencies const &other) noexcept {
+    for (size_t i = 0; i < buckets; ++i) {
+      m_counts[i] += other.m_counts[i];
+    }
+    m_count += other.m_count;
+    m_max    = std::max(m_max, other.m_max);
+    return *this;
+  }
+
+  // the latency below which the given fraction of them fall.
+  [[nodiscard]] u64 percentile(double p) const noexcept {
+    auto rank = (u64)(p * (double)(m_count - 1)) + 1;
+    u64  seen = 0;
+    for (size_t i = 0; i < buckets; ++i) {
+      seen += m_counts[i];
+      if (seen >= rank) {
+        return std::min(upperOf(i), m_max);
+      }
+    }
+    return m_max;
+  }
+};
+
+// an engine and the programs it has compiled, least recently used
+// first, each keyed by the hash of its source and input names.
+//
+// #NOTE the engine is isolated, so one request never sees the
+// globals of another, whichever worker either is routed to, and
+// evicting a program releases its globals.
+class Worker {
+private:
+  struct Entry {
+    u64                      hash;
+    std::string              source;
+    std::vector<std::string> names;
+    Program                  program;
+  };
+
+  using Entries = std::list<Entry>;
+
+  Engine                                    m_engine{true};
+  Entries                                   m_entries;
+  std::unordered_multimap<u64, Entries::iterator> m_index;
+
+public:
+  WorkQueue<Request> queue;
+  Latencies          latencies;
+  size_t             hits   = 0;
+  size_t             misses = 0;
+
+  std::expected<Program *, Error> program(Request const &request) {
+    auto [begin, end] = m_index.equal_range(request.hash);
+    for (auto found = begin; found != end; ++found) {
+      Entry &entry = *found->second;
+      if (entry.source == request.source && entry.names == request.names) {
+        m_entries.splice(m_entries.end(), m_entries, found->second);
+        hits++;
+        return &entry.program;
+      }
+    }
+
+    misses++;
+    std::vector<std::string_view> names{request.names.begin(),
+                                        request.names.end()};
+    auto compiled = m_engine.compile(request.source, names);
+    if (!compiled) {
+      return std::unexpected{std::move(compiled.error())};
+    }
+
+    if (m_entries.size() == cache_capacity) {
+      Entry &oldest = m_entries.front();
+      auto [first, last] = m_index.equal_range(oldest.hash);
+      for (auto found = first; found != last; ++found) {
+        if (found->second == m_entries.begin()) {
+          m_index.erase(found);
+          break;
+        }
+      }
+      m_entries.pop_front();
+    }
+
+    m_entries.emplace_back(Entry{request.hash, request.source, request.names,
+                                 std::move(*compiled)});
+    m_index.emplace(request.hash, std::prev(m_entries.end()));
+    return &m_entries.back().program;
+  }
+
+  std::string evaluate(Request const &request) {
+    auto program = this->program(request);
+    if (!program) {
+      std::ostringstream out;
+      out << program.error();
+      return responseFrame(false, out.str());
+    }
+
+    std::vector<Value> inputs;
+    inputs.reserve(request.inputs.size());
+    for (auto const &input : request.inputs) {
+      if (auto *integer = std::get_if<i64>(&input)) {
+        inputs.emplace_back(*integer);
+      } else if (auto *real = std::get_if<f64>(&input)) {
+        inputs.emplace_back(*real);
+      } else {
+        inputs.push_back(m_engine.string(std::get<std::string>(input)));
+      }
+    }
+
+    std::ostringstream out;
+    auto               result = m_engine.evaluate(**program, inputs);
+    if (!result) {
+      out << result.error();
+      return responseFrame(false, out.str());
+    }
+    out << *result;
+    return responseFrame(true, out.str());
+  }
+
+  void run(Completions &completions) {
+    while (auto request = queue.pop()) {
+      std::string frame = evaluate(*request);
+      latencies.record((u64)(std::chrono::duration_cast<
+                                 std::chrono::nanoseconds>(
+                                 Clock::now() - request->received)
+                                 .count()));
+      completions.push(
+          Response{request->connection, request->sequence, std::move(frame)});
+    }
+  }
+};
+
+// a client, whose responses are written in the order of its requests,
+// although they may be completed out of order.
+struct Connection {
+  int                         fd;
+  std::string                 in;
+  std::string                 out;
+  u64                         next_request  = 0;
+  u64                         next_response = 0;
+  std::map<u64, std::string>  ready;
+  bool                        writable      = true;
+
+  explicit Connection(int fd) noexcept : fd(fd) {}
+};
+
+void report(std::vector<std::unique_ptr<Worker>> const &workers) {
+  Latencies latencies;
+  size_t    hits = 0, misses = 0;
+  for (auto const &worker : workers) {
+    latencies += worker->latencies;
+    hits   += worker->hits;
+    misses += worker->misses;
+  }
+
+  std::cerr << std::format("served {:d} requests, cache {:d} hits, {:d} "
+                           "misses\n",
+                           latencies.count(), hits, misses);
+  if (latencies.count() == 0) {
+    return;
+  }
+
+  auto percentile = [&](double p) {
+    return (double)(latencies.percentile(p)) / 1000.0;
+  };
+  std::cerr << std::format("latency us p50 {:.1f} p90 {:.1f} p99 {:.1f} "
+                           "p99.9 {:.1f} max {:.1f}\n",
+                           percentile(0.5), percentile(0.9), percentile(0.99),
+                           percentile(0.999), percentile(1.0));
+}
+} // namespace
+
+int serve(std::string_view path, unsigned count) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    std::cerr << "Socket path too long [ " << path << " ]\n";
+    return EXIT_FAILURE;
+  }
+  std::memcpy(address.sun_path, path.data(), path.size());
+
+  // the signals are only received through the signalfd, which the
+  // workers inherit the blocked mask for.
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  std::signal(SIGPIPE, SIG_IGN);
+
+  int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                          0);
+  ::unlink(std::string{path}.c_str());
+  if (listener < 0 ||
+      ::bind(listener, (sockaddr *)(&address), sizeof(address)) < 0 ||
+      ::listen(listener, SOMAXCONN) < 0) {
+    std::cerr << "Unable to listen on [ " << path
+              << " ]: " << std::strerror(errno) << "\n";
+    return EXIT_FAILURE;
+  }
+
+  int epoll  = ::epoll_create1(EPOLL_CLOEXEC);
+  int event  = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  int signal = ::signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+  // the ids of the event sources, connections are numbered after them.
+  enum : u64 { ListenerId, EventId, SignalId, FirstConnection };
+  auto watch = [&](int fd, u64 id, u32 events) {
+    epoll_event interest{};
+    interest.events   = events;
+    interest.data.u64 = id;
+    ::epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &interest);
+  };
+  watch(listener, ListenerId, EPOLLIN);
+  watch(event, EventId, EPOLLIN);
+  watch(signal, SignalId, EPOLLIN);
+
+  Completions                          completions{event};
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::jthread>            threads;
+  for (unsigned i = 0; i < count; ++i) {
+    workers.push_back(std::make_unique<Worker>());
+  }
+  for (auto &worker : workers) {
+    threads.emplace_back(
+        [&completions, worker = worker.get()]() { worker->run(completions); });
+  }
+
+  std::unordered_map<u64, Connection> connections;
+  u64                                 next_id = FirstConnection;
+
+  auto close_connection = [&](u64 id) {
+    auto found = connections.find(id);
+    if (found != connections.end()) {
+      ::close(found->second.fd);
+      connections.erase(found);
+    }
+  };
+
+  // writes as much of the pending output as the socket accepts.
+  auto flush = [&](u64 id, Connection &connection) {
+    while (!connection.out.empty()) {
+      auto written = ::send(connection.fd, connection.out.data(),
+                            connection.out.size(), MSG_NOSIGNAL);
+      if (written < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          if (connection.writable) {
+            epoll_event interest{};
+            interest.events   = EPOLLIN | EPOLLOUT;
+            interest.data.u64 = id;
+            ::epoll_ctl(epoll, EPOLL_CTL_MOD, connection.fd, &interest);
+            connection.writable = false;
+          }
+          return;
+        }
+        close_connection(id);
+        return;
+      }
+      connection.out.erase(0, (size_t)(written));
+    }
+
+    if (!connection.writable) {
+      epoll_event interest{};
+      interest.events   = EPOLLIN;
+      interest.data.u64 = id;
+      ::epoll_ctl(epoll, EPOLL_CTL_MOD, connection.fd, &interest);
+      connection.writable = true;
+    }
+  };
+
+  auto respond = [&](u64 id, u64 sequence, std::string frame) {
+    auto found = connections.find(id);
+    if (found == connections.end()) {
+      return; // the client has gone away.
+    }
+    Connection &connection = found->second;
+    connection.ready.emplace(sequence, std::move(frame));
+    while (!connection.ready.empty() &&
+           connection.ready.begin()->first == connection.next_response) {
+      connection.out.append(connection.ready.begin()->second);
+      connection.ready.erase(connection.ready.begin());
+      connection.next_response++;
+    }
+    flush(id, connection);
+  };
+
+  // dispatches each complete frame which has been received.
+  auto receive = [&](u64 id, Connection &connection) {
+    size_t offset = 0;
+    while (connection.in.size() - offset >= sizeof(u32)) {
+      Reader header{std::string_view{connection.in}.substr(offset)};
+      size_t length = header.integer(sizeof(u32));
+      if (length > max_frame) {
+        close_connection(id);
+        return;
+      }
+      if (connection.in.size() - offset - sizeof(u32) < length) {
+        break;
+      }
+
+      auto payload = std::string_view{connection.in}.substr(
+          offset + sizeof(u32), length);
+      offset        += sizeof(u32) + length;
+      u64 sequence   = connection.next_request++;
+      auto request   = parseRequest(payload);
+      if (!request) {
+        respond(id, sequence, responseFrame(false, "malformed request"));
+        if (!connections.contains(id)) {
+          return;
+        }
+        continue;
+      }
+
+      request->connection = id;
+      request->sequence   = sequence;
+      request->received   = Clock::now();
+      workers[request->hash % workers.size()]->queue.push(
+          std::move(*request));
+    }
+    connection.in.erase(0, offset);
+  };
+
+  std::array<epoll_event, 64> events;
+  bool                        running = true;
+  while (running) {
+    int ready = ::epoll_wait(epoll, events.data(), (int)(events.size()), -1);
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+
+    for (int i = 0; i < ready; ++i) {
+      u64 id = events[(size_t)(i)].data.u64;
+      switch (id) {
+      case ListenerId: {
+        while (true) {
+          int client = ::accept4(listener, nullptr, nullptr,
+                                 SOCK_NONBLOCK | SOCK_CLOEXEC);
+          if (client < 0) {
+            break;
+          }
+          u64 connection_id = next_id++;
+          connections.emplace(connection_id, Connection{client});
+          watch(client, connection_id, EPOLLIN);
+        }
+        break;
+      }
+
+      case EventId: {
+        for (auto &response : completions.take()) {
+          respond(response.connection, response.sequence,
+                  std::move(response.frame));
+        }
+        break;
+      }
+
+      case SignalId: {
+        running = false;
+        break;
+      }
+
+      default: {
+        auto found = connections.find(id);
+        if (found == connections.end()) {
+          break;
+        }
+        Connection &connection = found->second;
+
+        if (events[(size_t)(i)].events & EPOLLOUT) {
+          flush(id, connection);
+          if (!connections.contains(id)) {
+            break;
+          }
+        }
+
+        if (events[(size_t)(i)].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+          std::array<char, 64 * 1024> buffer;
+          while (true) {
+            auto count = ::read(connection.fd, buffer.data(), buffer.size());
+            if (count > 0) {
+              connection.in.append(buffer.data(), (size_t)(count));
+              continue;
+            }
+            if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+              receive(id, connection);
+            } else {
+              close_connection(id);
+            }
+            break;
+          }
+        }
+        break;
+      }
+      }
+    }
+  }
+
+  for (auto &worker : workers) {
+    worker->queue.close();
+  }
+  threads.clear();
+
+  for (auto &[id, connection] : connections) {
+    ::close(connection.fd);
+  }
+  ::close(listener);
+  ::close(event);
+  ::close(signal);
+  ::close(epoll);
+  ::unlink(std::string{path}.c_str());
+
+  report(workers);
+  return EXIT_SUCCESS;
+}
+} // namespace voyage
@@ -0,0 +1,168 @@
+#include "voyage.hpp"
+#include "globals.hpp"
+#include "parser.hpp"
+#include "verifier.hpp"
+#include "virtual_machine.hpp"
+
+namespace voyage {
+Program::Program(Engine *engine, std::unique_ptr<Bytecode> bytecode,
+                 std::vector<u32>         inputs,
+                 std::unique_ptr<Globals> globals) noexcept
+    : m_engine(engine), m_bytecode(std::move(bytecode)),
+      m_inputs(std::move(inputs)), m_globals(std::move(globals)) {}
+
+Program::Program(Program &&other) noexcept
+    : m_engine(std::exchange(other.m_engine, nullptr)),
+      m_bytecode(std::move(other.m_bytecode)),
+      m_inputs(std::move(other.m_inputs)),
+      m_globals(std::move(other.m_globals)) {}
+
+Program &Program::operator=(Program &&other) noexcept {
+  if (this != &other) {
+    if (m_engine != nullptr && m_bytecode) {
+      m_engine->release(*m_bytecode, m_globals.get());
+    }
+    m_engine   = std::exchange(other.m_engine, nullptr);
+    m_bytecode = std::move(other.m_bytecode);
+    m_inputs   = std::move(other.m_inputs);
+    m_globals  = std::move(other.m_globals);
+  }
+  return *this;
+}
+
+Program::~Program() {
+  if (m_engine != nullptr && m_bytecode) {
+    m_engine->release(*m_bytecode, m_globals.get());
+  }
+}
+
+Engine::Engine(bool isolated)
+    : m_vm(std::make_unique<VirtualMachine>()), m_isolated(isolated) {}
+Engine::~Engine() = default;
+
+void Engine::release(Bytecode &bytecode, Globals *globals) noexcept {
+  m_vm->release(bytecode);
+  if (globals != nullptr) {
+    m_vm->release(*globals);
+  }
+}
+
+std::expected<Program, Error>
+Engine::compile(std::string_view source,
+                std::span<std::string_view const> inputs) {
+  if (!m_isolated) {
+    return declareAndCompile(source, inputs);
+  }
+
+  // #NOTE the program is compiled with its own globals swapped into
+  // the virtual machine, and they are swapped out again whether or
+  // not it compiles.
+  auto globals = std::make_unique<Globals>();
+  std::swap(m_vm->globals(), *globals);
+  auto compiled = declareAndCompile(source, inputs);
+  std::swap(m_vm->globals(), *globals);
+  if (!compiled) {
+    return compiled;
+  }
+
+  m_vm->retain(*globals);
+  compiled->m_globals = std::move(globals);
+  return compiled;
+}
+
+std::expected<Program, Error>
+Engine::declareAndCompile(std::string_view                  source,
+                          std::span<std::string_view const> inputs) {
+  // #NOTE the inputs are declared before parsing, so that the
+  // source resolves them, and every global declared since is
+  // forgotten again should compiling fail.
+  size_t declared = m_vm->globals().size();
+  auto   fail     = [&](Error error) -> std::expected<Program, Error> {
+    m_vm->globals().truncate(declared);
+    return std::unexpected{std::move(error)};
+  };
+
+  std::vector<u32> slots;
+  slots.reserve(inputs.size());
+  for (std::string_view input : inputs) {
+    if (m_vm->globals().size() == Globals::max_slots) {
+      return fail(
+          Error{Error::Kind::Comptime, "Too many global variables.", 0});
+    }
+    slots.push_back(m_vm->globals().declare(m_vm->heap().intern(input)));
+  }
+
+  Parser parser{m_vm->heap(), m_vm->globals(), m_vm->natives()};
+  parser.quieten(true);
+  auto parsed = parser.parse(source);
+  if (!parsed) {
+    if (auto const &failure = parser.firstError()) {
+      return fail(*failure);
+    }
+    return fail(Error{Error::Kind::Comptime, "failed to compile program", 0});
+  }
+
+  auto bytecode = std::make_unique<Bytecode>(std::move(*parsed));
+  if (auto verified =
+          verify(*bytecode, m_vm->globals().size(), m_vm->natives());
+      !verified) {
+    return fail(std::move(verified.error()));
+  }
+
+  m_vm->retain(*bytecode);
+  return Program{this, std::move(bytecode), std::move(slots), nullptr};
+}
+
+std::expected<Value, Error> Engine::evaluate(Program               &program,
+                                             std::span<Value const> inputs) {
+  if (program.m_engine != this) {
+    return std::unexpected{Error{Error::Kind::Runtime,
+                                 "program was compiled by another engine", 0}};
+  }
+
+  if (inputs.size() != program.m_inputs.size()) {
+    return std::unexpected{
+        Error{Error::Kind::Runtime,
+              std::format("expected {:d} inputs but got {:d}",
+                          program.m_inputs.size(), inputs.size()),
+              0}};
+  }
+
+  if (!program.m_globals) {
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      m_vm->globals()[program.m_inputs[i]] = inputs[i];
+    }
+    return m_vm->interpret(*program.m_bytecode);
+  }
+
+  // #NOTE the globals are reset after the evaluation as well, so
+  // that they keep nothing it allocated alive.
+  Globals &globals = *program.m_globals;
+  globals.reset();
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    globals[program.m_inputs[i]] = inputs[i];
+  }
+  std::swap(m_vm->globals(), globals);
+  auto result = m_vm->interpret(*program.m_bytecode);
+  std::swap(m_vm->globals(), globals);
+  globals.reset();
+  return result;
+}
+
+bool Engine::define(std::string_view name, u8 arity, NativeFn function) {
+  return m_vm->natives()
+      .define(m_vm->heap().intern(name), arity, function)
+      .has_value();
+}
+
+Value Engine::string(std::string_view text) {
+  return Value{m_vm->heap().intern(text)};
+}
+
+std::optional<std::string_view> Engine::text(Value const &value) noexcept {
+  if (!value.isString()) {
+    return std::nullopt;
+  }
+  return value.string()->view();
+}
+} // namespace voyage
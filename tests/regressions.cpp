@@ -0,0 +1,226 @@
+// regressions, each a program which once compiled, verified or ran
+// incorrectly. a case either evaluates to the value it expects, or
+// fails with the error it expects.
+//
+//   voyage_tests
+//
+// the status is the number of cases which failed.
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "compile_cache.hpp"
+#include "parser.hpp"
+#include "verifier.hpp"
+#include "virtual_machine.hpp"
+#include "voyage.hpp"
+
+// a case passes when its check returns nothing, and fails with the
+// description its check returns otherwise.
+struct Case {
+  std::string_view                            name;
+  std::function<std::optional<std::string>()> check;
+};
+
+// the source evaluates to the integer.
+static std::optional<std::string> evaluates(std::string_view source,
+                                            voyage::i64      expected) {
+  voyage::Engine engine;
+  auto           program = engine.compile(source);
+  if (!program) {
+    return std::string{program.error().msg()};
+  }
+  auto value = engine.evaluate(*program);
+  if (!value) {
+    return std::string{value.error().msg()};
+  }
+  if (!value->isInteger() || value->integer() != expected) {
+    std::ostringstream shown;
+    shown << *value;
+    return std::format("evaluated to {}, not {:d}", shown.str(), expected);
+  }
+  return std::nullopt;
+}
+
+// the chunk fails to verify with the message.
+static std::optional<std::string> rejects(voyage::Bytecode &bytecode,
+                                          std::string_view  expected) {
+  voyage::Natives natives;
+  auto            verified = voyage::verify(bytecode, 0, natives);
+  if (verified) {
+    return std::format("verified, rather than failing with '{}'", expected);
+  }
+  if (verified.error().msg() != expected) {
+    return std::format("failed with '{}', not '{}'", verified.error().msg(),
+                       expected);
+  }
+  return std::nullopt;
+}
+
+// the source, which is a view of a longer text, evaluates to the
+// integer, scanning none of the text beyond the view.
+static std::optional<std::string> evaluatesView(std::string_view text,
+                                                size_t           length,
+                                                voyage::i64      expected) {
+  return evaluates(text.substr(0, length), expected);
+}
+
+// once compiling source with the inputs fails, the inputs are not
+// left behind as globals, which a later source could refer to.
+static std::optional<std::string> forgets(std::string_view source,
+                                          std::string_view input) {
+  voyage::Engine   engine;
+  std::string_view inputs[] = {input};
+  if (engine.compile(source, inputs)) {
+    return std::format("compiled '{}'", source);
+  }
+  if (engine.compile(input)) {
+    return std::format("'{}' is still declared", input);
+  }
+  return std::nullopt;
+}
+
+// a cache, in a directory which holds other files, evicts only its
+// own artifacts, and only the temporary files left long ago.
+static std::optional<std::string> evictsOwn() {
+  namespace fs = std::filesystem;
+  auto directory = fs::temp_directory_path() /
+                   std::format("voyage_tests_{:d}", (voyage::u64)(::getpid()));
+  fs::remove_all(directory);
+  fs::create_directories(directory);
+
+  auto write = [&](std::string_view name) {
+    std::ofstream{directory / name} << std::string(4096, 'x');
+    return directory / name;
+  };
+  auto foreign   = write("important.txt");
+  auto writing   = write("0123456789abcdef.voyc.1.0.tmp");
+  auto abandoned = write("fedcba9876543210.voyc.2.0.tmp");
+  fs::last_write_time(abandoned, fs::file_time_type::clock::now() -
+                                     std::chrono::hours{2});
+
+  // the capacity is less than any artifact, so each store evicts.
+  voyage::CompileCache   cache{directory, 1};
+  voyage::VirtualMachine vm;
+  for (std::string_view source : {"1 + 2", "3 + 4"}) {
+    voyage::Parser parser{vm.heap(), vm.globals(), vm.natives()};
+    auto           bytecode = parser.parse(source);
+    if (!bytecode) {
+      return std::format("failed to compile '{}'", source);
+    }
+    cache.store(source, *bytecode, vm.globals(), vm.natives());
+  }
+
+  std::optional<std::string> failure;
+  if (!fs::exists(foreign)) {
+    failure = "evicted a file which is not an artifact";
+  } else if (!fs::exists(writing)) {
+    failure = "evicted the temporary file of a writer";
+  } else if (fs::exists(abandoned)) {
+    failure = "kept an abandoned temporary file";
+  } else if (cache.statistics().evictions != 2) {
+    failure = std::format("evicted {:d} artifacts, not 2",
+                          cache.statistics().evictions);
+  }
+  fs::remove_all(directory);
+  return failure;
+}
+
+// an isolated engine shares no globals between its programs, nor
+// between evaluations of one program.
+static std::optional<std::string> isolates() {
+  voyage::Engine engine{true};
+  auto           secret = engine.compile("var secret = 42; secret");
+  if (!secret || !engine.evaluate(*secret)) {
+    return "failed to evaluate 'var secret = 42; secret'";
+  }
+  if (engine.compile("secret")) {
+    return "'secret' is visible to another program";
+  }
+
+  std::string_view inputs[] = {"step"};
+  auto counter = engine.compile(
+      "fun last() { return count; } var count = last() + step; count", inputs);
+  if (!counter) {
+    return std::string{counter.error().msg()};
+  }
+  voyage::Value step[] = {voyage::Value{(voyage::i64)(1)}};
+  for (int i = 0; i < 2; ++i) {
+    auto value = engine.evaluate(*counter, step);
+    if (!value || !value->isInteger() || value->integer() != 1) {
+      return "a global kept its value between evaluations";
+    }
+  }
+
+  // #NOTE more globals than one table has slots for, across programs
+  // which are released in turn.
+  for (size_t i = 0; i <= voyage::Globals::max_slots; ++i) {
+    auto program = engine.compile(std::format("var v{:d} = 1; 0", i));
+    if (!program) {
+      return std::format("program {:d}: {}", i, program.error().msg());
+    }
+  }
+  return std::nullopt;
+}
+
+static Case const cases[] = {
+    {"return from a nested block",
+     [] {
+       return evaluates("fun f() { var a = 1; { var b = 2; return b; } } f()",
+                        2);
+     }},
+    {"return from nested blocks beside locals",
+     [] {
+       return evaluates("fun f(x) { var a = x; { var b = a + 1; "
+                        "{ var c = b + 1; return c; } } } f(1)",
+                        3);
+     }},
+    {"dead code after a return",
+     [] {
+       return evaluates("fun f() { var a = 1; return a; var b = a; } f()", 1);
+     }},
+    {"dead code after a nested return",
+     [] {
+       return evaluates(
+           "fun f() { var a = 5; { return a; var b = a; } var c = a; } f()",
+           5);
+     }},
+    {"tail call at the top level",
+     [] {
+       voyage::Bytecode bytecode;
+       bytecode.emitConstant(voyage::Value{(voyage::i64)(1)}, 1);
+       size_t call = bytecode.size();
+       bytecode.emitCall(0, 1);
+       bytecode.patch(call, voyage::Instruction::TAIL_CALL);
+       bytecode.emitReturn(1);
+       return rejects(bytecode, "TAIL_CALL outside of a function");
+     }},
+    {"a source which is not null terminated",
+     [] { return evaluatesView("1 + 2 + oops", 5, 3); }},
+    {"a source ending in a number which is not null terminated",
+     [] { return evaluatesView("40 + 2.5", 6, 42); }},
+    {"inputs of a source which failed to compile",
+     [] { return forgets("var y = input +;", "input"); }},
+    {"a cache directory which holds other files", evictsOwn},
+    {"the globals of an isolated engine", isolates},
+};
+
+int main() {
+  int failed = 0;
+  for (auto const &test : cases) {
+    if (auto failure = test.check()) {
+      std::cout << std::format("FAIL {}: {}\n", test.name, *failure);
+      failed++;
+    } else {
+      std::cout << std::format("ok   {}\n", test.name);
+    }
+  }
+  return failed;
+}